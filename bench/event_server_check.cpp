@@ -0,0 +1,124 @@
+// event_server_check.cpp
+// EventServer 错误路径的回归检查：400 / 405 / 431 响应后连接会被关闭，之后服务仍能正常处理请求；
+// 每种请求分别以普通方式和发送后立即 half-close 的方式发送。失败时返回非零退出码
+// 用法：./bench/event_server_check [端口]，建议配合 make check SANITIZE=address 运行以发现内存错误
+
+#include "event_server.h"
+#include "utils.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CheckCase {
+    const char* name;
+    std::string request;
+    int expectedStatus;
+};
+
+// 发送请求并读到连接关闭为止，返回响应状态码；连接失败或没有响应时返回 0
+int sendRequest(int port, const std::string& request, bool halfClose) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    struct timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return 0;
+    }
+
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t written = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            break;  // 服务端可能在读完之前就返回错误并关闭连接
+        }
+        sent += static_cast<size_t>(written);
+    }
+    if (halfClose) {
+        ::shutdown(fd, SHUT_WR);
+    }
+
+    std::string response;
+    char buffer[4096];
+    for (;;) {
+        ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        response.append(buffer, static_cast<size_t>(received));
+    }
+    ::close(fd);
+
+    if (response.compare(0, 9, "HTTP/1.1 ") != 0 || response.size() < 12) {
+        return 0;
+    }
+    return std::atoi(response.substr(9, 3).c_str());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? std::atoi(argv[1]) : 18183;
+    setLogLevel(LogLevel::LOGERROR);
+
+    EventServerOptions options;
+    options.port = port;
+    options.loopThreads = 1;
+    options.minWorkerThreads = 1;
+    options.maxWorkerThreads = 1;
+    EventServer server(options, [](const EventRequest&, EventServer::Responder respond) {
+        EventResponse response;
+        response.body = "ok";
+        respond(std::move(response));
+    });
+    if (!server.start()) {
+        std::fprintf(stderr, "failed to start event server on port %d\n", port);
+        return 1;
+    }
+
+    std::vector<CheckCase> cases = {
+        {"method", "POST /d/abc HTTP/1.1\r\nHost: localhost\r\n\r\n", 405},
+        {"request line", "GARBAGE\r\n\r\n", 400},
+        {"version", "GET /d/abc HTTP/2.0\r\nHost: localhost\r\n\r\n", 400},
+        {"body", "GET /d/abc HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello", 400},
+        {"header size", "GET /d/abc HTTP/1.1\r\nX-Padding: " + std::string(options.maxRequestHeaderBytes + 1024, 'a'), 431},
+        {"valid", "GET /d/abc HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", 200},
+    };
+
+    int failures = 0;
+    for (bool halfClose : {false, true}) {
+        for (const CheckCase& check : cases) {
+            int status = sendRequest(port, check.request, halfClose);
+            bool passed = status == check.expectedStatus;
+            std::printf("%-4s %-12s %-10s expected %d, got %d\n", passed ? "ok" : "FAIL", check.name,
+                        halfClose ? "half-close" : "", check.expectedStatus, status);
+            failures += passed ? 0 : 1;
+        }
+    }
+    // 错误路径之后服务仍然可用
+    if (sendRequest(port, cases.back().request, false) != 200) {
+        std::printf("FAIL server stopped responding after error responses\n");
+        ++failures;
+    }
+
+    server.stop();
+    std::printf("%s\n", failures == 0 ? "all checks passed" : "some checks failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,388 @@
+// load_generator.cpp
+// 媒体代理的端到端压测：按 Zipf 分布的热度请求一组图片和视频（可混合 Range 请求），
+// 以 JSON 输出吞吐量、p50/p99/p999 延迟、服务端 RSS 和上游请求数，便于逐个提交对比回归
+// 用法：./bench/load_generator [--url=http://127.0.0.1:8080] [--connections=16] [--duration-s=10] [--warmup-s=2]
+//       [--objects=1000] [--zipf-s=1.0] [--video-ratio=0.1] [--range-ratio=0.1] [--range-bytes=65536]
+//       [--image-size-min=20000] [--image-size-max=500000] [--video-size-min=1000000] [--video-size-max=8000000]
+//       [--short-ids=0] [--mock-url=http://127.0.0.1:18090] [--server-pid=0] [--seed=1] [--output=] [--secret-token=]
+// 服务端需要以 mock_telegram_server 作为 telegram_api_url 运行，并关闭或调高 security.rate_limit；
+// 对象的 file_id 带有大小后缀，由 mock 生成对应大小的文件。
+// --short-ids=1 时先把对象写入当前目录的 bot_database.db 并请求 /d/<短链>（需要在服务端的工作目录中运行），
+// 否则直接以 file_id 请求 /images/ 和 /videos/
+
+#include "db_manager.h"
+#include "httplib.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    std::string url = "http://127.0.0.1:8080";
+    int connections = 16;
+    int durationSeconds = 10;
+    int warmupSeconds = 2;           // 预热期间的请求不计入结果
+    size_t objects = 1000;
+    double zipfS = 1.0;
+    double videoRatio = 0.1;
+    double rangeRatio = 0.1;
+    size_t rangeBytes = 64 * 1024;
+    size_t imageSizeMin = 20000;
+    size_t imageSizeMax = 500000;
+    size_t videoSizeMin = 1000000;
+    size_t videoSizeMax = 8000000;
+    bool shortIds = false;
+    std::string mockUrl;             // mock_telegram_server 地址，用于统计上游请求数
+    int serverPid = 0;               // 非 0 时读取该进程的 RSS
+    unsigned seed = 1;
+    std::string output;              // 为空时输出到标准输出
+    std::string secretToken;         // 服务端的 secret_token，读取 /metrics 时使用
+};
+
+struct MediaObject {
+    std::string path;
+    size_t size;
+};
+
+struct WorkerResult {
+    std::vector<int64_t> latencies;  // 微秒
+    std::map<int, uint64_t> statuses;
+    uint64_t bytes = 0;
+    uint64_t failures = 0;           // 连接失败或状态码不符合预期
+};
+
+bool parseOptions(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            std::fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+            return false;
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (key == "url") options.url = value;
+        else if (key == "connections") options.connections = std::max(1, std::atoi(value.c_str()));
+        else if (key == "duration-s") options.durationSeconds = std::max(1, std::atoi(value.c_str()));
+        else if (key == "warmup-s") options.warmupSeconds = std::max(0, std::atoi(value.c_str()));
+        else if (key == "objects") options.objects = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "zipf-s") options.zipfS = std::atof(value.c_str());
+        else if (key == "video-ratio") options.videoRatio = std::atof(value.c_str());
+        else if (key == "range-ratio") options.rangeRatio = std::atof(value.c_str());
+        else if (key == "range-bytes") options.rangeBytes = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "image-size-min") options.imageSizeMin = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "image-size-max") options.imageSizeMax = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "video-size-min") options.videoSizeMin = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "video-size-max") options.videoSizeMax = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "short-ids") options.shortIds = value == "1" || value == "true";
+        else if (key == "mock-url") options.mockUrl = value;
+        else if (key == "server-pid") options.serverPid = std::atoi(value.c_str());
+        else if (key == "seed") options.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (key == "output") options.output = value;
+        else if (key == "secret-token") options.secretToken = value;
+        else {
+            std::fprintf(stderr, "unknown option: --%s\n", key.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t uniformSize(std::mt19937& random, size_t low, size_t high) {
+    return std::uniform_int_distribution<size_t>(low, std::max(low, high))(random);
+}
+
+// 6 位以内的短链由服务端查数据库，这里用 36 进制编号并以 L 开头，避免与 bot 生成的短链冲突
+std::string shortIdFor(size_t index) {
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::string id;
+    do {
+        id.insert(id.begin(), digits[index % 36]);
+        index /= 36;
+    } while (index > 0);
+    return "L" + id;
+}
+
+// 热度排名为 i 的对象即 objects[i]；file_id 以 _<大小> 结尾，由 mock 生成同样大小的文件
+std::vector<MediaObject> buildObjects(const LoadOptions& options) {
+    std::mt19937 random(options.seed);
+    std::vector<MediaObject> objects;
+    objects.reserve(options.objects);
+    if (options.shortIds) {
+        DBManager::getInstance().createTables();
+    }
+    for (size_t i = 0; i < options.objects; ++i) {
+        bool video = std::uniform_real_distribution<double>(0.0, 1.0)(random) < options.videoRatio;
+        size_t size = video ? uniformSize(random, options.videoSizeMin, options.videoSizeMax)
+                            : uniformSize(random, options.imageSizeMin, options.imageSizeMax);
+        std::string fileId = (video ? "loadvideo" : "loadimg") + std::to_string(i) + "_" + std::to_string(size);
+        if (options.shortIds) {
+            std::string shortId = shortIdFor(i);
+            std::string link = "/d/" + shortId;
+            DBManager::getInstance().addFile("loadtest", fileId, link, fileId, shortId, link, video ? ".mp4" : ".jpg");
+            objects.push_back({link, size});
+        } else {
+            objects.push_back({(video ? "/videos/" : "/images/") + fileId, size});
+        }
+    }
+    return objects;
+}
+
+// 预先计算累积分布，每次抽样做一次二分查找
+class ZipfSampler {
+public:
+    ZipfSampler(size_t count, double s) : cdf(count) {
+        double sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf[i] = sum;
+        }
+        for (double& value : cdf) {
+            value /= sum;
+        }
+    }
+
+    size_t sample(std::mt19937& random) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+        size_t index = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return std::min(index, cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+void runWorker(const LoadOptions& options, const std::vector<MediaObject>& objects, const ZipfSampler& sampler,
+               unsigned seed, Clock::time_point measureFrom, Clock::time_point deadline, WorkerResult& result) {
+    httplib::Client client(options.url);
+    client.set_keep_alive(true);
+    client.set_connection_timeout(5);
+    client.set_read_timeout(60);
+    std::mt19937 random(seed);
+
+    while (Clock::now() < deadline) {
+        const MediaObject& object = objects[sampler.sample(random)];
+        httplib::Headers headers;
+        bool ranged = options.rangeRatio > 0 && object.size > options.rangeBytes &&
+                      std::uniform_real_distribution<double>(0.0, 1.0)(random) < options.rangeRatio;
+        if (ranged) {
+            size_t offset = uniformSize(random, 0, object.size - options.rangeBytes);
+            headers.emplace("Range", "bytes=" + std::to_string(offset) + "-" + std::to_string(offset + options.rangeBytes - 1));
+        }
+
+        auto started = Clock::now();
+        uint64_t bytes = 0;
+        auto response = client.Get(object.path, headers, [&bytes](const char*, size_t length) {
+            bytes += length;
+            return true;
+        });
+        auto finished = Clock::now();
+        if (started < measureFrom) {
+            continue;
+        }
+
+        result.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(finished - started).count());
+        result.bytes += bytes;
+        if (!response) {
+            ++result.statuses[0];
+            ++result.failures;
+            continue;
+        }
+        ++result.statuses[response->status];
+        if (response->status != (ranged ? 206 : 200)) {
+            ++result.failures;
+        }
+    }
+}
+
+double percentileMs(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index] / 1000.0;
+}
+
+// 读取 /proc/<pid>/status 中的 VmRSS 和 VmHWM（KB）
+json readRss(int pid) {
+    json rss = json::object();
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        long value = 0;
+        fields >> key >> value;
+        if (key == "VmRSS:") rss["rss_kb"] = value;
+        else if (key == "VmHWM:") rss["peak_rss_kb"] = value;
+    }
+    return rss;
+}
+
+json fetchJson(const std::string& baseUrl, const std::string& path) {
+    httplib::Client client(baseUrl);
+    client.set_connection_timeout(2);
+    auto response = client.Get(path);
+    if (!response || response->status != 200) {
+        return nullptr;
+    }
+    return json::parse(response->body, nullptr, false);
+}
+
+// 取 Prometheus 文本中某个指标所有序列之和
+double sumMetric(const std::string& text, const std::string& name) {
+    double total = 0;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, name.size(), name) != 0 || line.size() <= name.size() ||
+            (line[name.size()] != ' ' && line[name.size()] != '{')) {
+            continue;
+        }
+        total += std::atof(line.substr(line.rfind(' ') + 1).c_str());
+    }
+    return total;
+}
+
+// 服务端 /metrics 中的上游请求数和失败数（未开启指标或 secret_token 不正确时为空）
+json fetchUpstreamMetrics(const std::string& url, const std::string& secretToken) {
+    httplib::Client client(url);
+    client.set_connection_timeout(2);
+    auto response = client.Get("/metrics", {{"X-Telegram-Bot-Api-Secret-Token", secretToken}});
+    if (!response || response->status != 200) {
+        return nullptr;
+    }
+    return {
+        {"requests", sumMetric(response->body, "upstream_request_duration_seconds_count")},
+        {"failures", sumMetric(response->body, "upstream_request_failures_total")}
+    };
+}
+
+// 两次快照中数值字段的差
+json diffCounters(const json& before, const json& after) {
+    if (!after.is_object()) {
+        return nullptr;
+    }
+    json diff = json::object();
+    for (auto it = after.begin(); it != after.end(); ++it) {
+        const json& old = before.is_object() && before.contains(it.key()) ? before[it.key()] : json();
+        if (it->is_object()) {
+            diff[it.key()] = diffCounters(old, *it);
+        } else if (it->is_number()) {
+            diff[it.key()] = it->get<double>() - (old.is_number() ? old.get<double>() : 0.0);
+        }
+    }
+    return diff;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<MediaObject> objects = buildObjects(options);
+    ZipfSampler sampler(objects.size(), options.zipfS);
+
+    json mockBefore = options.mockUrl.empty() ? json() : fetchJson(options.mockUrl, "/stats");
+    json metricsBefore = fetchUpstreamMetrics(options.url, options.secretToken);
+
+    auto start = Clock::now();
+    auto measureFrom = start + std::chrono::seconds(options.warmupSeconds);
+    auto deadline = measureFrom + std::chrono::seconds(options.durationSeconds);
+    std::vector<WorkerResult> results(options.connections);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.connections; ++i) {
+        workers.emplace_back(runWorker, std::cref(options), std::cref(objects), std::cref(sampler),
+                             options.seed * 7919 + i, measureFrom, deadline, std::ref(results[i]));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    // 最后一批请求可能在截止时间之后才完成，按实际结束时间计算吞吐量
+    double seconds = std::chrono::duration<double>(Clock::now() - measureFrom).count();
+
+    std::vector<int64_t> latencies;
+    std::map<int, uint64_t> statuses;
+    uint64_t bytes = 0;
+    uint64_t failures = 0;
+    for (auto& result : results) {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        for (const auto& entry : result.statuses) {
+            statuses[entry.first] += entry.second;
+        }
+        bytes += result.bytes;
+        failures += result.failures;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double meanMs = 0;
+    for (int64_t value : latencies) {
+        meanMs += value / 1000.0;
+    }
+    meanMs = latencies.empty() ? 0 : meanMs / latencies.size();
+
+    json statusCounts = json::object();
+    for (const auto& entry : statuses) {
+        statusCounts[std::to_string(entry.first)] = entry.second;
+    }
+
+    json report = {
+        {"options", {
+            {"url", options.url},
+            {"connections", options.connections},
+            {"duration_s", options.durationSeconds},
+            {"warmup_s", options.warmupSeconds},
+            {"objects", options.objects},
+            {"zipf_s", options.zipfS},
+            {"video_ratio", options.videoRatio},
+            {"range_ratio", options.rangeRatio},
+            {"short_ids", options.shortIds},
+            {"seed", options.seed}
+        }},
+        {"requests", latencies.size()},
+        {"failures", failures},
+        {"status", statusCounts},
+        {"elapsed_s", seconds},
+        {"throughput_rps", latencies.size() / seconds},
+        {"throughput_mib_s", bytes / seconds / (1024.0 * 1024.0)},
+        {"latency_ms", {
+            {"mean", meanMs},
+            {"p50", percentileMs(latencies, 0.50)},
+            {"p90", percentileMs(latencies, 0.90)},
+            {"p99", percentileMs(latencies, 0.99)},
+            {"p999", percentileMs(latencies, 0.999)},
+            {"max", latencies.empty() ? 0.0 : latencies.back() / 1000.0}
+        }},
+        // 包含预热阶段，即缓存填充期间的上游请求
+        {"upstream", {
+            {"server_metrics", diffCounters(metricsBefore, fetchUpstreamMetrics(options.url, options.secretToken))},
+            {"mock", options.mockUrl.empty() ? json() : diffCounters(mockBefore, fetchJson(options.mockUrl, "/stats"))}
+        }},
+        {"server", options.serverPid > 0 ? readRss(options.serverPid) : json()}
+    };
+
+    std::string text = report.dump(2);
+    if (options.output.empty()) {
+        std::printf("%s\n", text.c_str());
+    } else {
+        std::ofstream(options.output) << text << "\n";
+    }
+    return failures == 0 ? 0 : 2;
+}
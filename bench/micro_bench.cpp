@@ -0,0 +1,206 @@
+// micro_bench.cpp
+// 热点组件的微基准测试（Google Benchmark）：缓存查找与限流的锁竞争、线程池提交、短链查库、
+// gzip 压缩、短链生成、MIME/文件类型判断和日志提交，用于单独衡量每一项性能改动
+// 依赖 libbenchmark-dev，由 make bench-micro 单独构建，不影响 make bench
+// 用法：./bench/micro_bench [--benchmark_filter=正则] [--benchmark_format=json] [--benchmark_repetitions=N]
+// 运行时在当前目录创建 micro_bench.db 和 micro_bench.log，结束后删除
+
+#include "CacheManager.h"
+#include "db_manager.h"
+#include "request_handler.h"
+#include "server.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <future>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kDatabaseFile = "micro_bench.db";
+const char* const kLogFile = "micro_bench.log";
+const int kCachedFiles = 10000;
+const int kShortLinks = 1000;
+
+std::string fileIdFor(int index) {
+    return "AgACAgUAAxkBAAI" + std::to_string(100000 + index) + "_microbench";
+}
+
+// 所有线程共享同一个 CacheManager，才能测出 cacheMutex 上的竞争
+CacheManager& sharedCache() {
+    static CacheManager* cache = [] {
+        auto* manager = new CacheManager(kCachedFiles * 2, 60);
+        for (int i = 0; i < kCachedFiles; ++i) {
+            manager->addFilePathCache(fileIdFor(i), "photos/file_" + std::to_string(i) + ".jpg", 3600);
+        }
+        return manager;
+    }();
+    return *cache;
+}
+
+void BM_GetFilePathCache(benchmark::State& state) {
+    CacheManager& cache = sharedCache();
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1024; ++i) {
+        keys.push_back(fileIdFor((i * 7919 + state.thread_index() * 131) % kCachedFiles));
+    }
+    std::string filePath;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.getFilePathCache(keys[next++ & 1023], filePath));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetFilePathCache)->ThreadRange(1, 16)->UseRealTime();
+
+// range(0)：客户端 IP 数量，1 表示所有线程都在更新同一条限流记录
+void BM_CheckRateLimit(benchmark::State& state) {
+    CacheManager& cache = sharedCache();
+    std::vector<std::string> clients;
+    for (int i = 0; i < state.range(0); ++i) {
+        clients.push_back("10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256));
+    }
+    size_t next = static_cast<size_t>(state.thread_index());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.checkRateLimit(clients[next++ % clients.size()], 1 << 30));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CheckRateLimit)->Arg(1)->Arg(1024)->ThreadRange(1, 16)->UseRealTime();
+
+// 每次迭代提交 range(0) 个空任务并等待全部完成，衡量提交和唤醒的开销
+void BM_ThreadPoolEnqueue(benchmark::State& state) {
+    ThreadPool pool(4);
+    std::vector<std::future<void>> results;
+    results.reserve(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < state.range(0); ++i) {
+            results.push_back(pool.enqueue([] {}));
+        }
+        for (auto& result : results) {
+            result.wait();
+        }
+        results.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ThreadPoolEnqueue)->Arg(1)->Arg(64)->Arg(1024)->UseRealTime();
+
+void BM_GetFileIdByShortId(benchmark::State& state) {
+    DBManager& db = DBManager::getInstance(kDatabaseFile);
+    static bool seeded = [&db] {
+        db.createTables();
+        for (int i = 0; i < kShortLinks; ++i) {
+            std::string shortId = "m" + std::to_string(i);
+            db.addFile("microbench", fileIdFor(i), "/d/" + shortId, "file.jpg", shortId, "/d/" + shortId, ".jpg");
+        }
+        return true;
+    }();
+    benchmark::DoNotOptimize(seeded);
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> pick(0, kShortLinks - 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(db.getFileIdByShortId("m" + std::to_string(pick(random))));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetFileIdByShortId)->ThreadRange(1, 4)->UseRealTime();
+
+// 类似 JSON/HTML 的可压缩文本
+std::string compressibleText(size_t size) {
+    std::string text;
+    std::mt19937 random(7);
+    while (text.size() < size) {
+        text += "{\"file_id\":\"" + fileIdFor(random() % kCachedFiles) + "\",\"views\":" + std::to_string(random() % 100000) + "},";
+    }
+    text.resize(size);
+    return text;
+}
+
+void BM_GzipCompress(benchmark::State& state) {
+    std::string input = compressibleText(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gzipCompress(input));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GzipCompress)->RangeMultiplier(8)->Range(1 << 10, 1 << 20);
+
+void BM_GenerateShortLink(benchmark::State& state) {
+    int next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(generateShortLink(fileIdFor(next++ % kCachedFiles)));
+    }
+}
+BENCHMARK(BM_GenerateShortLink);
+
+void BM_GetMimeType(benchmark::State& state) {
+    // 与 config.json 中 mime_types 规模相当
+    const std::map<std::string, std::string> mimeTypes = {
+        {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"}, {".png", "image/png"}, {".gif", "image/gif"},
+        {".bmp", "image/bmp"}, {".tiff", "image/tiff"}, {".webp", "image/webp"}, {".mp4", "video/mp4"},
+        {".mp3", "audio/mpeg"}, {".ogg", "audio/ogg"}, {".wav", "audio/wav"}, {".m4a", "audio/mp4"},
+        {".aac", "audio/aac"}, {".pdf", "application/pdf"}, {".zip", "application/zip"}, {".txt", "text/plain"},
+        {".json", "application/json"}, {".html", "text/html"}, {".webm", "video/webm"}, {".mov", "video/quicktime"}
+    };
+    const std::vector<std::string> paths = {"photos/file_1.jpg", "videos/file_2.MP4", "documents/report.pdf", "music/file_3.bin"};
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getMimeType(paths[next++ % paths.size()], mimeTypes, "application/octet-stream"));
+    }
+}
+BENCHMARK(BM_GetMimeType);
+
+void BM_DetermineFileType(benchmark::State& state) {
+    const std::vector<std::string> paths = {"/images/abc.jpg", "/videos/abc.mkv", "/files/report.PDF", "/d/abc123"};
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(determineFileType(paths[next++ % paths.size()]));
+    }
+}
+BENCHMARK(BM_DetermineFileType);
+
+// 提交到日志队列的开销（写文件在后台线程中进行）
+void BM_Log(benchmark::State& state) {
+    setLogLevel(LogLevel::INFO);
+    std::string message = "Select file_id by short_id: abc123, file ID: " + fileIdFor(state.thread_index());
+    for (auto _ : state) {
+        log(LogLevel::INFO, message);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Log)->ThreadRange(1, 8)->UseRealTime();
+
+// 级别未开启时的开销
+void BM_LogFiltered(benchmark::State& state) {
+    setLogLevel(LogLevel::INFO);
+    std::string message = "filtered";
+    for (auto _ : state) {
+        log(LogLevel::DEBUG, message);
+    }
+}
+BENCHMARK(BM_LogFiltered);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    configureLogger(kLogFile, false);
+    std::remove(kDatabaseFile);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    flushLogs();
+    std::remove(kDatabaseFile);
+    std::remove(kLogFile);
+    return 0;
+}
@@ -0,0 +1,480 @@
+// mock_telegram_server.cpp
+// 本地模拟 Telegram Bot API，用于压测和联调代理路径，不需要真实的机器人和网络
+// 实现 getFile、/file/bot<token>/<path>、sendPhoto/sendDocument 等上传方法、sendMediaGroup、sendMessage、editMessageText 和 setWebhook，
+// 可注入延迟、带宽限制、5xx 错误和 429（带 retry_after），下载内容为按文件路径确定生成的字节
+// 用法：./bench/mock_telegram_server [--port=18090] [--threads=64] [--latency-ms=20] [--jitter-ms=0]
+//       [--bandwidth-kbps=0] [--error-rate=0] [--rate-limit-rate=0] [--retry-after=1]
+//       [--file-size=65536] [--file-size-max=0] [--token=]
+// 把 config.json 中的 telegram_api_url 指向 http://127.0.0.1:<port> 即可让机器人使用它
+//
+// file_id 约定：
+//   以 missing 开头          -> getFile 返回 400（文件不存在）
+//   包含 video / doc         -> 路径为 videos/<id>.mp4 / documents/<id>.pdf，其余为 photos/<id>.jpg
+//   包含 text / json         -> 路径为 texts/<id>.txt / texts/<id>.json，内容为可压缩的文本（用于测试响应压缩）
+//   以 _<数字> 结尾          -> 文件大小为该字节数；否则在 [file-size, file-size-max] 内按路径确定
+// GET /stats 返回各方法的调用次数和注入的错误数
+
+#include "httplib.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct MockOptions {
+    std::string host = "127.0.0.1";
+    int port = 18090;
+    int threads = 64;
+    int latencyMs = 20;              // 每个请求在响应前的固定延迟
+    int jitterMs = 0;                // 额外的 [0, jitter] 随机延迟
+    size_t bandwidthKBps = 0;        // 单个下载的速率上限（KB/s），0 表示不限
+    double errorRate = 0;            // 返回 500 的概率
+    double rateLimitRate = 0;        // API 方法返回 429 的概率
+    int retryAfter = 1;              // 429 响应中的 parameters.retry_after
+    size_t fileSize = 64 * 1024;
+    size_t fileSizeMax = 0;          // 大于 fileSize 时，文件大小在两者之间按路径确定
+    std::string token;               // 非空时只接受这个 token，其余返回 401
+};
+
+MockOptions options;
+
+std::mutex statsMutex;
+std::map<std::string, uint64_t> methodCalls;
+std::atomic<uint64_t> injectedErrors{0};
+std::atomic<uint64_t> injectedRateLimits{0};
+std::atomic<uint64_t> bytesServed{0};
+std::atomic<int64_t> nextMessageId{1};
+std::atomic<uint64_t> nextUploadId{1};
+
+bool parseOptions(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+            std::fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+            return false;
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (key == "host") options.host = value;
+        else if (key == "port") options.port = std::atoi(value.c_str());
+        else if (key == "threads") options.threads = std::max(1, std::atoi(value.c_str()));
+        else if (key == "latency-ms") options.latencyMs = std::atoi(value.c_str());
+        else if (key == "jitter-ms") options.jitterMs = std::atoi(value.c_str());
+        else if (key == "bandwidth-kbps") options.bandwidthKBps = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "error-rate") options.errorRate = std::atof(value.c_str());
+        else if (key == "rate-limit-rate") options.rateLimitRate = std::atof(value.c_str());
+        else if (key == "retry-after") options.retryAfter = std::atoi(value.c_str());
+        else if (key == "file-size") options.fileSize = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "file-size-max") options.fileSizeMax = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "token") options.token = value;
+        else {
+            std::fprintf(stderr, "unknown option: --%s\n", key.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+double randomUnit() {
+    thread_local std::mt19937 generator(std::random_device{}());
+    return std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+}
+
+void injectLatency() {
+    int delay = options.latencyMs;
+    if (options.jitterMs > 0) {
+        delay += static_cast<int>(randomUnit() * options.jitterMs);
+    }
+    if (delay > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    }
+}
+
+void countCall(const std::string& method) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++methodCalls[method];
+}
+
+void sendJson(httplib::Response& res, int status, const json& body) {
+    res.status = status;
+    res.set_content(body.dump(), "application/json");
+}
+
+void sendError(httplib::Response& res, int status, const std::string& description) {
+    sendJson(res, status, {{"ok", false}, {"error_code", status}, {"description", description}});
+}
+
+// 按配置的概率注入 429 / 500，已写入响应时返回 true
+bool injectFailure(httplib::Response& res, bool allowRateLimit) {
+    if (allowRateLimit && options.rateLimitRate > 0 && randomUnit() < options.rateLimitRate) {
+        ++injectedRateLimits;
+        sendJson(res, 429, {
+            {"ok", false},
+            {"error_code", 429},
+            {"description", "Too Many Requests: retry after " + std::to_string(options.retryAfter)},
+            {"parameters", {{"retry_after", options.retryAfter}}}
+        });
+        return true;
+    }
+    if (options.errorRate > 0 && randomUnit() < options.errorRate) {
+        ++injectedErrors;
+        sendError(res, 500, "Internal Server Error");
+        return true;
+    }
+    return false;
+}
+
+bool checkToken(const std::string& token, httplib::Response& res) {
+    if (!options.token.empty() && token != options.token) {
+        sendError(res, 401, "Unauthorized");
+        return false;
+    }
+    return true;
+}
+
+// 参数可能来自查询串、urlencoded 表单、JSON 请求体或 multipart 表单
+std::string getParam(const httplib::Request& req, const json& body, const std::string& name) {
+    if (req.has_param(name)) {
+        return req.get_param_value(name);
+    }
+    if (body.is_object() && body.contains(name)) {
+        const auto& value = body[name];
+        return value.is_string() ? value.get<std::string>() : value.dump();
+    }
+    if (req.has_file(name)) {
+        return req.get_file_value(name).content;
+    }
+    return "";
+}
+
+uint64_t hashString(const std::string& text) {
+    uint64_t hash = 1469598103934665603ULL;  // FNV-1a
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string filePathFor(const std::string& fileId) {
+    if (fileId.find("text") != std::string::npos) {
+        return "texts/" + fileId + ".txt";
+    }
+    if (fileId.find("json") != std::string::npos) {
+        return "texts/" + fileId + ".json";
+    }
+    if (fileId.find("video") != std::string::npos) {
+        return "videos/" + fileId + ".mp4";
+    }
+    if (fileId.find("doc") != std::string::npos) {
+        return "documents/" + fileId + ".pdf";
+    }
+    return "photos/" + fileId + ".jpg";
+}
+
+size_t fileSizeFor(const std::string& filePath) {
+    std::string stem = filePath.substr(filePath.rfind('/') + 1);  // 没有 '/' 时 npos + 1 == 0
+    stem = stem.substr(0, stem.rfind('.'));
+    size_t underscore = stem.rfind('_');
+    if (underscore != std::string::npos && underscore + 1 < stem.size() &&
+        std::all_of(stem.begin() + underscore + 1, stem.end(), ::isdigit)) {
+        return std::strtoull(stem.c_str() + underscore + 1, nullptr, 10);
+    }
+    if (options.fileSizeMax > options.fileSize) {
+        return options.fileSize + hashString(filePath) % (options.fileSizeMax - options.fileSize + 1);
+    }
+    return options.fileSize;
+}
+
+std::string contentTypeFor(const std::string& filePath) {
+    if (filePath.size() >= 4 && filePath.compare(filePath.size() - 4, 4, ".mp4") == 0) return "video/mp4";
+    if (filePath.size() >= 4 && filePath.compare(filePath.size() - 4, 4, ".pdf") == 0) return "application/pdf";
+    if (filePath.size() >= 4 && filePath.compare(filePath.size() - 4, 4, ".txt") == 0) return "text/plain";
+    if (filePath.size() >= 5 && filePath.compare(filePath.size() - 5, 5, ".json") == 0) return "application/json";
+    return "image/jpeg";
+}
+
+// 同一路径每次下载得到相同的字节，便于校验缓存内容
+void fillBytes(uint64_t seed, size_t offset, char* out, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        uint64_t x = seed + (offset + i) / 8;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        out[i] = static_cast<char>(x >> (((offset + i) % 8) * 8));
+    }
+}
+
+// 文本文件：每 8 字节按同样的伪随机序列选一个单词，压缩率与普通文本相近
+void fillText(uint64_t seed, size_t offset, char* out, size_t length) {
+    static const char* const kWords[] = {"telegram", "image   ", "cache   ", "upload  ", "proxy   ",
+                                         "file_id ", "channel ", "short   ", "link\n   ", "bot     "};
+    for (size_t i = 0; i < length; ++i) {
+        uint64_t x = seed + (offset + i) / 8;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        out[i] = kWords[x % 10][(offset + i) % 8];
+    }
+}
+
+json chatOf(const std::string& chatId) {
+    json chat = {{"id", chatId}, {"type", !chatId.empty() && (chatId[0] == '-' || chatId[0] == '@') ? "channel" : "private"}};
+    char* end = nullptr;
+    long long numeric = std::strtoll(chatId.c_str(), &end, 10);
+    if (!chatId.empty() && end && *end == '\0') {
+        chat["id"] = numeric;
+    }
+    return chat;
+}
+
+json newMessage(const std::string& chatId) {
+    return {
+        {"message_id", nextMessageId++},
+        {"date", static_cast<int64_t>(std::time(nullptr))},
+        {"chat", chatOf(chatId)}
+    };
+}
+
+// sendPhoto / sendDocument / sendVideo / sendAudio / sendAnimation / sendSticker
+void handleUpload(const std::string& field, const httplib::Request& req, const json& body, httplib::Response& res) {
+    std::string chatId = getParam(req, body, "chat_id");
+    size_t size = 0;
+    std::string fileName = field;
+    if (req.has_file(field)) {
+        const auto& file = req.get_file_value(field);
+        size = file.content.size();
+        if (!file.filename.empty()) {
+            fileName = file.filename;
+        }
+    } else {
+        std::string reference = getParam(req, body, field);  // 以 file_id 或 URL 重新发送
+        if (reference.empty()) {
+            sendError(res, 400, "Bad Request: there is no " + field + " in the request");
+            return;
+        }
+        size = fileSizeFor(filePathFor(reference));
+    }
+
+    // 上传得到的 file_id 以大小结尾，之后 getFile 和下载能得到同样大小的文件
+    std::string prefix = field == "photo" ? "mockphoto" : field == "document" ? "mockdoc" : field == "video" ? "mockvideo" : "mock" + field;
+    std::string fileId = prefix + std::to_string(nextUploadId++) + "_" + std::to_string(size);
+    json fileInfo = {{"file_id", fileId}, {"file_unique_id", "u" + fileId}, {"file_size", size}};
+
+    json message = newMessage(chatId);
+    if (field == "photo") {
+        json thumb = fileInfo;
+        thumb["file_id"] = fileId + "t";
+        thumb["file_unique_id"] = "u" + fileId + "t";
+        thumb["file_size"] = std::min<size_t>(size, 4096);
+        thumb["width"] = 90;
+        thumb["height"] = 90;
+        fileInfo["width"] = 1280;
+        fileInfo["height"] = 960;
+        message["photo"] = json::array({thumb, fileInfo});
+    } else {
+        fileInfo["file_name"] = fileName;
+        message[field] = fileInfo;
+    }
+    sendJson(res, 200, {{"ok", true}, {"result", message}});
+}
+
+// sendMediaGroup：media 为 InputMedia 数组，文件以 attach://<字段名> 引用 multipart 中的部分
+void handleMediaGroup(const httplib::Request& req, const json& body, httplib::Response& res) {
+    json media = json::parse(getParam(req, body, "media"), nullptr, false);
+    if (!media.is_array() || media.size() < 2 || media.size() > 10) {
+        sendError(res, 400, "Bad Request: media must include 2-10 items");
+        return;
+    }
+    std::string chatId = getParam(req, body, "chat_id");
+    json messages = json::array();
+    for (const auto& item : media) {
+        std::string type = item.value("type", "photo");
+        std::string reference = item.value("media", "");
+        size_t size = 0;
+        if (reference.compare(0, 9, "attach://") == 0 && req.has_file(reference.substr(9))) {
+            size = req.get_file_value(reference.substr(9)).content.size();
+        } else if (!reference.empty()) {
+            size = fileSizeFor(filePathFor(reference));
+        } else {
+            sendError(res, 400, "Bad Request: wrong file identifier/HTTP URL specified");
+            return;
+        }
+
+        std::string fileId = "mock" + (type == "document" ? std::string("doc") : type) + std::to_string(nextUploadId++) + "_" + std::to_string(size);
+        json fileInfo = {{"file_id", fileId}, {"file_unique_id", "u" + fileId}, {"file_size", size}};
+        json message = newMessage(chatId);
+        message["media_group_id"] = "mockgroup";
+        if (type == "photo") {
+            fileInfo["width"] = 1280;
+            fileInfo["height"] = 960;
+            message["photo"] = json::array({fileInfo});
+        } else {
+            message[type] = fileInfo;
+        }
+        messages.push_back(message);
+    }
+    sendJson(res, 200, {{"ok", true}, {"result", messages}});
+}
+
+void handleMethod(const httplib::Request& req, httplib::Response& res) {
+    std::string token = req.matches[1];
+    std::string method = req.matches[2];
+    countCall(method);
+    injectLatency();
+    if (!checkToken(token, res) || injectFailure(res, true)) {
+        return;
+    }
+
+    json body;
+    if (req.get_header_value("Content-Type").find("application/json") != std::string::npos) {
+        body = json::parse(req.body, nullptr, false);
+    }
+
+    static const std::map<std::string, std::string> uploadFields = {
+        {"sendPhoto", "photo"}, {"sendDocument", "document"}, {"sendVideo", "video"},
+        {"sendAudio", "audio"}, {"sendAnimation", "animation"}, {"sendSticker", "sticker"}
+    };
+
+    if (method == "getFile") {
+        std::string fileId = getParam(req, body, "file_id");
+        if (fileId.empty() || fileId.compare(0, 7, "missing") == 0) {
+            sendError(res, 400, "Bad Request: invalid file_id");
+            return;
+        }
+        std::string filePath = filePathFor(fileId);
+        sendJson(res, 200, {{"ok", true}, {"result", {
+            {"file_id", fileId},
+            {"file_unique_id", "u" + fileId},
+            {"file_size", fileSizeFor(filePath)},
+            {"file_path", filePath}
+        }}});
+    } else if (method == "sendMediaGroup") {
+        handleMediaGroup(req, body, res);
+    } else if (uploadFields.count(method)) {
+        handleUpload(uploadFields.at(method), req, body, res);
+    } else if (method == "sendMessage") {
+        json message = newMessage(getParam(req, body, "chat_id"));
+        message["text"] = getParam(req, body, "text");
+        sendJson(res, 200, {{"ok", true}, {"result", message}});
+    } else if (method == "editMessageText") {
+        std::string messageId = getParam(req, body, "message_id");
+        json message = {
+            {"message_id", std::atoll(messageId.c_str())},
+            {"date", static_cast<int64_t>(std::time(nullptr))},
+            {"edit_date", static_cast<int64_t>(std::time(nullptr))},
+            {"chat", chatOf(getParam(req, body, "chat_id"))},
+            {"text", getParam(req, body, "text")}
+        };
+        sendJson(res, 200, {{"ok", true}, {"result", message}});
+    } else if (method == "forwardMessage" || method == "copyMessage") {
+        sendJson(res, 200, {{"ok", true}, {"result", newMessage(getParam(req, body, "chat_id"))}});
+    } else if (method == "setWebhook" || method == "deleteWebhook") {
+        sendJson(res, 200, {{"ok", true}, {"result", true},
+                            {"description", method == "setWebhook" ? "Webhook was set" : "Webhook was deleted"}});
+    } else if (method == "getMe") {
+        sendJson(res, 200, {{"ok", true}, {"result", {{"id", 1}, {"is_bot", true}, {"first_name", "mock"}, {"username", "mock_bot"}}}});
+    } else if (method == "answerCallbackQuery") {
+        sendJson(res, 200, {{"ok", true}, {"result", true}});
+    } else {
+        sendError(res, 404, "Not Found: method not found");
+    }
+}
+
+void handleDownload(const httplib::Request& req, httplib::Response& res) {
+    std::string token = req.matches[1];
+    std::string filePath = req.matches[2];
+    countCall("download");
+    injectLatency();
+    if (!checkToken(token, res) || injectFailure(res, false)) {
+        return;
+    }
+    if (filePath.find("missing") != std::string::npos) {
+        sendError(res, 404, "Not Found");
+        return;
+    }
+
+    size_t size = fileSizeFor(filePath);
+    uint64_t seed = hashString(filePath);
+    size_t bytesPerSecond = options.bandwidthKBps * 1024;
+    auto started = std::chrono::steady_clock::now();
+
+    bool text = filePath.compare(0, 6, "texts/") == 0;
+    res.set_content_provider(size, contentTypeFor(filePath),
+        [seed, text, bytesPerSecond, started](size_t offset, size_t length, httplib::DataSink& sink) {
+            char buffer[16 * 1024];
+            size_t chunk = std::min(length, sizeof(buffer));
+            (text ? fillText : fillBytes)(seed, offset, buffer, chunk);
+            if (bytesPerSecond > 0) {
+                // 按已发送的字节数计算应到达的时间点，而不是每块固定睡眠，避免误差累积
+                auto due = started + std::chrono::microseconds((offset + chunk) * 1000000ULL / bytesPerSecond);
+                std::this_thread::sleep_until(due);
+            }
+            if (!sink.write(buffer, chunk)) {
+                return false;
+            }
+            bytesServed += chunk;
+            return true;
+        });
+}
+
+void handleStats(const httplib::Request&, httplib::Response& res) {
+    json calls = json::object();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (const auto& entry : methodCalls) {
+            calls[entry.first] = entry.second;
+        }
+    }
+    sendJson(res, 200, {
+        {"calls", calls},
+        {"injected_errors", injectedErrors.load()},
+        {"injected_rate_limits", injectedRateLimits.load()},
+        {"bytes_served", bytesServed.load()}
+    });
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (!parseOptions(argc, argv)) {
+        return 1;
+    }
+
+    httplib::Server server;
+    int threads = options.threads;
+    server.new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+    server.set_payload_max_length(64 * 1024 * 1024);
+
+    server.Get(R"(/bot([^/]+)/([A-Za-z]+))", handleMethod);
+    server.Post(R"(/bot([^/]+)/([A-Za-z]+))", handleMethod);
+    server.Get(R"(/file/bot([^/]+)/(.+))", handleDownload);
+    server.Get("/stats", handleStats);
+
+    std::printf("mock Telegram API on http://%s:%d  threads=%d latency=%dms+%dms bandwidth=%zuKB/s "
+                "error=%.3f 429=%.3f(retry_after=%d) file=%zu..%zu bytes\n",
+                options.host.c_str(), options.port, options.threads, options.latencyMs, options.jitterMs,
+                options.bandwidthKBps, options.errorRate, options.rateLimitRate, options.retryAfter,
+                options.fileSize, std::max(options.fileSize, options.fileSizeMax));
+    std::fflush(stdout);
+
+    if (!server.listen(options.host, options.port)) {
+        std::fprintf(stderr, "failed to listen on %s:%d\n", options.host.c_str(), options.port);
+        return 1;
+    }
+    return 0;
+}
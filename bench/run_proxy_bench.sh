@@ -0,0 +1,61 @@
+#!/bin/sh
+# run_proxy_bench.sh
+# 在临时目录中以 mock_telegram_server 为上游启动 telegram_bot，运行 load_generator，结果 JSON 输出到标准输出
+# 用法：bench/run_proxy_bench.sh [load_generator 参数...]
+# 环境变量：MOCK_ARGS 传给 mock_telegram_server（例如 "--latency-ms=50 --bandwidth-kbps=2048"），
+#           BENCH_PORT / MOCK_PORT 指定端口，KEEP_WORKDIR=1 时保留临时目录（日志、数据库、缓存）
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BENCH_PORT=${BENCH_PORT:-18180}
+MOCK_PORT=${MOCK_PORT:-18190}
+WORKDIR=$(mktemp -d)
+
+cleanup() {
+    status=$?
+    set +e
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null && wait "$SERVER_PID" 2>/dev/null
+    [ -n "$MOCK_PID" ] && kill "$MOCK_PID" 2>/dev/null && wait "$MOCK_PID" 2>/dev/null
+    if [ "$KEEP_WORKDIR" = "1" ]; then
+        echo "workdir: $WORKDIR" >&2
+    else
+        rm -rf "$WORKDIR"
+    fi
+    exit $status
+}
+trap cleanup EXIT INT TERM
+
+# 基于仓库中的 config.json 生成压测配置：上游指向 mock，关闭限流和控制台日志
+python3 - "$ROOT/config.json" "$WORKDIR/config.json" "$BENCH_PORT" "$MOCK_PORT" <<'EOF'
+import json, sys
+source, target, port, mock_port = sys.argv[1], sys.argv[2], int(sys.argv[3]), int(sys.argv[4])
+config = json.load(open(source))
+config["server"].update({"hostname": "127.0.0.1", "port": port, "use_https": False,
+                         "webhook_url": "http://127.0.0.1:%d" % port})
+config["api_token"] = "bench"
+config["secret_token"] = "bench"
+config["telegram_api_url"] = "http://127.0.0.1:%d" % mock_port
+config["security"]["rate_limit"]["requests_per_minute"] = 1000000000
+config["logging"]["console"] = False
+config["metrics"]["enabled"] = True
+json.dump(config, open(target, "w"), indent=4)
+EOF
+
+"$ROOT/bench/mock_telegram_server" --port="$MOCK_PORT" $MOCK_ARGS >"$WORKDIR/mock.log" 2>&1 &
+MOCK_PID=$!
+
+cd "$WORKDIR"
+"$ROOT/telegram_bot" >"$WORKDIR/server.log" 2>&1 &
+SERVER_PID=$!
+
+# 等待服务端开始监听
+for i in $(seq 1 50); do
+    if curl -s -o /dev/null "http://127.0.0.1:$BENCH_PORT/metrics"; then
+        break
+    fi
+    sleep 0.2
+done
+
+"$ROOT/bench/load_generator" --url="http://127.0.0.1:$BENCH_PORT" --mock-url="http://127.0.0.1:$MOCK_PORT" \
+    --server-pid="$SERVER_PID" --secret-token=bench "$@"
@@ -0,0 +1,209 @@
+// thread_pool_bench.cpp
+// 对比 ThreadPool 与 WorkStealingPool 的提交吞吐量和排队延迟
+// 用法：./bench/thread_pool_bench [线程数] [每个场景的任务数]
+
+#include "thread_pool.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    double seconds = 0;
+    size_t tasks = 0;
+    std::vector<int64_t> latencies;  // 提交到开始执行的纳秒数
+};
+
+void waitFor(const std::atomic<size_t>& done, size_t expected) {
+    while (done.load(std::memory_order_acquire) < expected) {
+        std::this_thread::yield();
+    }
+}
+
+int64_t percentile(std::vector<int64_t>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void printResult(const char* scenario, const char* pool, BenchResult& result) {
+    double throughput = result.tasks / result.seconds;
+    std::printf("%-18s %-18s %10.0f tasks/s", scenario, pool, throughput);
+    if (!result.latencies.empty()) {
+        std::printf("   p50 %7.1f us  p99 %8.1f us  p99.9 %8.1f us",
+                    percentile(result.latencies, 0.50) / 1000.0,
+                    percentile(result.latencies, 0.99) / 1000.0,
+                    percentile(result.latencies, 0.999) / 1000.0);
+    }
+    std::printf("\n");
+}
+
+// 不需要结果时的提交方式：ThreadPool 只有 enqueue，WorkStealingPool 使用不创建 future 的 execute
+template<class F>
+void post(ThreadPool& pool, F&& f) {
+    pool.enqueue(std::forward<F>(f));
+}
+
+template<class F>
+void post(WorkStealingPool& pool, F&& f) {
+    pool.execute(std::forward<F>(f));
+}
+
+// 多个外部线程同时提交小任务（与 handleRequestStatistics 等请求线程提交任务的情况相同）
+template<class Pool>
+BenchResult externalSubmit(Pool& pool, size_t producers, size_t totalTasks) {
+    BenchResult result;
+    result.tasks = totalTasks;
+    result.latencies.assign(totalTasks, 0);
+    std::atomic<size_t> done(0);
+    size_t perProducer = totalTasks / producers;
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < perProducer; ++i) {
+                size_t slot = p * perProducer + i;
+                auto submittedAt = Clock::now();
+                pool.enqueue([&result, &done, slot, submittedAt]() {
+                    result.latencies[slot] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - submittedAt).count();
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    waitFor(done, perProducer * producers);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.latencies.resize(perProducer * producers);
+    result.tasks = perProducer * producers;
+    return result;
+}
+
+// 工作线程内部再拆分子任务（如批量预取），work stealing 的本地队列主要优化这种情况
+template<class Pool>
+BenchResult nestedFanOut(Pool& pool, size_t roots, size_t childrenPerRoot) {
+    BenchResult result;
+    result.tasks = roots * childrenPerRoot;
+    std::atomic<size_t> done(0);
+
+    auto start = Clock::now();
+    for (size_t r = 0; r < roots; ++r) {
+        post(pool, [&pool, &done, childrenPerRoot]() {
+            for (size_t c = 0; c < childrenPerRoot; ++c) {
+                post(pool, [&done]() { done.fetch_add(1, std::memory_order_release); });
+            }
+        });
+    }
+    waitFor(done, result.tasks);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+// 低负载下按固定间隔提交，排队延迟主要来自唤醒休眠线程的开销
+template<class Pool>
+BenchResult pacedSubmit(Pool& pool, size_t totalTasks, std::chrono::microseconds interval) {
+    BenchResult result;
+    result.tasks = totalTasks;
+    result.latencies.assign(totalTasks, 0);
+    std::atomic<size_t> done(0);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < totalTasks; ++i) {
+        auto submittedAt = Clock::now();
+        post(pool, [&result, &done, i, submittedAt]() {
+            result.latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - submittedAt).count();
+            done.fetch_add(1, std::memory_order_release);
+        });
+        while (Clock::now() - submittedAt < interval) {
+        }
+    }
+    waitFor(done, totalTasks);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+// 只测 WorkStealingPool 的 execute（不创建 future）
+BenchResult externalExecute(WorkStealingPool& pool, size_t producers, size_t totalTasks) {
+    BenchResult result;
+    size_t perProducer = totalTasks / producers;
+    result.tasks = perProducer * producers;
+    std::atomic<size_t> done(0);
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < perProducer; ++i) {
+                pool.execute([&done]() { done.fetch_add(1, std::memory_order_release); });
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    waitFor(done, result.tasks);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(2u, std::thread::hardware_concurrency());
+    size_t tasks = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 400000;
+    size_t producers = std::max<size_t>(1, threads / 2);
+
+    std::printf("threads=%zu tasks=%zu producers=%zu\n\n", threads, tasks, producers);
+
+    {
+        ThreadPool pool(threads);
+        BenchResult result = externalSubmit(pool, producers, tasks);
+        printResult("external_submit", "ThreadPool", result);
+    }
+    {
+        WorkStealingPool pool(threads);
+        BenchResult result = externalSubmit(pool, producers, tasks);
+        printResult("external_submit", "WorkStealingPool", result);
+    }
+    {
+        WorkStealingPool pool(threads);
+        BenchResult result = externalExecute(pool, producers, tasks);
+        printResult("external_execute", "WorkStealingPool", result);
+    }
+    {
+        ThreadPool pool(threads);
+        BenchResult result = nestedFanOut(pool, threads * 4, tasks / (threads * 4));
+        printResult("nested_fan_out", "ThreadPool", result);
+    }
+    {
+        WorkStealingPool pool(threads);
+        BenchResult result = nestedFanOut(pool, threads * 4, tasks / (threads * 4));
+        printResult("nested_fan_out", "WorkStealingPool", result);
+    }
+    {
+        ThreadPool pool(threads);
+        BenchResult result = pacedSubmit(pool, tasks / 20, std::chrono::microseconds(50));
+        printResult("paced_50us", "ThreadPool", result);
+    }
+    {
+        WorkStealingPool pool(threads);
+        BenchResult result = pacedSubmit(pool, tasks / 20, std::chrono::microseconds(50));
+        printResult("paced_50us", "WorkStealingPool", result);
+    }
+    return 0;
+}
@@ -14,8 +14,13 @@
 struct CacheItem {
     std::unique_ptr<std::string> data;
     std::chrono::steady_clock::time_point expirationTime;
+    std::chrono::steady_clock::time_point staleUntil;   // 过期后仍保留到这个时间，供上游不可用时使用
 };
 
+// 查找结果：Stale 表示已过期但仍在宽限期内，可以先用旧值响应再刷新（stale-while-revalidate），
+// 上游出错时也可以继续使用（stale-if-error）
+enum class CacheLookup { Miss, Fresh, Stale };
+
 struct RateLimitInfo {
     std::chrono::steady_clock::time_point lastRequestTime;
     int requestCount;
@@ -24,7 +29,8 @@ struct RateLimitInfo {
 // 缓存管理类
 class CacheManager {
 public:
-    CacheManager(size_t maxCacheSize, int cleanupIntervalSeconds);
+    // staleGraceSeconds：缓存项过期后继续保留的时间，0 表示过期即删除
+    CacheManager(size_t maxCacheSize, int cleanupIntervalSeconds, int staleGraceSeconds = 0);
     ~CacheManager();
 
     // 添加缓存
@@ -34,6 +40,9 @@ public:
     bool getCache(const std::string& key, std::string& data);
     void addFilePathCache(const std::string& fileId, const std::string& filePath, int ttlSeconds);
     bool getFilePathCache(const std::string& fileId, std::string& filePath);
+    // 与 getFilePathCache 相同，但宽限期内的过期项以 Stale 返回；
+    // 返回 Stale 时把过期时间推后一小段，期间的并发请求视为命中，只有第一个请求负责刷新
+    CacheLookup lookupFilePathCache(const std::string& fileId, std::string& filePath);
 
     // 删除缓存
     void deleteCache(const std::string& key);
@@ -61,6 +70,7 @@ private:
 
     std::mutex cacheMutex;
     size_t maxCacheSize;
+    int staleGraceSeconds;
     void cleanupExpiredRateLimitData();
     int cleanupIntervalSeconds;
     bool stopThread;
@@ -18,7 +18,10 @@ class PicGoHandler {
 public:
     PicGoHandler(const Config& config);
 
-    void handleUpload(const httplib::Request& req, httplib::Response& res, const std::string& userId, const std::string& userName, DBManager& dbManager);
+    // 请求体通过 contentReader 读取，文件逐块写入临时文件（upload.spool_dir）后再流式发往 Telegram
+    void handleUpload(const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& contentReader, const std::string& userId, const std::string& userName, DBManager& dbManager);
+    // 一次请求上传多个文件，返回每个文件的结果和链接
+    void handleBatchUpload(const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& contentReader, const std::string& userId, const std::string& userName, DBManager& dbManager);
     bool parseUrl(const std::string& url, std::string& host, bool& useSSL);
     bool createDirectoryIfNotExists(const std::string& path);
     std::string generateUniqueFilename(const std::string& originalName);
@@ -31,5 +34,6 @@ private:
     const Config& config;
 
     bool authenticate(const httplib::Request& req);
-    bool uploadToTelegram(const std::string& fileContent, const std::string& filename, MediaType mediaType, std::string& telegramFileId);
+    size_t getMaxFileBytes() const;
+    bool uploadToTelegram(const std::string& filePath, const std::string& filename, MediaType mediaType, std::string& telegramFileId);
 };
@@ -0,0 +1,138 @@
+#ifndef STATISTICSAGGREGATOR_H
+#define STATISTICSAGGREGATOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
+
+struct RequestRecord;
+
+// HyperLogLog 基数估计，用于在固定内存内统计唯一 IP 数
+class HyperLogLog {
+public:
+    static constexpr int kPrecision = 12;                       // 2^12 个寄存器，标准误差约 1.6%
+    static constexpr size_t kRegisterCount = size_t(1) << kPrecision;
+
+    HyperLogLog();
+
+    void add(const std::string& value);
+    void merge(const HyperLogLog& other);
+    uint64_t estimate() const;
+
+    // 序列化为寄存器字节串，用于持久化到汇总表；长度不符时返回空的 HyperLogLog
+    std::string serialize() const;
+    static HyperLogLog deserialize(const std::string& data);
+
+private:
+    std::vector<uint8_t> registers;
+};
+
+// 常用分位数快照（毫秒）
+struct LatencyPercentiles {
+    uint64_t count = 0;
+    int p50 = 0;
+    int p90 = 0;
+    int p99 = 0;
+    int p999 = 0;
+};
+
+// HDR 风格的对数-线性响应时间直方图（毫秒）：每个 2 的幂次区间再细分 32 个子桶，
+// 相对误差不超过 1/32，桶数固定，可合并、可序列化，分位数查询与请求量无关
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr size_t kSubBucketCount = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = 2 * kSubBucketCount + (30 - kSubBucketBits) * kSubBucketCount;  // 覆盖到 2^31 ms
+
+    LatencyHistogram();
+
+    void record(int responseTimeMs);
+    void merge(const LatencyHistogram& other);
+    uint64_t count() const;
+    int percentile(double p) const;  // 返回所在桶的上界
+    LatencyPercentiles percentiles() const;
+    uint64_t countAbove(int thresholdMs) const;  // 下界超过阈值的桶内请求数（近似）
+
+    // 稀疏编码（只写非零桶）；格式不符时返回空直方图
+    std::string serialize() const;
+    static LatencyHistogram deserialize(const std::string& data);
+
+private:
+    std::vector<uint64_t> buckets;
+    uint64_t total;
+
+    static size_t bucketIndex(int responseTimeMs);
+    static int64_t bucketLowerBound(size_t index);
+    static int64_t bucketUpperBound(size_t index);
+};
+
+// 统计用的路由名：取请求路径的第一段，如 /d/abc.jpg -> /d
+std::string routeOf(const std::string& requestPath);
+
+// 单个时间桶内的聚合结果，对应 service_usage 的一行
+struct UsageBucket {
+    int64_t periodStart = 0;  // 桶起始时间（Unix 秒）
+    int totalRequests = 0;
+    int successfulRequests = 0;
+    int failedRequests = 0;
+    int64_t totalRequestSize = 0;
+    int64_t totalResponseSize = 0;
+    int maxRequestSize = 0;
+    int maxResponseSize = 0;
+    int maxConcurrentRequests = 0;
+    int maxResponseTime = 0;
+    int64_t sumResponseTime = 0;
+    HyperLogLog uniqueIps;
+    LatencyHistogram responseTimes;
+    std::unordered_map<std::string, LatencyHistogram> routeResponseTimes;  // 按路由的响应时间直方图
+    std::unordered_map<std::string, int> urlCounts;
+
+    int averageResponseTime() const;
+};
+
+// 在内存中按时间桶聚合请求记录，桶关闭后才落库一次
+class StatisticsAggregator {
+public:
+    // bucketSeconds: 桶宽度（如 60 = 每分钟，3600 = 每小时）
+    // graceSeconds: 桶结束后继续等待迟到记录的时间
+    StatisticsAggregator(int bucketSeconds = 60, int graceSeconds = 5);
+
+    void add(const RequestRecord& record);
+
+    // 取出所有已经结束（超过宽限期）的桶
+    std::vector<UsageBucket> takeCompletedBuckets(const std::chrono::system_clock::time_point& now);
+
+    // 取出所有桶（用于退出前落库）
+    std::vector<UsageBucket> takeAllBuckets();
+
+    int getBucketSeconds() const;
+
+private:
+    int bucketSeconds;
+    int graceSeconds;
+    std::map<int64_t, UsageBucket> buckets;  // 以桶起始时间排序
+};
+
+// 进程内的实时响应时间窗口：按路由记录最近一到两个窗口的直方图，用于无需查库的实时分位数
+class LatencyWindow {
+public:
+    explicit LatencyWindow(int windowSeconds = 60);
+
+    void record(const std::string& route, int responseTimeMs, const std::chrono::steady_clock::time_point& now);
+
+    // route 为空时返回所有路由合并后的结果
+    LatencyPercentiles snapshot(const std::string& route, const std::chrono::steady_clock::time_point& now);
+
+private:
+    std::chrono::steady_clock::duration windowLength;
+    std::chrono::steady_clock::time_point windowStart;
+    std::unordered_map<std::string, LatencyHistogram> current;
+    std::unordered_map<std::string, LatencyHistogram> previous;
+
+    void rotate(const std::chrono::steady_clock::time_point& now);
+};
+
+#endif
@@ -5,43 +5,86 @@
 #include <vector>
 #include <tuple>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "db_manager.h"
+#include "StatisticsAggregator.h"
 
 // 定义 SQL 参数类型
 class SQLParam {
 public:
-    enum class Type { Text, Int, Double };
+    enum class Type { Text, Int, Int64, Double, Blob };
     Type type;
     std::string textValue;
     int intValue;
+    int64_t int64Value;
     double doubleValue;
 
     // 构造函数重载
     SQLParam(const std::string& val) : type(Type::Text), textValue(val) {}
     SQLParam(int val) : type(Type::Int), intValue(val) {}
+    SQLParam(int64_t val) : type(Type::Int64), int64Value(val) {}
     SQLParam(double val) : type(Type::Double), doubleValue(val) {}
+
+    // 二进制数据（如序列化后的 HyperLogLog）
+    static SQLParam blob(const std::string& val) {
+        SQLParam param(val);
+        param.type = Type::Blob;
+        return param;
+    }
+};
+
+// 单条请求统计记录，先写入内存环形缓冲区，再由后台线程批量落库
+struct RequestRecord {
+    std::string clientIp;
+    std::string requestPath;
+    std::string httpMethod;
+    std::string fileType;
+    int responseTime = 0;
+    int statusCode = 0;
+    int responseSize = 0;
+    int requestSize = 0;
+    int requestLatency = 0;
+    int concurrentRequests = 0;  // 请求开始时正在处理的请求数（含自身）
+    std::chrono::system_clock::time_point requestTime;
+};
+
+// 原始请求记录与汇总数据的保留策略
+struct StatisticsRetention {
+    int rawDays = 7;                // request_statistics / top_urls_period 保留天数
+    int minuteRollupDays = 2;       // 分钟汇总保留天数
+    int hourRollupDays = 90;        // 小时汇总、按天的维度汇总与 service_usage 保留天数
+    int deleteBatchSize = 1000;     // 每次清理最多删除的行数
 };
 
 class StatisticsManager {
 public:
-    StatisticsManager(DBManager& dbManager);
+    // bufferCapacity: 环形缓冲区容量，写满后丢弃新记录
+    // flushIntervalMs / flushBatchSize: 每隔 N 毫秒或累计 M 条记录触发一次批量写入
+    // bucketSeconds: service_usage / top_urls_period 的聚合桶宽度
+    // retention: 原始记录和汇总数据的保留策略，过期数据在后台分批清理
+    StatisticsManager(DBManager& dbManager, size_t bufferCapacity = 8192, int flushIntervalMs = 1000, size_t flushBatchSize = 512,
+                      int bucketSeconds = 60, const StatisticsRetention& retention = StatisticsRetention());
+    ~StatisticsManager();
 
-    // 插入请求统计
-    void insertRequestStatistics(const std::string& clientIp, const std::string& requestPath, const std::string& httpMethod,
-                                 int responseTime, int statusCode, int responseSize, int requestSize, const std::string& fileType, int requestLatency);
-    
-    void updateTopUrlsInTransaction(sqlite3* db, const std::chrono::time_point<std::chrono::system_clock>& periodStart, const std::string& url);
+    // 请求开始/结束时调用，用于统计并发请求数；beginRequest 返回当前并发数
+    int beginRequest();
+    void endRequest();
 
-    // 更新服务使用数据
-    void updateServiceUsage(const std::chrono::time_point<std::chrono::system_clock>& periodStart, int totalRequests, int successfulRequests,
-                            int failedRequests, int totalRequestSize, int totalResponseSize, int uniqueIps, int maxConcurrentRequests,
-                            int maxResponseTime, int avgResponseTime);
+    // 记录一次请求（非阻塞），缓冲区已满时丢弃并返回 false
+    bool recordRequest(RequestRecord record);
 
-    // 更新某个时间段内的 URL 访问次数
-    void updateTopUrlsByPeriod(const std::chrono::time_point<std::chrono::system_clock>& periodStart, const std::string& url);
+    // 立即将缓冲区中的记录写入数据库
+    void flush();
 
-    // 更新历史 URL 访问次数
-    void updateTopUrlsByHistory(const std::string& url);
+    // 因缓冲区已满或写库失败而被丢弃的记录数
+    size_t getDroppedRecordCount() const;
+
+    // 插入请求统计
+    void insertRequestStatistics(const std::string& clientIp, const std::string& requestPath, const std::string& httpMethod,
+                                 int responseTime, int statusCode, int responseSize, int requestSize, const std::string& fileType, int requestLatency);
 
     // 获取统计数据的各种函数
     int getTotalRequests();
@@ -57,6 +100,13 @@ public:
     int getAverageResponseTime();
     int getMaxResponseTime();
     int get95thPercentileResponseTime();
+
+    // 响应时间分位数（p50/p90/p99/p999），route 为空表示所有路由
+    // getLiveResponseTimePercentiles: 进程内最近一到两分钟的数据，不查库
+    // getResponseTimePercentiles: 合并 periodStart 之后的路由汇总直方图，耗时只与时间范围有关
+    LatencyPercentiles getLiveResponseTimePercentiles(const std::string& route = "");
+    LatencyPercentiles getResponseTimePercentiles(const std::chrono::time_point<std::chrono::system_clock>& periodStart,
+                                                  const std::string& route = "");
     std::vector<std::tuple<std::string, int>> getResponseTimeDistribution();
     float getFailureRate();
     int getTimeoutRequestCount(int timeoutThreshold);
@@ -69,8 +119,48 @@ public:
 private:
     DBManager& dbManager;
 
-    // 执行 SQL 插入或更新
-    void executeSQL(sqlite3* db, const std::string& query, const std::vector<SQLParam>& params);
+    // 环形缓冲区
+    std::vector<RequestRecord> ringBuffer;
+    size_t ringHead;
+    size_t ringSize;
+    std::mutex bufferMutex;
+    std::condition_variable bufferCondition;
+    std::atomic<size_t> droppedRecords;
+
+    // 后台写入线程
+    int flushIntervalMs;
+    size_t flushBatchSize;
+    bool stopWriter;
+    std::thread writerThread;
+    std::mutex flushMutex;  // 保证同一时间只有一个批次在写入
+
+    // 内存聚合（只在持有 flushMutex 时访问）
+    StatisticsAggregator aggregator;
+    std::atomic<int> inFlightRequests;
+
+    // 实时响应时间窗口，在请求线程中记录
+    LatencyWindow liveLatency;
+    std::mutex liveLatencyMutex;
+
+    void writerLoop();
+    void flushPending(bool persistOpenBuckets);
+    size_t drainBuffer(std::vector<RequestRecord>& batch, size_t maxRecords);
+    void writeBatch(const std::vector<RequestRecord>& batch);
+    void persistBuckets(const std::vector<UsageBucket>& completedBuckets);
+
+    // 分钟/小时/天汇总表与按维度汇总表的增量维护
+    StatisticsRetention retention;
+    std::chrono::steady_clock::time_point lastRetentionRun;
+    bool retentionBacklog;
+
+    void updateRollups(sqlite3* db, const std::vector<RequestRecord>& batch);
+    void updateRouteRollups(sqlite3* db, int granularity, const UsageBucket& bucket);
+    void backfillRollups();
+    void applyRetention();
+    int deleteExpiredRows(sqlite3* db, const std::string& table, const std::string& condition, int64_t threshold);
+
+    // 合并查询结果中的 HyperLogLog（第 1 列）和响应时间直方图（第 2 列）
+    void mergeSketches(const std::string& query, const std::vector<SQLParam>& params, HyperLogLog* uniqueIps, LatencyHistogram* responseTimes);
 
     // 执行统计查询，返回计数结果
     int executeCountQuery(const std::string& query, const std::vector<SQLParam>& params);
@@ -79,4 +169,21 @@ private:
     std::vector<std::tuple<std::string, int>> executeDistributionQuery(const std::string& query);
 };
 
-#endif  
+// 在请求生命周期内维护并发计数
+class InFlightRequest {
+public:
+    explicit InFlightRequest(StatisticsManager& statisticsManager)
+        : statisticsManager(statisticsManager), concurrentRequests(statisticsManager.beginRequest()) {}
+    ~InFlightRequest() { statisticsManager.endRequest(); }
+
+    InFlightRequest(const InFlightRequest&) = delete;
+    InFlightRequest& operator=(const InFlightRequest&) = delete;
+
+    int getConcurrentRequests() const { return concurrentRequests; }
+
+private:
+    StatisticsManager& statisticsManager;
+    int concurrentRequests;
+};
+
+#endif
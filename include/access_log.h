@@ -0,0 +1,74 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+
+struct AccessLogOptions {
+    bool enabled = false;
+    std::string path = "access.log";
+    double sampleRate = 1.0;                // 成功请求的采样率，5xx 和慢请求总是记录
+    int slowRequestMs = 1000;               // 超过该耗时的请求总是记录
+    size_t maxFileBytes = 64 * 1024 * 1024; // 超过后轮转为 access.log.1 ...
+    int maxFiles = 5;                       // 保留的历史文件数
+    size_t bufferCapacity = 65536;          // 待写出的最大行数，写满后丢弃
+};
+
+// 单条访问记录，耗时单位为微秒
+struct AccessLogRecord {
+    std::chrono::system_clock::time_point time;
+    std::string clientIp;
+    std::string method;
+    std::string path;
+    int status = 0;
+    size_t requestBytes = 0;
+    size_t responseBytes = 0;
+    int64_t totalMicros = 0;     // 路由前处理到发送完成
+    int64_t queueMicros = 0;     // HTTP 线程池排队
+    int64_t handlerMicros = 0;   // 路由处理（含 db / upstream）
+    int64_t dbMicros = 0;
+    int64_t upstreamMicros = 0;
+    int64_t sendMicros = 0;      // 写出响应
+    const char* cacheResult = "none";
+};
+
+// 结构化访问日志（JSON Lines），请求线程只做采样判断和格式化，由后台线程批量写出并按大小轮转
+class AccessLog {
+public:
+    explicit AccessLog(const AccessLogOptions& options);
+    ~AccessLog();
+
+    bool isEnabled() const { return options.enabled; }
+
+    // 是否需要记录该请求（采样），应在构造记录之前调用
+    bool shouldRecord(int status, int64_t totalMicros) const;
+
+    void record(const AccessLogRecord& record);
+
+    static std::string formatRecord(const AccessLogRecord& record);
+
+private:
+    AccessLogOptions options;
+
+    std::mutex bufferMutex;
+    std::condition_variable bufferCondition;
+    std::vector<std::string> pending;
+    bool stopWriter;
+    std::thread writerThread;
+
+    std::FILE* file;
+    size_t fileBytes;
+
+    void writerLoop();
+    void writeLines(const std::vector<std::string>& lines);
+    void openFile();
+    void rotate();
+};
+
+#endif
@@ -34,6 +34,10 @@ public:
     void editMessageWithKeyboard(const std::string& chatId, const std::string& messageId, const std::string& message, const std::string& keyboard);
 
 private:
+    // 回复消息不需要等待结果：交给 TelegramScheduler 按限速发送，同一个聊天的请求按顺序执行，失败自动重试
+    // coalesceKey 非空时，尚未发出的同 key 请求只保留最新的一个
+    void sendReply(const std::string& chatId, const std::string& url, const std::string& coalesceKey = "");
+
     std::string apiToken;
     std::string telegramApiUrl;
     std::string ownerId;
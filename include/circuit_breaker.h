@@ -0,0 +1,43 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <mutex>
+#include <chrono>
+
+struct CircuitBreakerOptions {
+    int failureThreshold = 5;   // 连续失败次数达到该值时断开
+    int openSeconds = 30;       // 断开后经过该时间放行一个探测请求
+};
+
+// 熔断器：上游连续失败后在一段时间内直接拒绝请求，调用方快速失败，而不是每个请求都等到超时占住工作线程；
+// 断开期满后进入半开状态，只放行一个探测请求，成功则恢复，失败则重新断开
+class CircuitBreaker {
+public:
+    enum class State { Closed, Open, HalfOpen };
+
+    explicit CircuitBreaker(const CircuitBreakerOptions& options = CircuitBreakerOptions());
+
+    void configure(const CircuitBreakerOptions& options);
+
+    // 请求前调用，返回 false 时应直接失败；返回 true 的请求结束后调用 recordSuccess 或 recordFailure
+    bool allowRequest();
+    void recordSuccess();
+    void recordFailure();
+
+    State getState();
+    // 断开（含半开）时距离下一次探测的秒数，用于 Retry-After；闭合时返回 0
+    int getRetryAfterSeconds();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex mutex;
+    CircuitBreakerOptions options;
+    State state;
+    int consecutiveFailures;
+    Clock::time_point openedAt;
+    Clock::time_point probeStartedAt;
+    bool probeInFlight;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <vector>
+
+// 响应内容编码；Brotli 和 Zstd 只有在编译时找到对应的库（BROTLI_SUPPORT / ZSTD_SUPPORT）才会协商出来
+enum class ContentEncoding { Identity, Gzip, Brotli, Zstd };
+
+// Content-Encoding 中使用的名称（gzip / br / zstd），Identity 返回空字符串
+const char* contentEncodingName(ContentEncoding encoding);
+
+// 缓存压缩结果时使用的文件后缀（.gz / .br / .zst）
+const char* contentEncodingSuffix(ContentEncoding encoding);
+
+// 按 Accept-Encoding（支持 q 值和 *）选出本服务支持的编码，q 值相同时依次优先 br、zstd、gzip
+ContentEncoding negotiateContentEncoding(const std::string& acceptEncoding);
+
+// mimeType 是否属于可压缩类型：compressibleTypes 中以 / 结尾的项按前缀匹配一整类（如 text/），其余项需完全一致，
+// 参数部分（; charset=...）和大小写不影响匹配
+bool isCompressibleMimeType(const std::string& mimeType, const std::vector<std::string>& compressibleTypes);
+
+// 按指定编码压缩，失败时抛出 std::runtime_error；Identity 原样返回
+std::string compressContent(const std::string& data, ContentEncoding encoding);
+
+#endif
@@ -27,9 +27,86 @@ public:
     int getRateLimitRequestsPerMinute() const;
     std::string getTelegramChannelId() const;
 
+    // 统计写入配置
+    int getStatisticsBufferCapacity() const;
+    int getStatisticsFlushIntervalMs() const;
+    int getStatisticsFlushBatchSize() const;
+    int getStatisticsBucketSeconds() const;
+    int getStatisticsRawRetentionDays() const;
+    int getStatisticsMinuteRollupRetentionDays() const;
+    int getStatisticsHourRollupRetentionDays() const;
+    int getStatisticsRetentionBatchSize() const;
+    bool getMetricsEnabled() const;
+    std::string getLogLevel() const;
+    std::string getLogFile() const;
+    bool getLogToConsole() const;
+    bool getAccessLogEnabled() const;
+    std::string getAccessLogPath() const;
+    double getAccessLogSampleRate() const;
+    int getAccessLogSlowRequestMs() const;
+    int getAccessLogMaxSizeMB() const;
+    int getAccessLogMaxFiles() const;
+    bool getChromeTraceEnabled() const;
+    std::string getChromeTracePath() const;
+    int getChromeTraceMaxEvents() const;
+    int getServerListeners() const;
+    int getServerWorkerThreads() const;
+    int getServerMaxQueuedConnections() const;
+    int getServerListenBacklog() const;
+    int getServerKeepAliveMaxCount() const;
+    int getServerKeepAliveTimeoutSeconds() const;
+    int getServerReadTimeoutSeconds() const;
+    int getServerWriteTimeoutSeconds() const;
+    int getThreadPoolMinThreads() const;
+    int getThreadPoolMaxThreads() const;
+    int getThreadPoolIdleTimeoutMs() const;
+    // lane 为 high / normal / low
+    int getThreadPoolQueueCapacity(const std::string& lane) const;
+    std::string getThreadPoolOverflowPolicy(const std::string& lane) const;
+    int getHttpClientMaxIdleHandles() const;
+    bool getHttpClientHttp2() const;
+    int getHttpClientConnectTimeoutSeconds() const;
+    int getHttpClientMaxHostConnections() const;
+    bool getEventServerEnabled() const;
+    std::string getEventServerHostname() const;
+    int getEventServerPort() const;
+    int getEventServerThreads() const;
+    int getEventServerMinWorkerThreads() const;
+    int getEventServerMaxWorkerThreads() const;
+    int getEventServerMaxConnections() const;
+    int getEventServerIdleTimeoutSeconds() const;
+    int getEventServerListenBacklog() const;
+    int getCacheStaleGraceSeconds() const;
+    int getCircuitBreakerFailureThreshold() const;
+    int getCircuitBreakerOpenSeconds() const;
+    int getTelegramOutboundGlobalPerSecond() const;
+    int getTelegramOutboundPrivateChatIntervalMs() const;
+    int getTelegramOutboundGroupPerMinute() const;
+    int getTelegramOutboundMaxRetries() const;
+    int getTelegramOutboundBaseBackoffMs() const;
+    int getTelegramOutboundMaxBackoffMs() const;
+    int getTelegramOutboundMaxQueuedPerChat() const;
+    int getUploadMaxBatchFiles() const;
+    int getUploadMaxParallelUploads() const;
+    int getUploadMaxFileSizeMb() const;
+    std::string getUploadSpoolDir() const;
+    // 响应压缩策略：只压缩 compression.types 中的类型，大小在 [min_size_bytes, max_size_bytes] 之间
+    bool getCompressionEnabled() const;
+    std::vector<std::string> getCompressionTypes() const;
+    int getCompressionMinSizeBytes() const;
+    int getCompressionMaxSizeBytes() const;
 
 private:
     nlohmann::json configData;
+
+    // 读取可选配置项，缺失时返回默认值
+    template<typename T>
+    T getOptional(const std::string& section, const std::string& key, const T& defaultValue) const {
+        if (configData.contains(section) && configData[section].contains(key)) {
+            return configData[section][key].get<T>();
+        }
+        return defaultValue;
+    }
 };
 
 #endif
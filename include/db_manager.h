@@ -13,6 +13,18 @@
 #include <atomic>
 #include <thread>
 
+// files 表中的一条记录，供批量写入使用
+struct FileRecord {
+    std::string userId;
+    std::string fileId;
+    std::string fileLink;
+    std::string fileName;
+    std::string shortId;
+    std::string shortLink;
+    std::string extension;
+    std::string contentHash;   // 上传内容的 SHA-256（十六进制），为空表示未知
+};
+
 class DBManager {
 public:
     static DBManager& getInstance(const std::string& dbFile = "bot_database.db", int maxPoolSize = 20, int maxIdleTimeSeconds = 60);
@@ -27,6 +39,8 @@ public:
     bool createTables();
     bool addUserIfNotExists(const std::string& telegramId, const std::string& username);
     bool addFile(const std::string& userId, const std::string& fileId, const std::string& fileLink, const std::string& fileName, const std::string& shortId, const std::string& shortLink, const std::string& extension);
+    // 在同一个事务中写入多条记录（已存在的 file_id 更新），任一条失败时全部回滚
+    bool addFiles(const std::vector<FileRecord>& files);
     bool removeFile(const std::string& userId, const std::string& fileId);
     bool banUser(const std::string& telegramId);
     bool unbanUser(const std::string& telegramId);
@@ -41,6 +55,8 @@ public:
     std::vector<std::tuple<std::string, std::string, bool>> getUsersForBan(int page, int pageSize);
     std::vector<std::tuple<std::string, std::string, std::string, std::string>> getImagesAndVideos(int page, int pageSize);
     std::string getFileIdByShortId(const std::string& shortId);
+    // 按上传内容的哈希查找已上传过的文件，找到时返回 true
+    bool getFileByContentHash(const std::string& contentHash, std::string& fileId, std::string& shortId);
 
 private:
     std::string dbFile;
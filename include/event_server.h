@@ -0,0 +1,126 @@
+#ifndef EVENT_SERVER_H
+#define EVENT_SERVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <chrono>
+#include "thread_pool.h"
+
+struct EventServerOptions {
+    std::string hostname = "127.0.0.1";
+    int port = 8081;
+    int loopThreads = 2;                // 事件循环线程数，每个线程有自己的 epoll 和 SO_REUSEPORT 监听套接字
+    int minWorkerThreads = 2;           // 处理请求（查库、下载）的线程池，可以阻塞
+    int maxWorkerThreads = 8;
+    int listenBacklog = 1024;
+    size_t maxConnections = 20000;
+    int idleTimeoutSeconds = 60;        // 空闲或发送无进展超过该时间的连接被关闭
+    size_t maxRequestHeaderBytes = 16384;
+};
+
+// 事件循环解析出的请求，只支持 GET / HEAD，不读取请求体
+struct EventRequest {
+    std::string method;
+    std::string path;                             // 不含查询字符串
+    std::string remoteAddr;
+    std::map<std::string, std::string> headers;   // 名称已转为小写
+    std::chrono::steady_clock::time_point receivedAt;
+
+    std::string header(const std::string& name) const;
+};
+
+// 请求结束（发送完成或连接中断）时的汇总
+struct EventRequestLog {
+    int status = 0;
+    size_t bytesSent = 0;
+    bool completed = false;
+    std::chrono::steady_clock::time_point dispatchedAt;   // 交给线程池
+    std::chrono::steady_clock::time_point handledAt;      // 处理完成，开始发送
+    std::chrono::steady_clock::time_point finishedAt;
+};
+
+// 处理结果：fileFd >= 0 时用 sendfile 发送文件（由 EventServer 关闭），否则发送 body
+// 200 响应会按请求的 Range 头自动转为 206 / 416
+struct EventResponse {
+    int status = 200;
+    std::string contentType = "text/plain";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    int fileFd = -1;
+    size_t fileSize = 0;
+    // 发送结束后在事件循环线程中调用，不能阻塞
+    std::function<void(const EventRequestLog&)> onComplete;
+};
+
+// 基于 epoll 的事件驱动 HTTP 服务（仅 Linux），用于媒体文件下载：
+// 连接的读写都在少量事件循环线程中以非阻塞方式完成，只有请求处理本身进入线程池，
+// 慢速客户端下载大文件时不会占用工作线程；磁盘缓存文件通过 sendfile 零拷贝发送
+class EventServer {
+public:
+    // 交付处理结果，可以在任意线程中调用，只有第一次调用有效；
+    // 所有副本都被销毁仍未调用时（例如处理函数抛出异常）自动返回 500
+    using Responder = std::function<void(EventResponse&&)>;
+    // 在线程池中调用，可以阻塞；也可以发起异步请求后立即返回，在回调中再调用 respond
+    using Handler = std::function<void(const EventRequest&, Responder respond)>;
+
+    EventServer(const EventServerOptions& options, Handler handler);
+    ~EventServer();
+
+    EventServer(const EventServer&) = delete;
+    EventServer& operator=(const EventServer&) = delete;
+
+    // 绑定端口并启动事件循环线程，失败时返回 false
+    bool start();
+    void stop();
+
+    size_t getConnectionCount() const { return connectionCount.load(std::memory_order_relaxed); }
+    ThreadPool& getWorkerPool() { return *workerPool; }
+
+private:
+    struct Connection;
+    struct Loop;
+    struct PendingResponse;
+
+    // 解析结果：Responded 表示已发送错误响应，连接可能已经关闭（Connection 已释放）
+    enum class ParseResult { Incomplete, Responded, Ready };
+
+    EventServerOptions options;
+    Handler handler;
+
+    std::vector<std::unique_ptr<Loop>> loops;
+    std::unique_ptr<ThreadPool> workerPool;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> connectionCount;
+    bool started;
+
+    // 已分发但尚未交付结果的请求数，stop() 等它归零后才释放事件循环
+    std::mutex pendingMutex;
+    std::condition_variable pendingDone;
+    size_t pendingResponses;
+
+    void runLoop(Loop& loop);
+    void acceptConnections(Loop& loop);
+    void handleEvent(Loop& loop, Connection& connection, uint32_t events);
+    void readRequest(Loop& loop, Connection& connection);
+    ParseResult parseRequest(Loop& loop, Connection& connection);
+    void dispatch(Loop& loop, Connection& connection);
+    void deliver(Loop& loop, int fd, uint64_t generation, EventResponse&& response);
+    void releasePending();
+    void processCompletions(Loop& loop);
+    void startResponse(Loop& loop, Connection& connection, EventResponse&& response);
+    void sendError(Loop& loop, Connection& connection, int status, const std::string& message);
+    void writeResponse(Loop& loop, Connection& connection);
+    void finishResponse(Loop& loop, Connection& connection);
+    void closeConnection(Loop& loop, Connection& connection);
+    void closeIdleConnections(Loop& loop);
+    void updateInterest(Loop& loop, Connection& connection, uint32_t events);
+};
+
+#endif
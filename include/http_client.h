@@ -2,9 +2,78 @@
 #define HTTP_CLIENT_H
 
 #include <string>
+#include <vector>
+#include <curl/curl.h>
+#include "circuit_breaker.h"
+
+// Telegram API 客户端的全局设置，在发出第一个请求之前调用 configureHttpClient
+struct HttpClientOptions {
+    size_t maxIdleHandles = 16;        // 池中保留的空闲 curl 句柄上限，超出的句柄归还时直接释放
+    bool http2 = true;                 // 通过 ALPN 协商 HTTP/2（libcurl 不支持时回退到 HTTP/1.1）
+    long connectTimeoutSeconds = 10;
+    long maxHostConnections = 32;      // 异步引擎到同一主机的最大并发连接数（HTTP/2 时请求在连接上多路复用）
+};
+
+void configureHttpClient(const HttpClientOptions& options);
+HttpClientOptions getHttpClientOptions();
+// 设置 Telegram 请求的通用选项（超时、keep-alive、HTTP/2、NOSIGNAL），供不经过句柄池的 curl 句柄使用
+void applyUpstreamDefaults(CURL* curl);
+
+// 从句柄池借出的 curl easy 句柄，析构时归还
+// 所有句柄共享同一个 CURLSH（DNS 缓存、TLS 会话、连接缓存），因此到 api.telegram.org 的连接会被后续请求复用
+// 借出时已设置好通用选项（超时、keep-alive、HTTP/2、NOSIGNAL），调用方只需设置 URL 和回调
+class PooledCurlHandle {
+public:
+    PooledCurlHandle();
+    ~PooledCurlHandle();
+
+    PooledCurlHandle(const PooledCurlHandle&) = delete;
+    PooledCurlHandle& operator=(const PooledCurlHandle&) = delete;
+
+    CURL* get() const { return handle; }
+    explicit operator bool() const { return handle != nullptr; }
+
+private:
+    CURL* handle;
+};
+
+struct HttpResponse {
+    bool ok = false;       // 传输是否成功，不代表 HTTP 状态码
+    long status = 0;
+    std::string body;
+};
+
+// multipart/form-data 的一个字段，filename 非空时作为文件上传
+// filePath 非空时在发送过程中从该文件逐块读取内容（忽略 content），大文件不需要整个载入内存
+struct HttpFormField {
+    std::string name;
+    std::string content;
+    std::string filename;
+    std::string contentType;
+    std::string filePath;
+};
+
+// 按 fields 填充 curl 的 multipart 表单
+void fillMimeParts(curl_mime* mime, const std::vector<HttpFormField>& fields);
 
 std::string sendHttpRequest(const std::string& url);
+HttpResponse postJson(const std::string& url, const std::string& body, long timeoutSeconds);
+HttpResponse postMultipart(const std::string& url, const std::vector<HttpFormField>& fields, long timeoutSeconds);
+
+// Telegram API 的熔断器：同步请求（performUpstreamRequest）和异步引擎共用
+CircuitBreaker& getTelegramCircuitBreaker();
+// 熔断器断开时拒绝请求前调用，记录被拒绝的次数
+void recordUpstreamRejected();
+
+// 执行已设置好的请求，记录上游耗时、失败次数和新建连接数；熔断器断开时不发出请求，直接返回 CURLE_COULDNT_CONNECT
+CURLcode performUpstreamRequest(CURL* curl);
+// 请求结束后记录上游指标和熔断器结果（performUpstreamRequest 和异步引擎共用）
+void recordUpstreamTransfer(CURL* curl, double durationSeconds, CURLcode result);
+
 std::string buildTelegramUrl(const std::string& text);
 std::string escapeTelegramUrl(const std::string& text);
 
+// 记录一次 Telegram 上游请求（供直接使用 curl/httplib 的调用方复用同一组指标）
+void recordUpstreamRequest(double durationSeconds, bool failed);
+
 #endif
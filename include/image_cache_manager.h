@@ -16,6 +16,16 @@ public:
     
     void cacheImage(const std::string& fileId, const std::string& imageData, const std::string& extension);
     std::string getCachedImage(const std::string& fileId, const std::string& extension);
+    // 以只读方式打开缓存文件（用于 sendfile 零拷贝发送），未命中返回 -1；调用方负责 close
+    int openCachedImage(const std::string& fileId, const std::string& extension, size_t& fileSize);
+    // 下载文件时使用的临时文件路径，位于缓存目录中，下载完成后可以直接改名为缓存文件
+    std::string getDownloadPath(const std::string& fileId) const;
+    // 打开下载完成的临时文件（调用方负责 close）：keep 为 true 时改名为缓存文件，否则删除目录项，
+    // 两种情况下描述符都保持有效，可以直接用 sendfile 发送；失败或文件为空时返回 -1 并删除临时文件
+    int openDownloadedFile(const std::string& downloadPath, const std::string& fileId, const std::string& extension,
+                           bool keep, size_t& fileSize);
+    // 缓存超过磁盘上限时删除最旧的文件；需要扫描缓存目录，应在后台线程中调用
+    void enforceDiskLimit();
 
 private:
     std::string cacheDir;
@@ -0,0 +1,127 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 缓存行大小，计数器按缓存行对齐以避免多核之间的伪共享
+constexpr size_t kCacheLineSize = 64;
+
+// 单调递增计数器：记录一次只需要一次原子加
+class alignas(kCacheLineSize) Counter {
+public:
+    void inc(uint64_t delta = 1) { value.fetch_add(delta, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+// 可增可减的瞬时值
+class alignas(kCacheLineSize) Gauge {
+public:
+    void set(int64_t newValue) { value.store(newValue, std::memory_order_relaxed); }
+    void add(int64_t delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value{0};
+};
+
+// 固定桶边界的直方图（单位：秒），记录一次为三次原子加
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> upperBounds);
+
+    void observe(double value);
+
+    // 导出用：各桶的非累计计数（最后一个为 +Inf）、总和与总数
+    std::vector<uint64_t> bucketCounts() const;
+    double sum() const;
+    uint64_t count() const;
+    const std::vector<double>& getUpperBounds() const { return upperBounds; }
+
+    // 常用的延迟桶边界：1ms ~ 30s
+    static std::vector<double> latencyBuckets();
+
+private:
+    std::vector<double> upperBounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    alignas(kCacheLineSize) std::atomic<uint64_t> sumMicros{0};  // 以 1e-6 为单位累加，避免浮点原子操作
+    alignas(kCacheLineSize) std::atomic<uint64_t> total{0};
+};
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// 全局指标注册表，以 Prometheus 文本格式导出
+// 注册（counter/gauge/histogram）需要加锁，调用方应在初始化时取得引用并缓存，热路径上只做原子操作
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance();
+
+    // 同名同标签重复注册时返回同一个实例
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const MetricLabels& labels = {},
+                         const std::vector<double>& upperBounds = Histogram::latencyBuckets());
+
+    // 导出时才求值的指标（如线程池队列长度），type 为 "gauge" 或 "counter"
+    void callback(const std::string& name, const std::string& help, const std::string& type, const MetricLabels& labels,
+                  std::function<double()> valueFunction);
+
+    // 生成 Prometheus 文本格式（text/plain; version=0.0.4）
+    std::string render() const;
+
+private:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    struct Series {
+        std::string labels;  // 已格式化的标签，如 {route="/d",status="2xx"}
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> valueFunction;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        std::string type;
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    mutable std::mutex registryMutex;
+    std::vector<std::unique_ptr<Family>> families;  // 按注册顺序导出
+    std::map<std::string, Family*> familyIndex;
+
+    Series& getOrCreateSeries(const std::string& name, const std::string& help, const std::string& type, const MetricLabels& labels);
+};
+
+// 请求路由相关的指标：按状态码类别计数、处理耗时和响应字节数
+struct RouteMetrics {
+    Counter* responses[5];  // 1xx ~ 5xx
+    Histogram* duration;
+    Counter* bytesServed;
+
+    explicit RouteMetrics(const std::string& route);
+    void observe(int status, double durationSeconds, size_t bytes);
+};
+
+// 缓存命中/未命中计数（tier: memory / disk）
+struct CacheTierMetrics {
+    Counter* hits;
+    Counter* misses;
+
+    explicit CacheTierMetrics(const std::string& tier);
+    void record(bool hit) { (hit ? hits : misses)->inc(); }
+};
+
+#endif
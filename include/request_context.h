@@ -0,0 +1,34 @@
+#ifndef REQUEST_CONTEXT_H
+#define REQUEST_CONTEXT_H
+
+#include <chrono>
+#include <cstdint>
+
+// 当前请求在处理线程上的上下文，记录各阶段耗时与缓存命中情况
+// httplib 在同一个线程中完成解析、路由前处理、路由、发送和日志回调，因此使用 thread_local 即可，无需在调用链中传递
+struct RequestContext {
+    std::chrono::steady_clock::time_point receivedAt;  // 请求头解析完成（路由前处理）
+    std::chrono::steady_clock::time_point handledAt;   // 处理完成，开始发送响应（路由后处理）
+    int64_t queueMicros = 0;     // 连接在 HTTP 线程池队列中等待的时间（仅连接上的第一个请求）
+    int64_t dbMicros = 0;        // 持有数据库连接的累计时间（含等待连接池）
+    int64_t upstreamMicros = 0;  // 请求 Telegram 的累计时间
+    const char* cacheResult = "none";  // disk_hit / memory_hit / stale / miss / none，只能指向静态字符串
+
+    static RequestContext& current();
+
+    // 新请求开始时重置上下文
+    void begin(const std::chrono::steady_clock::time_point& now);
+};
+
+// 由 HTTP 线程池在开始处理连接时调用，记录连接的排队时间，下一次 begin() 时计入
+void setConnectionQueueMicros(int64_t micros);
+
+// 数据库连接获取与归还时调用，累计到当前请求的 dbMicros
+void markDbAcquireStart();
+void markDbReleased();
+
+inline int64_t elapsedMicros(const std::chrono::steady_clock::time_point& from, const std::chrono::steady_clock::time_point& to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+#endif
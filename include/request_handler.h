@@ -3,11 +3,14 @@
 
 #include <string>
 #include <map>
+#include <functional>
+#include <cstdint>
 #include <httplib.h>
 #include "image_cache_manager.h"
 #include "db_manager.h"
 #include "config.h"
 #include "CacheManager.h"
+#include "thread_pool.h"
 
 // 获取文件的 MIME 类型
 std::string getMimeType(const std::string& filePath, const std::map<std::string, std::string>& mimeTypes, const std::string& defaultMimeType);
@@ -22,9 +25,47 @@ size_t streamWriteCallback(void* ptr, size_t size, size_t nmemb, httplib::Respon
 void handleStreamRequest(const httplib::Request& req, httplib::Response& res, const std::string& fileDownloadUrl, const std::string& mimeType);
 
 // 处理图片、非视频和非文档文件的缓存请求
-void handleImageRequest(const httplib::Request& req, httplib::Response& res, const std::string& apiToken, const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager,CacheManager& memoryCache, const std::string& telegramApiUrl, const Config& config, DBManager& dbManager);
+void handleImageRequest(const httplib::Request& req, httplib::Response& res, const std::string& apiToken, const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager,CacheManager& memoryCache, const std::string& telegramApiUrl, const Config& config, DBManager& dbManager, ThreadPool& backgroundPool);
+
+// 短链接转换为 fileId 并校验格式，不合法时返回空字符串
+std::string resolveFileId(const std::string& shortId, DBManager& dbManager);
+
+// 调用 getFile 获取文件在 Telegram 上的路径并写入内存缓存，返回 HTTP 状态码（失败时填写 errorMessage）
+int fetchTelegramFilePath(const std::string& fileId, const std::string& apiToken, const std::string& telegramApiUrl,
+                          CacheManager& memoryCache, std::string& filePath, std::string& errorMessage);
+
+// 在后台重新调用 getFile 刷新内存缓存中的文件路径（stale-while-revalidate），失败时保留旧值
+void revalidateTelegramFilePath(const std::string& fileId, const std::string& apiToken, const std::string& telegramApiUrl,
+                                CacheManager& memoryCache);
+
+// 媒体文件的解析结果：status 为 200 时 fileFd 是已打开的文件描述符（由调用方关闭），
+// 磁盘缓存未命中时内容先下载到缓存目录，不在内存中保留
+struct MediaFile {
+    int status = 500;
+    std::string contentType;
+    std::string errorMessage;   // status 不是 200 时的响应内容
+    int fileFd = -1;
+    size_t fileSize = 0;
+    // 以下同 RequestContext 中的字段：done 可能不在请求线程中调用，无法直接累计到 RequestContext
+    const char* cacheResult = "none";
+    int64_t dbMicros = 0;
+    int64_t upstreamMicros = 0;
+};
+
+using MediaCallback = std::function<void(MediaFile&&)>;
+
+// 解析媒体请求，供事件驱动服务在线程池中调用：短链接、内存缓存和磁盘缓存在调用线程中完成，
+// 需要访问 Telegram 时通过 UpstreamEngine 异步请求并立即返回，done 随后在引擎线程中调用（不能阻塞）
+void resolveMediaFile(const std::string& shortId, bool acceptsWebp, const std::string& apiToken,
+                      const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager,
+                      CacheManager& memoryCache, const std::string& telegramApiUrl, DBManager& dbManager,
+                      ThreadPool& backgroundPool, MediaCallback done);
 
 std::string getBaseUrl(const std::string& url);
-void setHttpResponse(httplib::Response& res, const std::string& fileData, const std::string& mimeType, const httplib::Request& req);
+// 写入文件响应：可压缩的类型按 Accept-Encoding 协商编码，压缩结果缓存在 memoryCache 和 cacheManager 中；
+// extension 与磁盘缓存原文件使用的扩展名一致
+void setHttpResponse(httplib::Response& res, const std::string& fileData, const std::string& mimeType, const httplib::Request& req,
+                     const std::string& fileId, const std::string& extension, const Config& config,
+                     ImageCacheManager& cacheManager, CacheManager& memoryCache, ThreadPool& backgroundPool);
 
 #endif
\ No newline at end of file
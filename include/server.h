@@ -21,7 +21,7 @@ void handleMediaRequest(const httplib::Request& req, httplib::Response& res, con
 
 // 处理请求统计信息
 void handleRequestStatistics(const httplib::Request& req, httplib::Response& res, const std::string& requestPath,
-                             StatisticsManager& statisticsManager, ThreadPool& pool, int responseTime, int requestLatency);
+                             StatisticsManager& statisticsManager, int responseTime, int requestLatency, int concurrentRequests);
 
 // 确定文件类型
 std::string determineFileType(const std::string& requestPath);
@@ -35,6 +35,7 @@ void startServer(const Config& config, ImageCacheManager& cacheManager, ThreadPo
 // 处理图片请求
 void handleImageRequest(const httplib::Request& req, httplib::Response& res, const std::string& apiToken,
                         const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager,
-                        CacheManager& memoryCache, const std::string& telegramApiUrl, const Config& config, DBManager& dbManager);
+                        CacheManager& memoryCache, const std::string& telegramApiUrl, const Config& config, DBManager& dbManager,
+                        ThreadPool& backgroundPool);
 
 #endif 
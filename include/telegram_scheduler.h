@@ -0,0 +1,111 @@
+#ifndef TELEGRAM_SCHEDULER_H
+#define TELEGRAM_SCHEDULER_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <random>
+#include <chrono>
+#include "upstream_engine.h"
+
+// Telegram 的发送限制（https://core.telegram.org/bots/faq#my-bot-is-hitting-limits-how-do-i-avoid-this）
+struct TelegramSchedulerOptions {
+    int globalPerSecond = 30;           // 所有聊天合计每秒发送数
+    int privateChatIntervalMs = 1000;   // 同一私聊两次发送的最小间隔
+    int groupPerMinute = 20;            // 同一群组/频道每分钟发送数
+    int maxRetries = 5;                 // 429、5xx 和传输失败的重试次数
+    int baseBackoffMs = 500;            // 第一次重试前的最长等待，之后每次翻倍（带随机抖动）
+    int maxBackoffMs = 30000;
+    size_t maxQueuedPerChat = 100;      // 单个聊天的排队上限，超出时丢弃最旧的消息
+};
+
+// Telegram 出站请求调度：在 UpstreamEngine 之上按全局和单聊天限速发送，
+// 遵守 429 响应中的 retry_after，其他临时失败按带抖动的指数退避重试，突发的机器人消息被平滑发出而不是直接失败
+class TelegramScheduler {
+public:
+    static TelegramScheduler& getInstance();
+
+    // 在第一次发送之前调用
+    void configure(const TelegramSchedulerOptions& options);
+
+    // 发送类请求（sendMessage、editMessageText、forwardMessage 等），结果只记录日志
+    // 同一个聊天的请求按提交顺序逐个发送；coalesceKey 非空时，与队列中尚未发出的同 key 请求合并，只发送最新的一个
+    void send(const std::string& chatId, UpstreamRequest request, const std::string& coalesceKey = "");
+
+    // 读取类请求（getFile），不占用发送配额；失败时按 retry_after 或退避延迟重试，最终结果在引擎线程中回调
+    void call(UpstreamRequest request, UpstreamCallback callback);
+    std::future<HttpResponse> call(UpstreamRequest request);
+
+    // 上传类请求（sendPhoto、sendMediaGroup 等），调用方等待结果：只在 429 时按 retry_after 重试，
+    // 最多 maxRetries 次、单次等待不超过 maxBackoffMs；5xx 和传输失败可能已经发出，不重试以免重复发送。
+    // 同一聊天的多个上传可以并发，不经过单聊天的发送队列
+    std::future<HttpResponse> upload(UpstreamRequest request);
+
+    // 丢弃尚未发出的消息，排队中的读取请求以失败结果回调
+    void shutdown();
+
+    size_t getQueuedMessages();
+
+    // 取 Telegram 错误响应中的 parameters.retry_after（秒），没有时返回 -1
+    static int parseRetryAfter(const std::string& body);
+    // 第 attempt 次（从 1 开始）重试前的等待时间：[0, min(max, base * 2^(attempt-1))] 内均匀随机
+    std::chrono::milliseconds backoffDelay(int attempt);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Message {
+        UpstreamRequest request;
+        std::string coalesceKey;
+        int attempts = 0;
+    };
+
+    struct ChatQueue {
+        std::deque<Message> pending;
+        Clock::time_point nextSendAt;
+        bool inFlight = false;
+    };
+
+    struct DelayedCall {
+        UpstreamRequest request;
+        UpstreamCallback callback;
+        int attempts = 0;
+        bool upload = false;
+    };
+
+    TelegramScheduler();
+    ~TelegramScheduler();
+    TelegramScheduler(const TelegramScheduler&) = delete;
+    TelegramScheduler& operator=(const TelegramScheduler&) = delete;
+
+    void run();
+    void submitCall(DelayedCall call);
+    void onSendFinished(const std::string& chatId, Message message, HttpResponse&& response);
+    // 调用方需持有 mutex
+    std::chrono::milliseconds computeBackoff(int attempt);
+    // 429 时返回 retry_after，其他可重试的失败返回退避时间，不可重试时返回 -1；调用方需持有 mutex
+    std::chrono::milliseconds retryDelay(const HttpResponse& response, int attempt);
+    std::chrono::milliseconds chatInterval(const std::string& chatId) const;
+
+    TelegramSchedulerOptions options;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::thread worker;
+    bool stopping;
+
+    std::map<std::string, ChatQueue> chats;
+    std::multimap<Clock::time_point, DelayedCall> delayedCalls;
+    size_t queuedMessages;
+
+    // 全局令牌桶
+    double tokens;
+    Clock::time_point lastRefill;
+
+    std::mt19937 random;
+};
+
+#endif
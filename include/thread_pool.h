@@ -2,33 +2,114 @@
 #define THREAD_POOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
+#include <map>
+#include <string>
+#include <cstdint>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <chrono>
 
+// 任务优先级：工作线程总是先取高优先级队列中的任务
+enum class TaskPriority {
+    High = 0,    // Webhook 处理、预取等影响用户响应的任务
+    Normal = 1,
+    Low = 2,     // 统计、清理等可以延后的任务
+};
+
+// 队列满时的处理方式
+enum class OverflowPolicy {
+    Block,       // 提交线程等待队列有空位（在工作线程内提交时改为 RunInline，避免互相等待）
+    DropNewest,  // 丢弃新任务，其 future 得到 broken_promise
+    DropOldest,  // 丢弃队列中最早的任务
+    RunInline,   // 在提交线程中直接执行
+};
+
+OverflowPolicy parseOverflowPolicy(const std::string& policy, OverflowPolicy defaultPolicy = OverflowPolicy::Block);
+const char* taskPriorityName(TaskPriority priority);
+
+// 弹性线程池：线程数在 [minThreads, maxThreads] 之间变化
+// 排队任务数超过空闲线程数时增加线程，空闲超过 idleTimeout 的线程退出（不低于 minThreads）
 class ThreadPool {
 public:
+    // 固定大小
     ThreadPool(size_t threads);
+    // idleTimeout 为 0 时空闲线程不会退出
+    ThreadPool(size_t minThreads, size_t maxThreads, std::chrono::milliseconds idleTimeout);
     ~ThreadPool();
 
+    // 立即调整到 newSize 个线程（不超过 maxThreads，低于 minThreads 时下限随之降低），之后仍按负载伸缩
     void resize(size_t newSize);
+    void setLimits(size_t minThreads, size_t maxThreads);
+
+    // 设置某个优先级队列的容量（0 表示不限）和队列满时的处理方式
+    void setQueueLimit(TaskPriority priority, size_t capacity, OverflowPolicy policy);
+
+    // 当前排队等待执行的任务数
+    size_t getQueueDepth();
+    size_t getQueueDepth(TaskPriority priority);
+    // 因队列已满被丢弃的任务数
+    uint64_t getDroppedTaskCount(TaskPriority priority);
+    size_t getThreadCount();
+    // 正在执行任务的线程数，以及其占当前线程数的比例（0 ~ 1）
+    size_t getBusyThreadCount();
+    double getUtilization();
+    size_t getMinThreads();
+    size_t getMaxThreads();
+
+    // 以 Normal 优先级提交
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args)
+        -> std::future<typename std::invoke_result<F, Args...>::type>;
 
     template<class F, class... Args>
-    auto enqueue(F&& f, Args&&... args) 
+    auto enqueueWithPriority(TaskPriority priority, F&& f, Args&&... args)
         -> std::future<typename std::invoke_result<F, Args...>::type>;
 
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    static constexpr size_t kLaneCount = 3;
+
+    struct Lane {
+        std::deque<std::function<void()>> tasks;
+        size_t capacity = 0;
+        OverflowPolicy policy = OverflowPolicy::Block;
+        uint64_t dropped = 0;
+    };
+
+    std::map<size_t, std::thread> workers;
+    std::vector<std::thread> finishedWorkers;  // 已退出、等待 join 的线程
+    Lane lanes[kLaneCount];
+    size_t queuedTasks;       // 所有队列中的任务总数
+    size_t dispatchCount;     // 已分派的任务数，用于防止低优先级任务饿死
+    size_t blockedSubmitters; // 因队列已满而等待的提交线程数
 
     std::mutex queueMutex;
     std::condition_variable condition;
+    std::condition_variable notFull;
     bool stop;
+    size_t minThreads;
     size_t maxThreads;
+    std::chrono::milliseconds idleTimeout;
+
+    size_t nextWorkerId;
+    size_t idleThreads;
+    size_t busyThreads;
+    size_t exitRequests;  // resize 缩容时要求退出的线程数
+
+    // 以下函数需持有 queueMutex
+    void spawnWorker();
+    void growForBacklog();
+    size_t liveThreadCount() const;
+
+    bool popTask(std::function<void()>& task);
+
+    void submit(TaskPriority priority, std::function<void()> task);
+    void workerLoop(size_t id);
+    void joinFinishedWorkers();
 };
 
 #include "thread_pool.tpp"
@@ -6,6 +6,12 @@
 template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args)
     -> std::future<typename std::invoke_result<F, Args...>::type> {
+    return enqueueWithPriority(TaskPriority::Normal, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+auto ThreadPool::enqueueWithPriority(TaskPriority priority, F&& f, Args&&... args)
+    -> std::future<typename std::invoke_result<F, Args...>::type> {
 
     using return_type = typename std::invoke_result<F, Args...>::type;
 
@@ -17,19 +23,8 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
     // 获取任务的 future，稍后可以获取任务的结果
     std::future<return_type> res = task->get_future();
 
-    {
-        std::unique_lock<std::mutex> lock(queueMutex);
-
-        // 如果线程池已经停止，不允许添加任务
-        if (stop)
-            throw std::runtime_error("enqueue on stopped ThreadPool");
-
-        // 将任务加入任务队列中
-        tasks.emplace([task](){ (*task)(); });
-    }
+    // 入队并按队列的溢出策略处理；线程池已停止时抛出异常
+    submit(priority, [task](){ (*task)(); });
 
-    // 通知一个等待的工作线程，有新任务可执行
-    condition.notify_one();
-    
     return res;
 }
@@ -0,0 +1,72 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+class Histogram;
+
+// 追踪点名称，应定义为静态对象：构造时注册对应的耗时直方图，之后记录只需原子操作
+// 导出为 request_span_duration_seconds{span="..."}
+class SpanName {
+public:
+    explicit SpanName(const char* name);
+
+    const char* name;
+    Histogram* histogram;
+};
+
+// 记录一个已结束的阶段
+void recordSpan(const SpanName& span, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end);
+
+// 作用域内的阶段计时，析构时记录
+class ScopedSpan {
+public:
+    explicit ScopedSpan(const SpanName& span) : span(span), start(std::chrono::steady_clock::now()) {}
+    ~ScopedSpan() { recordSpan(span, start, std::chrono::steady_clock::now()); }
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+private:
+    const SpanName& span;
+    std::chrono::steady_clock::time_point start;
+};
+
+// 可选的 Chrome trace-event 记录（chrome://tracing / Perfetto 可直接打开）
+// 未开启时 recordSpan 不会访问这里；事件数达到上限后丢弃新事件
+class TraceRecorder {
+public:
+    static TraceRecorder& getInstance();
+
+    void enable(size_t maxEvents);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void add(const char* name, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end);
+
+    // 导出为 JSON（{"traceEvents": [...]}），clear 为 true 时导出后清空
+    std::string toJson(bool clear);
+    bool dumpToFile(const std::string& path);
+
+private:
+    TraceRecorder();
+
+    struct TraceEvent {
+        const char* name;
+        int64_t startMicros;
+        int64_t durationMicros;
+        uint64_t threadId;
+    };
+
+    std::atomic<bool> enabled;
+    std::mutex eventsMutex;
+    std::vector<TraceEvent> events;
+    size_t maxEvents;
+    std::chrono::steady_clock::time_point origin;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef UPSTREAM_ENGINE_H
+#define UPSTREAM_ENGINE_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
+#include "http_client.h"
+
+struct UpstreamRequest {
+    std::string url;
+    std::string body;              // 非空时以 POST 发送
+    std::string contentType;
+    std::vector<HttpFormField> form;  // 非空时以 multipart/form-data POST 发送（忽略 body）
+    long timeoutSeconds = 10;
+    std::string orderingKey;       // 非空时，同一个 key 的请求按提交顺序逐个执行（例如发往同一个聊天的回复）
+    std::string outputPath;        // 非空时响应体逐块写入该文件（HttpResponse::body 为空），大文件不需要整个载入内存；
+                                   // 传输失败时文件被删除，成功时（包括非 2xx）由调用方负责
+};
+
+// 在引擎线程中调用，不能阻塞；需要阻塞的后续处理应交给线程池
+using UpstreamCallback = std::function<void(HttpResponse&&)>;
+
+// 异步上游请求引擎：一个线程通过 curl_multi_socket_action 驱动所有传输，
+// 等待 Telegram 响应时不占用任何工作线程，并发请求数只受连接数和带宽限制
+class UpstreamEngine {
+public:
+    static UpstreamEngine& getInstance();
+
+    // 可以在任意线程中调用；引擎已停止时立即以失败结果回调
+    void submit(UpstreamRequest request, UpstreamCallback callback);
+    std::future<HttpResponse> submit(UpstreamRequest request);
+
+    // 取消尚未完成的请求（以失败结果回调）并停止引擎线程
+    void shutdown();
+
+    size_t getActiveTransfers() const { return activeTransfers.load(std::memory_order_relaxed); }
+    size_t getQueuedTransfers();
+
+private:
+    struct Transfer;
+
+    UpstreamEngine();
+    ~UpstreamEngine();
+    UpstreamEngine(const UpstreamEngine&) = delete;
+    UpstreamEngine& operator=(const UpstreamEngine&) = delete;
+
+    void run();
+    void startTransfer(std::unique_ptr<Transfer> transfer);
+    void finishTransfer(Transfer* transfer, CURLcode result);
+    // 启动同一个 key 排队中的下一个请求
+    void startNext(const std::string& key);
+    void processSubmissions();
+    void collectFinished();
+    void abortAll();
+    void wake();
+
+    CURLM* multi;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> activeTransfers;
+
+    std::mutex submitMutex;
+    std::vector<std::unique_ptr<Transfer>> submissions;
+    size_t waitingTransfers;   // 排在 orderingKey 之后等待的请求数，受 submitMutex 保护
+
+    // 以下成员只在引擎线程中访问
+    std::map<std::string, std::deque<std::unique_ptr<Transfer>>> orderedQueues;  // 有正在执行请求的 key
+    std::unordered_set<Transfer*> runningTransfers;
+    std::vector<CURL*> idleHandles;
+    long timeoutMs;            // curl 要求的下一次超时，-1 表示没有
+
+    int epollFd;
+    int wakeFd;
+
+    static int onSocket(CURL* easy, curl_socket_t socket, int what, void* userp, void* socketp);
+    static int onTimer(CURLM* multi, long timeoutMs, void* userp);
+};
+
+#endif
@@ -3,21 +3,61 @@
 
 #include <string>
 #include <cstdint>
+#include <atomic>
 
 enum class LogLevel {
+    DEBUG,
     INFO,
     WARNING,
     LOGERROR
 };
 
+// 当前最低输出级别，低于该级别的日志直接丢弃
+extern std::atomic<int> minimumLogLevel;
+
+inline bool isLogLevelEnabled(LogLevel level) {
+    return static_cast<int>(level) >= minimumLogLevel.load(std::memory_order_relaxed);
+}
+
+// 级别未开启时不会对 message 表达式求值，热路径上应优先使用 LOG 而不是 log()
+#define LOG(level, message)              \
+    do {                                 \
+        if (isLogLevelEnabled(level)) {  \
+            log(level, message);         \
+        }                                \
+    } while (0)
+
 // 工具函数声明
 std::string logLevelToString(LogLevel level);
+LogLevel parseLogLevel(const std::string& level, LogLevel defaultLevel = LogLevel::INFO);
 std::string getCurrentTime();
+
+// 日志先进入无锁队列，由后台线程批量写入文件和控制台
 void log(LogLevel level, const std::string& message);
+void log(LogLevel level, std::string&& message);
+void setLogLevel(LogLevel level);
+void configureLogger(const std::string& filePath, bool consoleOutput);
+void flushLogs();  // 阻塞直到已提交的日志全部写出
 std::string gzipCompress(const std::string& data);
 
 // 短链生成函数声明
 std::string generateShortLink(const std::string& fileId);
 
+// 增量计算 SHA-256，用于边接收边计算大文件的哈希
+class Sha256Hasher {
+public:
+    Sha256Hasher();
+    ~Sha256Hasher();
+    Sha256Hasher(const Sha256Hasher&) = delete;
+    Sha256Hasher& operator=(const Sha256Hasher&) = delete;
+
+    void update(const char* data, size_t length);
+    // 返回小写十六进制摘要，之后不能再调用 update
+    std::string hexDigest();
+
+private:
+    void* context;  // EVP_MD_CTX，避免在头文件中引入 OpenSSL
+};
+
 #endif
 
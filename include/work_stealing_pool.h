@@ -0,0 +1,99 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+
+// 只可移动的任务对象，小于 kInlineSize 的可调用对象直接存放在内部缓冲区，避免额外的堆分配
+class Task {
+public:
+    static constexpr size_t kInlineSize = 48;
+
+    Task() noexcept : ops(nullptr) {}
+
+    template<class F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+    Task(F&& f);
+
+    Task(Task&& other) noexcept;
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    explicit operator bool() const { return ops != nullptr; }
+    void operator()() { ops->invoke(storage); }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*relocate)(void* from, void* to);  // 移动到新缓冲区并销毁原对象
+        void (*destroy)(void* storage);
+    };
+
+    template<class F> static const Ops* inlineOps();
+    template<class F> static const Ops* heapOps();
+
+    alignas(std::max_align_t) unsigned char storage[kInlineSize];
+    const Ops* ops;
+};
+
+// 工作窃取线程池：每个工作线程有自己的无锁双端队列（Chase-Lev），
+// 工作线程内提交的任务进入本地队列，外部线程提交的任务进入全局注入队列，
+// 空闲线程从其他线程的队列尾部窃取任务，仍然没有任务时休眠等待唤醒
+// 注入队列按值保存 Task；本地队列保存的 Task 槽位由各工作线程的空闲链表循环使用，提交时不做堆分配
+// 目前只由 bench/thread_pool_bench 使用，用于和 ThreadPool 对比，服务本身仍使用 ThreadPool
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // 提交不需要返回值的任务
+    void execute(Task task);
+
+    // 与 ThreadPool::enqueue 用法一致，返回任务结果的 future
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args)
+        -> std::future<typename std::invoke_result<F, Args...>::type>;
+
+    // 近似值：各本地队列与注入队列中尚未开始执行的任务数
+    size_t getQueueDepth() const;
+    size_t getThreadCount() const;
+
+private:
+    struct Worker;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex injectionMutex;
+    std::deque<Task> injectionQueue;
+    std::atomic<size_t> injectionSize;
+
+    std::mutex parkMutex;
+    std::condition_variable parkCondition;
+    std::atomic<size_t> sleepingWorkers;
+    std::atomic<bool> stop;
+
+    void workerLoop(size_t index);
+    // 找到任务时移入 task 并返回 true
+    bool findTask(size_t index, uint64_t& randomState, Task& task);
+    bool popInjected(Task& task);
+    bool hasQueuedTasks() const;
+    void wakeOne();
+};
+
+#include "work_stealing_pool.tpp"
+
+#endif
@@ -0,0 +1,103 @@
+#include "work_stealing_pool.h"
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+
+// ---------------- Task ----------------
+
+template<class F>
+const Task::Ops* Task::inlineOps() {
+    static const Ops ops = {
+        [](void* storage) { (*static_cast<F*>(storage))(); },
+        [](void* from, void* to) {
+            new (to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        },
+        [](void* storage) { static_cast<F*>(storage)->~F(); },
+    };
+    return &ops;
+}
+
+template<class F>
+const Task::Ops* Task::heapOps() {
+    // 缓冲区中只存放指向堆对象的指针
+    static const Ops ops = {
+        [](void* storage) { (**static_cast<F**>(storage))(); },
+        [](void* from, void* to) { *static_cast<F**>(to) = *static_cast<F**>(from); },
+        [](void* storage) { delete *static_cast<F**>(storage); },
+    };
+    return &ops;
+}
+
+template<class F, typename>
+Task::Task(F&& f) {
+    using Callable = std::decay_t<F>;
+    if constexpr (sizeof(Callable) <= kInlineSize && alignof(Callable) <= alignof(std::max_align_t) &&
+                  std::is_nothrow_move_constructible<Callable>::value) {
+        new (storage) Callable(std::forward<F>(f));
+        ops = inlineOps<Callable>();
+    } else {
+        *reinterpret_cast<Callable**>(storage) = new Callable(std::forward<F>(f));
+        ops = heapOps<Callable>();
+    }
+}
+
+inline Task::Task(Task&& other) noexcept : ops(other.ops) {
+    if (ops != nullptr) {
+        ops->relocate(other.storage, storage);
+        other.ops = nullptr;
+    }
+}
+
+inline Task& Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        if (ops != nullptr) {
+            ops->destroy(storage);
+        }
+        ops = other.ops;
+        if (ops != nullptr) {
+            ops->relocate(other.storage, storage);
+            other.ops = nullptr;
+        }
+    }
+    return *this;
+}
+
+inline Task::~Task() {
+    if (ops != nullptr) {
+        ops->destroy(storage);
+    }
+}
+
+// ---------------- WorkStealingPool ----------------
+
+template<class F, class... Args>
+auto WorkStealingPool::enqueue(F&& f, Args&&... args)
+    -> std::future<typename std::invoke_result<F, Args...>::type> {
+
+    using return_type = typename std::invoke_result<F, Args...>::type;
+
+    if (stop.load(std::memory_order_relaxed)) {
+        throw std::runtime_error("enqueue on stopped WorkStealingPool");
+    }
+
+    // promise 与可调用对象一起移动进任务，不再需要 shared_ptr<packaged_task>
+    std::promise<return_type> promise;
+    std::future<return_type> res = promise.get_future();
+
+    execute([promise = std::move(promise), fn = std::forward<F>(f),
+             arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        try {
+            if constexpr (std::is_void<return_type>::value) {
+                std::apply(fn, std::move(arguments));
+                promise.set_value();
+            } else {
+                promise.set_value(std::apply(fn, std::move(arguments)));
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    });
+
+    return res;
+}
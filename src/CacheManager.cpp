@@ -1,10 +1,24 @@
 #include "CacheManager.h"
 #include <iostream>
 #include "utils.h"
+#include "metrics.h"
 #include <unordered_set>
+#include <algorithm>
 
-CacheManager::CacheManager(size_t maxCacheSize, int cleanupIntervalSeconds)
-    : maxCacheSize(maxCacheSize), cleanupIntervalSeconds(cleanupIntervalSeconds), stopThread(false) {
+namespace {
+
+CacheTierMetrics& memoryCacheMetrics() {
+    static CacheTierMetrics metrics("memory");
+    return metrics;
+}
+
+// 过期项被返回为 Stale 后，推迟这么久再让下一个请求刷新
+const std::chrono::seconds kRevalidateWindow(30);
+
+}  // namespace
+
+CacheManager::CacheManager(size_t maxCacheSize, int cleanupIntervalSeconds, int staleGraceSeconds)
+    : maxCacheSize(maxCacheSize), staleGraceSeconds(std::max(staleGraceSeconds, 0)), cleanupIntervalSeconds(cleanupIntervalSeconds), stopThread(false) {
     startCleanupThread();
 }
 
@@ -20,7 +34,7 @@ void CacheManager::addCache(const std::string& key, const std::string& data, int
         if (cacheMap.size() >= maxCacheSize) {
             cacheMap.erase(cacheMap.begin());
         }
-        cacheMap[key] = CacheItem{std::make_unique<std::string>(data), expirationTime};;
+        cacheMap[key] = CacheItem{std::make_unique<std::string>(data), expirationTime, expirationTime + std::chrono::seconds(staleGraceSeconds)};
     } 
 }
 
@@ -32,13 +46,19 @@ bool CacheManager::getCache(const std::string& key, std::string& data) {
         auto it = cacheMap.find(key);
         if (it != cacheMap.end()) {
             if (now > it->second.expirationTime) {
-                cacheMap.erase(it);
+                // 宽限期内的过期项保留，由清理线程删除
+                if (now > it->second.staleUntil) {
+                    cacheMap.erase(it);
+                }
+                memoryCacheMetrics().record(false);
                 return false;
             }
             data = *(it->second.data);
+            memoryCacheMetrics().record(true);
             return true;
         }
     }
+    memoryCacheMetrics().record(false);
     return false;
 }
 
@@ -50,7 +70,7 @@ void CacheManager::addFilePathCache(const std::string& fileId, const std::string
         if (fileExtensionCache.size() >= maxCacheSize) {
             fileExtensionCache.erase(fileExtensionCache.begin());
         }
-        fileExtensionCache[fileId] = CacheItem{std::make_unique<std::string>(filePath), expirationTime};
+        fileExtensionCache[fileId] = CacheItem{std::make_unique<std::string>(filePath), expirationTime, expirationTime + std::chrono::seconds(staleGraceSeconds)};
     }
 }
 
@@ -62,16 +82,47 @@ bool CacheManager::getFilePathCache(const std::string& fileId, std::string& file
         auto it = fileExtensionCache.find(fileId);
         if (it != fileExtensionCache.end()) {
             if (now > it->second.expirationTime) {
-                fileExtensionCache.erase(it);
+                if (now > it->second.staleUntil) {
+                    fileExtensionCache.erase(it);
+                }
+                memoryCacheMetrics().record(false);
                 return false;
             }
             filePath = *(it->second.data);
+            memoryCacheMetrics().record(true);
             return true;
         }
     }
+    memoryCacheMetrics().record(false);
     return false;
 }
 
+CacheLookup CacheManager::lookupFilePathCache(const std::string& fileId, std::string& filePath) {
+    auto now = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = fileExtensionCache.find(fileId);
+        if (it != fileExtensionCache.end()) {
+            CacheItem& item = it->second;
+            if (now <= item.expirationTime) {
+                filePath = *(item.data);
+                memoryCacheMetrics().record(true);
+                return CacheLookup::Fresh;
+            }
+            if (now <= item.staleUntil) {
+                filePath = *(item.data);
+                item.expirationTime = std::min(now + kRevalidateWindow, item.staleUntil);
+                memoryCacheMetrics().record(true);
+                return CacheLookup::Stale;
+            }
+            fileExtensionCache.erase(it);
+        }
+    }
+    memoryCacheMetrics().record(false);
+    return CacheLookup::Miss;
+}
+
 // 删除缓存
 void CacheManager::deleteCache(const std::string& key) {
     std::lock_guard<std::mutex> lock(cacheMutex);
@@ -129,7 +180,7 @@ void CacheManager::cleanupExpiredCache() {
         std::lock_guard<std::mutex> lock(cacheMutex);
         // 清理缓存数据
         for (auto it = cacheMap.begin(); it != cacheMap.end();) {
-            if (now > it->second.expirationTime) {
+            if (now > it->second.staleUntil) {
                 it = cacheMap.erase(it);
             } else {
                 ++it;
@@ -141,7 +192,7 @@ void CacheManager::cleanupExpiredCache() {
         std::lock_guard<std::mutex> lock(cacheMutex);
         // 清理文件后缀缓存
         for (auto it = fileExtensionCache.begin(); it != fileExtensionCache.end();) {
-            if (now > it->second.expirationTime) {
+            if (now > it->second.staleUntil) {
                 it = fileExtensionCache.erase(it);
             } else {
                 ++it;
@@ -6,14 +6,213 @@
 #include "utils.h"
 #include <regex>
 #include "httplib.h"
+#include "http_client.h"
+#include "upstream_engine.h"
+#include "telegram_scheduler.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
+namespace {
+
+// 一次 sendMediaGroup 最多包含的文件数（Telegram 限制）
+const size_t kMaxMediaGroupSize = 10;
+
+// 根据媒体类型确定 API 方法和文件字段名
+bool getUploadMethod(MediaType mediaType, std::string& apiMethod, std::string& fileField) {
+    switch (mediaType) {
+        case MediaType::Photo:
+            apiMethod = "sendPhoto";
+            fileField = "photo";
+            return true;
+        case MediaType::Video:
+            apiMethod = "sendVideo";
+            fileField = "video";
+            return true;
+        case MediaType::Document:
+            apiMethod = "sendDocument";
+            fileField = "document";
+            return true;
+        case MediaType::Sticker:
+            apiMethod = "sendSticker";
+            fileField = "sticker";
+            return true;
+        case MediaType::Audio:
+            apiMethod = "sendAudio";
+            fileField = "audio";
+            return true;
+    }
+    return false;
+}
+
+// 从发送结果的 Message 中取出文件的 file_id；照片取最大的一个尺寸
+std::string extractFileId(const json& message, MediaType mediaType) {
+    std::string apiMethod;
+    std::string fileField;
+    if (!getUploadMethod(mediaType, apiMethod, fileField) || !message.contains(fileField)) {
+        return "";
+    }
+    if (mediaType == MediaType::Photo) {
+        return message[fileField].back()["file_id"].get<std::string>();
+    }
+    return message[fileField]["file_id"].get<std::string>();
+}
+
+// 批量上传时按扩展名选择类型：图片和视频可以放进同一个媒体组，其余按文件发送
+MediaType mediaTypeForFilename(const std::string& filename) {
+    size_t pos = filename.find_last_of('.');
+    std::string extension = pos == std::string::npos ? "" : filename.substr(pos);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".webp" || extension == ".bmp") {
+        return MediaType::Photo;
+    }
+    if (extension == ".mp4" || extension == ".mov" || extension == ".m4v") {
+        return MediaType::Video;
+    }
+    return MediaType::Document;
+}
+
+// 上传请求中的一个文件，内容已写入临时文件
+struct SpooledFile {
+    std::string fieldName;
+    std::string filename;
+    std::string path;
+    size_t size = 0;
+    std::string contentHash;   // 内容的 SHA-256，写完后计算
+};
+
+// 请求处理结束时删除所有临时文件
+struct SpooledUpload {
+    std::vector<SpooledFile> files;
+
+    ~SpooledUpload() {
+        for (const SpooledFile& file : files) {
+            std::remove(file.path.c_str());
+        }
+    }
+};
+
+std::string spoolDirectory(const Config& config) {
+    std::string dir = config.getUploadSpoolDir();
+    if (dir.empty()) {
+        std::error_code ec;
+        dir = std::filesystem::temp_directory_path(ec).string();
+        if (ec || dir.empty()) {
+            dir = ".";
+        }
+    }
+    return dir;
+}
+
+// 接收上传时的限制，在读取请求体的过程中检查，超出时立即中止，不会先把整个请求写到磁盘
+struct SpoolLimits {
+    size_t maxFileBytes = 0;   // 单个文件的最大字节数
+    size_t maxFiles = 0;       // 最多接收的文件部分数
+    std::string fieldName;     // 非空时只接收该字段的文件，其余文件部分直接丢弃
+};
+
+// 用 ContentReader 逐块读取 multipart 请求体，文件部分直接写入临时文件，不经过 req.files，
+// 每个上传占用的内存与文件大小无关；返回 0 表示成功，否则为应答的 HTTP 状态码，error 为错误说明
+int spoolUpload(const httplib::Request& req, const httplib::ContentReader& contentReader,
+                const std::string& dir, const SpoolLimits& limits, const std::string& namePrefix,
+                SpooledUpload& upload, std::string& error) {
+    if (!req.is_multipart_form_data()) {
+        error = "Bad Request: multipart/form-data expected";
+        return 400;
+    }
+
+    std::FILE* current = nullptr;
+    std::unique_ptr<Sha256Hasher> hasher;  // 与写文件同时计算，不需要再读一遍
+    int status = 0;
+    auto closeCurrent = [&]() {
+        if (current != nullptr) {
+            std::fclose(current);
+            current = nullptr;
+            upload.files.back().contentHash = hasher->hexDigest();
+        }
+    };
+    bool ok = contentReader(
+        [&](const httplib::MultipartFormData& part) {
+            closeCurrent();
+            if (part.filename.empty() || (!limits.fieldName.empty() && part.name != limits.fieldName)) {
+                return true;  // 普通字段或不需要的文件，内容丢弃
+            }
+            if (upload.files.size() >= limits.maxFiles) {
+                error = "Too many files, at most " + std::to_string(limits.maxFiles) + " per request";
+                status = 413;
+                return false;
+            }
+            SpooledFile file;
+            file.fieldName = part.name;
+            file.filename = part.filename;
+            file.path = dir + "/" + namePrefix + "-" + std::to_string(upload.files.size()) + ".part";
+            current = std::fopen(file.path.c_str(), "wb");
+            if (current == nullptr) {
+                log(LogLevel::LOGERROR, "Failed to create upload spool file: " + file.path);
+                error = "Internal Server Error: Failed to store upload";
+                status = 500;
+                return false;
+            }
+            upload.files.push_back(std::move(file));
+            hasher.reset(new Sha256Hasher());
+            return true;
+        },
+        [&](const char* data, size_t length) {
+            if (current == nullptr) {
+                return true;
+            }
+            SpooledFile& file = upload.files.back();
+            if (file.size + length > limits.maxFileBytes) {
+                error = "File too large, at most " + std::to_string(limits.maxFileBytes / (1024 * 1024)) + " MB per file";
+                status = 413;
+                return false;
+            }
+            if (std::fwrite(data, 1, length, current) != length) {
+                log(LogLevel::LOGERROR, "Failed to write upload spool file: " + file.path);
+                error = "Internal Server Error: Failed to store upload";
+                status = 500;
+                return false;
+            }
+            file.size += length;
+            hasher->update(data, length);
+            return true;
+        });
+
+    closeCurrent();
+    if (status != 0) {
+        return status;
+    }
+    if (!ok) {
+        error = "Bad Request: malformed multipart/form-data";
+        return 400;
+    }
+    return 0;
+}
+
+// 上传内容与已有文件相同，直接返回已有链接的次数
+void recordDedupHit() {
+    static Counter& hits = MetricsRegistry::getInstance().counter(
+        "upload_dedup_hits_total", "Uploads answered with an existing file because the content hash matched");
+    hits.inc();
+}
+
+}  // namespace
+
 PicGoHandler::PicGoHandler(const Config& config)
     : config(config) {}
 
+size_t PicGoHandler::getMaxFileBytes() const {
+    return static_cast<size_t>(std::max(1, config.getUploadMaxFileSizeMb())) * 1024 * 1024;
+}
+
 // 处理 PicGo 的上传请求
 void PicGoHandler::handleUpload(const httplib::Request& req, httplib::Response& res,
+                                const httplib::ContentReader& contentReader,
                                 const std::string& userId, const std::string& userName,
                                 DBManager& dbManager) {
     if (req.method != "POST") {
@@ -22,23 +221,55 @@ void PicGoHandler::handleUpload(const httplib::Request& req, httplib::Response&
         return;
     }
 
-    auto file = req.get_file_value("image");
-    if (file.content.empty()) {
+    // 只接收 image 字段的一个文件
+    SpoolLimits limits;
+    limits.maxFileBytes = getMaxFileBytes();
+    limits.maxFiles = 1;
+    limits.fieldName = "image";
+    SpooledUpload upload;
+    std::string spoolError;
+    int spoolStatus = spoolUpload(req, contentReader, spoolDirectory(config), limits, "upload-" + generateUUID(), upload, spoolError);
+    if (spoolStatus != 0) {
+        res.status = spoolStatus;
+        res.set_content(json{{"error", spoolError}}.dump(), "application/json");
+        return;
+    }
+
+    auto file = std::find_if(upload.files.begin(), upload.files.end(), [](const SpooledFile& spooled) {
+        return spooled.fieldName == "image";
+    });
+    if (file == upload.files.end() || file->size == 0) {
         res.status = 400;
         res.set_content(R"({"error":"Bad Request: No image uploaded"})", "application/json");
         return;
     }
 
-    std::string filename = sanitizeFilename(file.filename);
+    std::string filename = sanitizeFilename(file->filename);
     if (filename.empty()) {
         res.status = 400;
         res.set_content(R"({"error":"Invalid file name"})", "application/json");
         return;
     }
 
+    // 相同内容已经上传过时直接返回已有链接，不再请求 Telegram，也不写入新记录
+    std::string existingFileId;
+    std::string existingShortId;
+    if (dbManager.getFileByContentHash(file->contentHash, existingFileId, existingShortId)) {
+        recordDedupHit();
+        log(LogLevel::INFO, "Duplicate upload " + filename + " matches file ID: " + existingFileId);
+        json result;
+        result["success"] = true;
+        result["file_id"] = existingFileId;
+        result["url"] = config.getWebhookUrl() + "/d/" + existingShortId;
+        result["duplicate"] = true;
+        res.status = 200;
+        res.set_content(result.dump(), "application/json");
+        return;
+    }
+
     // 上传到 Telegram
     std::string telegramFileId;
-    if (!uploadToTelegram(file.content, filename, MediaType::Photo, telegramFileId)) {
+    if (!uploadToTelegram(file->path, filename, MediaType::Photo, telegramFileId)) {
         res.status = 500;
         res.set_content(R"({"error":"Internal Server Error: Failed to upload to Telegram"})", "application/json");
         return;
@@ -58,7 +289,7 @@ void PicGoHandler::handleUpload(const httplib::Request& req, httplib::Response&
         log(LogLevel::LOGERROR, "Error adding user to database.");
     }
 
-    if (!dbManager.addFile(userId, telegramFileId, customUrl, filename, shortId, customUrl, "")) {
+    if (!dbManager.addFiles({FileRecord{userId, telegramFileId, customUrl, filename, shortId, customUrl, "", file->contentHash}})) {
         log(LogLevel::LOGERROR, "Error adding file to database.");
     }
 
@@ -66,97 +297,261 @@ void PicGoHandler::handleUpload(const httplib::Request& req, httplib::Response&
     res.set_content(result.dump(), "application/json");
 }
 
-// 上传图片到 Telegram
-bool PicGoHandler::uploadToTelegram(const std::string& fileContent, const std::string& filename,
+// 批量上传：请求中的全部文件按类型分组，图片和视频每 10 个合成一个 sendMediaGroup，其余文件每 10 个一组，
+// 各组经 TelegramScheduler 并发发送（同时进行的请求数不超过 upload.max_parallel_uploads，429 时按 retry_after 重试），
+// 总耗时接近最慢的一组而不是各文件之和；数据库记录在同一个事务中写入
+void PicGoHandler::handleBatchUpload(const httplib::Request& req, httplib::Response& res,
+                                     const httplib::ContentReader& contentReader,
+                                     const std::string& userId, const std::string& userName,
+                                     DBManager& dbManager) {
+    if (req.method != "POST") {
+        res.status = 405;
+        res.set_content(R"({"error":"Method Not Allowed"})", "application/json");
+        return;
+    }
+
+    // 文件数在接收过程中检查，超过 upload.max_batch_files 时立即返回 413
+    SpoolLimits limits;
+    limits.maxFileBytes = getMaxFileBytes();
+    limits.maxFiles = static_cast<size_t>(std::max(1, config.getUploadMaxBatchFiles()));
+    SpooledUpload upload;
+    std::string spoolError;
+    int spoolStatus = spoolUpload(req, contentReader, spoolDirectory(config), limits, "upload-" + generateUUID(), upload, spoolError);
+    if (spoolStatus != 0) {
+        res.status = spoolStatus;
+        res.set_content(json{{"error", spoolError}}.dump(), "application/json");
+        return;
+    }
+
+    struct BatchItem {
+        std::string filename;
+        const std::string* path;
+        MediaType mediaType;
+        const std::string* contentHash;
+        std::string fileId;
+        std::string shortId;
+        std::string error;
+        bool duplicate;
+        size_t sameAs;  // 与本批中更早的某个文件内容相同时为其下标，否则为 npos
+    };
+
+    // 字段名不限（image、images、files 等），带文件名且内容非空的部分都视为待上传文件
+    std::vector<BatchItem> items;
+    for (const SpooledFile& file : upload.files) {
+        if (file.size == 0) {
+            continue;
+        }
+        std::string filename = sanitizeFilename(file.filename);
+        if (filename.empty()) {
+            continue;
+        }
+        items.push_back({filename, &file.path, mediaTypeForFilename(filename), &file.contentHash, "", "", "", false, std::string::npos});
+    }
+
+    if (items.empty()) {
+        res.status = 400;
+        res.set_content(R"({"error":"Bad Request: No files uploaded"})", "application/json");
+        return;
+    }
+
+    // 已上传过的内容直接使用已有链接，本批内重复的内容只上传第一份
+    std::unordered_map<std::string, size_t> firstByHash;
+    for (size_t i = 0; i < items.size(); ++i) {
+        BatchItem& item = items[i];
+        auto seen = firstByHash.emplace(*item.contentHash, i);
+        if (!seen.second) {
+            item.sameAs = seen.first->second;
+        } else if (dbManager.getFileByContentHash(*item.contentHash, item.fileId, item.shortId)) {
+            item.duplicate = true;
+            recordDedupHit();
+        }
+    }
+
+    // 图片和视频可以混在同一个媒体组里，文件只能和文件一组
+    std::vector<std::vector<size_t>> groups;
+    std::vector<size_t> visual;
+    std::vector<size_t> documents;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].duplicate || items[i].sameAs != std::string::npos) {
+            continue;
+        }
+        (items[i].mediaType == MediaType::Document ? documents : visual).push_back(i);
+    }
+    for (const auto* indexes : {&visual, &documents}) {
+        for (size_t start = 0; start < indexes->size(); start += kMaxMediaGroupSize) {
+            size_t end = std::min(indexes->size(), start + kMaxMediaGroupSize);
+            groups.emplace_back(indexes->begin() + start, indexes->begin() + end);
+        }
+    }
+
+    log(LogLevel::INFO, "Batch upload: " + std::to_string(items.size()) + " files in " +
+                        std::to_string(groups.size()) + " requests");
+
+    // 组按编号分配到 max_parallel_uploads 个 orderingKey 上，同一个 key 的请求由引擎依次执行
+    size_t lanes = static_cast<size_t>(std::max(1, config.getUploadMaxParallelUploads()));
+    std::string batchId = generateUUID();
+    std::string apiBase = config.getTelegramApiUrl() + "/bot" + config.getApiToken() + "/";
+    std::vector<std::future<HttpResponse>> responses;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const std::vector<size_t>& group = groups[g];
+        UpstreamRequest request;
+        request.timeoutSeconds = 60;
+        request.orderingKey = "upload:" + batchId + ":" + std::to_string(g % lanes);
+        request.form.push_back({"chat_id", config.getTelegramChannelId(), "", ""});
+
+        if (group.size() == 1) {
+            const BatchItem& item = items[group[0]];
+            std::string apiMethod;
+            std::string fileField;
+            getUploadMethod(item.mediaType, apiMethod, fileField);
+            request.url = apiBase + apiMethod;
+            request.form.push_back({fileField, "", item.filename, "application/octet-stream", *item.path});
+        } else {
+            json media = json::array();
+            for (size_t i = 0; i < group.size(); ++i) {
+                const BatchItem& item = items[group[i]];
+                std::string attachName = "file" + std::to_string(i);
+                const char* type = item.mediaType == MediaType::Photo ? "photo" : item.mediaType == MediaType::Video ? "video" : "document";
+                media.push_back({{"type", type}, {"media", "attach://" + attachName}});
+                request.form.push_back({attachName, "", item.filename, "application/octet-stream", *item.path});
+            }
+            request.url = apiBase + "sendMediaGroup";
+            request.form.push_back({"media", media.dump(), "", ""});
+        }
+        responses.push_back(TelegramScheduler::getInstance().upload(std::move(request)));
+    }
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const std::vector<size_t>& group = groups[g];
+        HttpResponse response = responses[g].get();
+        std::string error;
+        try {
+            if (!response.ok) {
+                error = "No response from Telegram API";
+            } else if (response.status != 200) {
+                log(LogLevel::LOGERROR, "Batch upload failed with status " + std::to_string(response.status) + ": " + response.body);
+                error = "Telegram API returned status " + std::to_string(response.status);
+            } else {
+                json responseJson = json::parse(response.body);
+                // sendMediaGroup 返回 Message 数组，单个文件的方法返回一个 Message
+                json messages = group.size() == 1 ? json::array({responseJson["result"]}) : responseJson["result"];
+                for (size_t i = 0; i < group.size() && i < messages.size(); ++i) {
+                    items[group[i]].fileId = extractFileId(messages[i], items[group[i]].mediaType);
+                }
+            }
+        } catch (const std::exception& e) {
+            log(LogLevel::LOGERROR, "Failed to parse batch upload response: " + std::string(e.what()));
+            error = "Invalid response from Telegram API";
+        }
+        for (size_t index : group) {
+            if (items[index].fileId.empty()) {
+                items[index].error = error.empty() ? "Missing file_id in Telegram response" : error;
+            }
+        }
+    }
+
+    std::vector<FileRecord> records;
+    for (BatchItem& item : items) {
+        if (item.fileId.empty() || item.duplicate || item.sameAs != std::string::npos) {
+            continue;
+        }
+        item.shortId = generateShortLink(item.fileId);
+        std::string customUrl = config.getWebhookUrl() + "/d/" + item.shortId;
+        records.push_back({userId, item.fileId, customUrl, item.filename, item.shortId, customUrl, "", *item.contentHash});
+    }
+
+    json files = json::array();
+    json urls = json::array();
+    size_t succeeded = 0;
+    for (BatchItem& item : items) {
+        if (item.sameAs != std::string::npos) {
+            const BatchItem& first = items[item.sameAs];
+            item.fileId = first.fileId;
+            item.shortId = first.shortId;
+            item.error = first.error;
+            item.duplicate = !item.fileId.empty();
+            if (item.duplicate) {
+                recordDedupHit();
+            }
+        }
+        if (item.fileId.empty()) {
+            files.push_back({{"filename", item.filename}, {"success", false}, {"error", item.error}});
+            continue;
+        }
+        std::string customUrl = config.getWebhookUrl() + "/d/" + item.shortId;
+        json entry = {{"filename", item.filename}, {"success", true}, {"file_id", item.fileId}, {"url", customUrl}};
+        if (item.duplicate) {
+            entry["duplicate"] = true;
+        }
+        files.push_back(entry);
+        urls.push_back(customUrl);
+        ++succeeded;
+    }
+
+    if (!records.empty()) {
+        if (!dbManager.addUserIfNotExists(userId, userName)) {
+            log(LogLevel::LOGERROR, "Error adding user to database.");
+        }
+        if (!dbManager.addFiles(records)) {
+            log(LogLevel::LOGERROR, "Error adding files to database.");
+        }
+    }
+
+    json result;
+    result["success"] = succeeded == items.size();
+    result["files"] = files;
+    result["urls"] = urls;
+    res.status = succeeded == 0 ? 500 : 200;
+    res.set_content(result.dump(), "application/json");
+}
+
+// 上传图片到 Telegram，文件内容在发送时从 filePath 逐块读取
+bool PicGoHandler::uploadToTelegram(const std::string& filePath, const std::string& filename,
                                     MediaType mediaType, std::string& telegramFileId) {
     try {
         log(LogLevel::INFO, "Starting uploadToTelegram for file: " + filename);
 
         std::string apiMethod;
         std::string fileField;
-
-        // 根据媒体类型确定 API 方法和文件字段名
-        switch (mediaType) {
-            case MediaType::Photo:
-                apiMethod = "sendPhoto";
-                fileField = "photo";
-                break;
-            case MediaType::Video:
-                apiMethod = "sendVideo";
-                fileField = "video";
-                break;
-            case MediaType::Document:
-                apiMethod = "sendDocument";
-                fileField = "document";
-                break;
-            case MediaType::Sticker:
-                apiMethod = "sendSticker";
-                fileField = "sticker";
-                break;
-            case MediaType::Audio:
-                apiMethod = "sendAudio";
-                fileField = "audio";
-                break;
-            default:
-                log(LogLevel::LOGERROR, "Unknown media type for file: " + filename);
-                return false;
-        }
-
-        // 初始化 HTTP 客户端
-        std::string apiUrl = config.getTelegramApiUrl();
-        httplib::Client cli(apiUrl);
-
-        if (!cli.is_valid()) {
-            log(LogLevel::LOGERROR, "HTTP client initialization failed for apiUrl: " + apiUrl);
+        if (!getUploadMethod(mediaType, apiMethod, fileField)) {
+            log(LogLevel::LOGERROR, "Unknown media type for file: " + filename);
             return false;
         }
 
-        // 设置超时
-        cli.set_read_timeout(60, 0);  // 60 秒
+        // 构建请求地址
+        std::string apiUrl = config.getTelegramApiUrl() + "/bot" + config.getApiToken() + "/" + apiMethod;
 
         // 准备表单数据
-        httplib::MultipartFormDataItems items = {
+        std::vector<HttpFormField> fields = {
             {"chat_id", config.getTelegramChannelId(), "", ""},
-            {fileField, fileContent, filename, "application/octet-stream"}
+            {fileField, "", filename, "application/octet-stream", filePath}
         };
 
-        // 构建请求路径
-        std::string apiPath = "/bot" + config.getApiToken() + "/" + apiMethod;
-
-        log(LogLevel::INFO, "Sending POST request to " + apiPath);
+        log(LogLevel::INFO, "Sending POST request to " + apiMethod);
 
-        // 发送 POST 请求
-        auto res = cli.Post(apiPath.c_str(), items);
+        // 发送 POST 请求（共享连接池，60 秒超时）
+        HttpResponse res = postMultipart(apiUrl, fields, 60);
 
-        if (!res) {
+        if (!res.ok) {
             log(LogLevel::LOGERROR, "No response from Telegram API. Possible connection issue.");
             return false;
         }
 
         log(LogLevel::INFO, "Received response from Telegram API, status code: " +
-                            std::to_string(res->status));
+                            std::to_string(res.status));
 
-        if (res->status != 200) {
+        if (res.status != 200) {
             log(LogLevel::LOGERROR, "Unexpected status code from Telegram API: " +
-                                    std::to_string(res->status));
-            log(LogLevel::LOGERROR, "Response body: " + res->body);
+                                    std::to_string(res.status));
+            log(LogLevel::LOGERROR, "Response body: " + res.body);
             return false;
         }
 
-        auto responseJson = json::parse(res->body);
+        auto responseJson = json::parse(res.body);
 
         if (responseJson["ok"].template get<bool>()) {
-            if (mediaType == MediaType::Photo) {
-                telegramFileId = responseJson["result"]["photo"].back()["file_id"].template get<std::string>();
-            } else if (mediaType == MediaType::Document) {
-                telegramFileId = responseJson["result"]["document"]["file_id"].template get<std::string>();
-            } else if (mediaType == MediaType::Video) {
-                telegramFileId = responseJson["result"]["video"]["file_id"].template get<std::string>();
-            } else if (mediaType == MediaType::Audio) {
-                telegramFileId = responseJson["result"]["audio"]["file_id"].template get<std::string>();
-            } else if (mediaType == MediaType::Sticker) {
-                telegramFileId = responseJson["result"]["sticker"]["file_id"].template get<std::string>();
-            } else {
+            telegramFileId = extractFileId(responseJson["result"], mediaType);
+            if (telegramFileId.empty()) {
                 log(LogLevel::LOGERROR, "Unsupported media type for extracting file_id.");
                 return false;
             }
@@ -164,7 +559,7 @@ bool PicGoHandler::uploadToTelegram(const std::string& fileContent, const std::s
             log(LogLevel::INFO, "File uploaded successfully, Telegram file ID: " + telegramFileId);
             return true;
         } else {
-            log(LogLevel::LOGERROR, "Telegram API returned an error: " + res->body);
+            log(LogLevel::LOGERROR, "Telegram API returned an error: " + res.body);
         }
 
     } catch (const std::exception& e) {
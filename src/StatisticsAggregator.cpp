@@ -0,0 +1,350 @@
+// StatisticsAggregator.cpp
+
+#include "StatisticsAggregator.h"
+#include "StatisticsManager.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// FNV-1a + splitmix64 混合，结果与进程无关，便于后续持久化合并
+uint64_t hashString(const std::string& value) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : value) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash += 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+int64_t toEpochSeconds(const std::chrono::system_clock::time_point& timePoint) {
+    return std::chrono::duration_cast<std::chrono::seconds>(timePoint.time_since_epoch()).count();
+}
+
+const uint8_t kSerializationVersion = 1;
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(const std::string& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+// ---------------- HyperLogLog ----------------
+
+HyperLogLog::HyperLogLog() : registers(kRegisterCount, 0) {}
+
+void HyperLogLog::add(const std::string& value) {
+    uint64_t hash = hashString(value);
+    size_t index = static_cast<size_t>(hash >> (64 - kPrecision));
+    uint64_t remaining = (hash << kPrecision) | (uint64_t(1) << (kPrecision - 1));  // 保证至少有一位为 1
+    uint8_t rank = static_cast<uint8_t>(__builtin_clzll(remaining) + 1);
+    if (rank > registers[index]) {
+        registers[index] = rank;
+    }
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < kRegisterCount; ++i) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+uint64_t HyperLogLog::estimate() const {
+    const double m = static_cast<double>(kRegisterCount);
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t reg : registers) {
+        sum += std::ldexp(1.0, -reg);
+        if (reg == 0) {
+            ++zeros;
+        }
+    }
+
+    double estimate = alpha * m * m / sum;
+
+    // 小基数时使用线性计数修正
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return static_cast<uint64_t>(estimate + 0.5);
+}
+
+std::string HyperLogLog::serialize() const {
+    return std::string(registers.begin(), registers.end());
+}
+
+HyperLogLog HyperLogLog::deserialize(const std::string& data) {
+    HyperLogLog hll;
+    if (data.size() == kRegisterCount) {
+        std::copy(data.begin(), data.end(), hll.registers.begin());
+    }
+    return hll;
+}
+
+// ---------------- LatencyHistogram ----------------
+
+LatencyHistogram::LatencyHistogram() : buckets(kBucketCount, 0), total(0) {}
+
+// 小于 2 * kSubBucketCount 的值每毫秒一个桶；更大的值按最高位所在的 2 的幂次分组，组内取紧随最高位的 kSubBucketBits 位
+size_t LatencyHistogram::bucketIndex(int responseTimeMs) {
+    if (responseTimeMs <= 0) {
+        return 0;
+    }
+    uint32_t value = static_cast<uint32_t>(responseTimeMs);
+    if (value < 2 * kSubBucketCount) {
+        return value;
+    }
+    int exponent = 31 - __builtin_clz(value);
+    size_t subBucket = (value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+    size_t index = 2 * kSubBucketCount + static_cast<size_t>(exponent - kSubBucketBits - 1) * kSubBucketCount + subBucket;
+    return std::min(index, kBucketCount - 1);
+}
+
+int64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < 2 * kSubBucketCount) {
+        return static_cast<int64_t>(index);
+    }
+    size_t group = (index - 2 * kSubBucketCount) / kSubBucketCount;
+    size_t subBucket = (index - 2 * kSubBucketCount) % kSubBucketCount;
+    int shift = static_cast<int>(group) + 1;
+    return static_cast<int64_t>(kSubBucketCount + subBucket) << shift;
+}
+
+int64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < 2 * kSubBucketCount) {
+        return static_cast<int64_t>(index);
+    }
+    int shift = static_cast<int>((index - 2 * kSubBucketCount) / kSubBucketCount) + 1;
+    return bucketLowerBound(index) + (int64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int responseTimeMs) {
+    buckets[bucketIndex(responseTimeMs)]++;
+    total++;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.total == 0) {
+        return;
+    }
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    total += other.total;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total;
+}
+
+int LatencyHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * static_cast<double>(total)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return static_cast<int>(std::min<int64_t>(bucketUpperBound(i), INT32_MAX));
+        }
+    }
+    return INT32_MAX;
+}
+
+// 一次遍历同时求出各分位数
+LatencyPercentiles LatencyHistogram::percentiles() const {
+    LatencyPercentiles result;
+    result.count = total;
+    if (total == 0) {
+        return result;
+    }
+
+    const double quantiles[] = {0.50, 0.90, 0.99, 0.999};
+    int* targets[] = {&result.p50, &result.p90, &result.p99, &result.p999};
+    size_t next = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount && next < 4; ++i) {
+        seen += buckets[i];
+        while (next < 4) {
+            uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(quantiles[next] * static_cast<double>(total))), 1);
+            if (seen < rank) {
+                break;
+            }
+            *targets[next++] = static_cast<int>(std::min<int64_t>(bucketUpperBound(i), INT32_MAX));
+        }
+    }
+    return result;
+}
+
+uint64_t LatencyHistogram::countAbove(int thresholdMs) const {
+    uint64_t above = 0;
+    for (size_t i = bucketIndex(thresholdMs) + 1; i < kBucketCount; ++i) {
+        above += buckets[i];
+    }
+    return above;
+}
+
+// 格式：版本字节，随后是 (与上一个非零桶的下标差, 计数) 的 varint 序列
+std::string LatencyHistogram::serialize() const {
+    std::string data(1, static_cast<char>(kSerializationVersion));
+    size_t lastIndex = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        if (buckets[i] == 0) {
+            continue;
+        }
+        putVarint(data, i - lastIndex);
+        putVarint(data, buckets[i]);
+        lastIndex = i;
+    }
+    return data;
+}
+
+LatencyHistogram LatencyHistogram::deserialize(const std::string& data) {
+    LatencyHistogram histogram;
+    if (data.empty() || static_cast<uint8_t>(data[0]) != kSerializationVersion) {
+        return histogram;
+    }
+
+    size_t pos = 1;
+    size_t index = 0;
+    while (pos < data.size()) {
+        uint64_t delta = 0;
+        uint64_t value = 0;
+        if (!getVarint(data, pos, delta) || !getVarint(data, pos, value) || index + delta >= kBucketCount) {
+            return LatencyHistogram();  // 数据损坏时丢弃
+        }
+        index += delta;
+        histogram.buckets[index] += value;
+        histogram.total += value;
+    }
+    return histogram;
+}
+
+std::string routeOf(const std::string& requestPath) {
+    if (requestPath.empty() || requestPath[0] != '/') {
+        return "/";
+    }
+    size_t end = requestPath.find('/', 1);
+    return end == std::string::npos ? requestPath : requestPath.substr(0, end);
+}
+
+// ---------------- UsageBucket ----------------
+
+int UsageBucket::averageResponseTime() const {
+    return totalRequests > 0 ? static_cast<int>(sumResponseTime / totalRequests) : 0;
+}
+
+// ---------------- StatisticsAggregator ----------------
+
+StatisticsAggregator::StatisticsAggregator(int bucketSeconds, int graceSeconds)
+    : bucketSeconds(bucketSeconds > 0 ? bucketSeconds : 60), graceSeconds(graceSeconds >= 0 ? graceSeconds : 0) {}
+
+void StatisticsAggregator::add(const RequestRecord& record) {
+    int64_t requestTime = toEpochSeconds(record.requestTime);
+    int64_t periodStart = requestTime - (requestTime % bucketSeconds);
+
+    UsageBucket& bucket = buckets[periodStart];
+    bucket.periodStart = periodStart;
+    bucket.totalRequests++;
+    if (record.statusCode >= 200 && record.statusCode < 300) {
+        bucket.successfulRequests++;
+    } else if (record.statusCode >= 400) {
+        bucket.failedRequests++;
+    }
+    bucket.totalRequestSize += record.requestSize;
+    bucket.totalResponseSize += record.responseSize;
+    bucket.maxRequestSize = std::max(bucket.maxRequestSize, record.requestSize);
+    bucket.maxResponseSize = std::max(bucket.maxResponseSize, record.responseSize);
+    bucket.maxConcurrentRequests = std::max(bucket.maxConcurrentRequests, record.concurrentRequests);
+    bucket.maxResponseTime = std::max(bucket.maxResponseTime, record.responseTime);
+    bucket.sumResponseTime += record.responseTime;
+    bucket.uniqueIps.add(record.clientIp);
+    bucket.responseTimes.record(record.responseTime);
+    bucket.routeResponseTimes[routeOf(record.requestPath)].record(record.responseTime);
+    bucket.urlCounts[record.requestPath]++;
+}
+
+std::vector<UsageBucket> StatisticsAggregator::takeCompletedBuckets(const std::chrono::system_clock::time_point& now) {
+    std::vector<UsageBucket> completed;
+    int64_t nowSeconds = toEpochSeconds(now);
+
+    auto it = buckets.begin();
+    while (it != buckets.end() && it->first + bucketSeconds + graceSeconds <= nowSeconds) {
+        completed.push_back(std::move(it->second));
+        it = buckets.erase(it);
+    }
+    return completed;
+}
+
+std::vector<UsageBucket> StatisticsAggregator::takeAllBuckets() {
+    std::vector<UsageBucket> all;
+    for (auto& entry : buckets) {
+        all.push_back(std::move(entry.second));
+    }
+    buckets.clear();
+    return all;
+}
+
+int StatisticsAggregator::getBucketSeconds() const {
+    return bucketSeconds;
+}
+
+// ---------------- LatencyWindow ----------------
+
+LatencyWindow::LatencyWindow(int windowSeconds)
+    : windowLength(std::chrono::seconds(windowSeconds > 0 ? windowSeconds : 60)), windowStart(std::chrono::steady_clock::now()) {}
+
+// 窗口到期时把当前窗口降为上一个窗口；空闲超过两个窗口则全部清空
+void LatencyWindow::rotate(const std::chrono::steady_clock::time_point& now) {
+    if (now - windowStart < windowLength) {
+        return;
+    }
+    if (now - windowStart < 2 * windowLength) {
+        previous = std::move(current);
+    } else {
+        previous.clear();
+    }
+    current.clear();
+    windowStart = now;
+}
+
+void LatencyWindow::record(const std::string& route, int responseTimeMs, const std::chrono::steady_clock::time_point& now) {
+    rotate(now);
+    current[route].record(responseTimeMs);
+}
+
+LatencyPercentiles LatencyWindow::snapshot(const std::string& route, const std::chrono::steady_clock::time_point& now) {
+    rotate(now);
+    LatencyHistogram merged;
+    for (const auto* window : {&previous, &current}) {
+        for (const auto& entry : *window) {
+            if (route.empty() || entry.first == route) {
+                merged.merge(entry.second);
+            }
+        }
+    }
+    return merged.percentiles();
+}
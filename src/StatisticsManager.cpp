@@ -5,128 +5,638 @@
 #include "utils.h"
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <map>
+
+namespace {
+
+// 绑定参数并执行已准备好的语句，执行后重置以便复用
+bool bindAndStep(sqlite3* db, sqlite3_stmt* stmt, const std::vector<SQLParam>& params) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    for (size_t i = 0; i < params.size(); ++i) {
+        int index = static_cast<int>(i + 1);
+        const SQLParam& param = params[i];
+        switch (param.type) {
+            case SQLParam::Type::Text:
+                sqlite3_bind_text(stmt, index, param.textValue.c_str(), -1, SQLITE_TRANSIENT);
+                break;
+            case SQLParam::Type::Int:
+                sqlite3_bind_int(stmt, index, param.intValue);
+                break;
+            case SQLParam::Type::Int64:
+                sqlite3_bind_int64(stmt, index, param.int64Value);
+                break;
+            case SQLParam::Type::Double:
+                sqlite3_bind_double(stmt, index, param.doubleValue);
+                break;
+            case SQLParam::Type::Blob:
+                sqlite3_bind_blob(stmt, index, param.textValue.data(), static_cast<int>(param.textValue.size()), SQLITE_TRANSIENT);
+                break;
+        }
+    }
 
-StatisticsManager::StatisticsManager(DBManager& dbManager) : dbManager(dbManager) {}
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log(LogLevel::LOGERROR, "Failed to execute batched statistics statement: " + std::string(sqlite3_errmsg(db)));
+        return false;
+    }
+    return true;
+}
+
+int64_t toEpochSeconds(const std::chrono::system_clock::time_point& timePoint) {
+    return std::chrono::duration_cast<std::chrono::seconds>(timePoint.time_since_epoch()).count();
+}
+
+// 读取 BLOB 列，NULL 时返回空串
+std::string columnBlob(sqlite3_stmt* stmt, int column) {
+    const void* data = sqlite3_column_blob(stmt, column);
+    int size = sqlite3_column_bytes(stmt, column);
+    if (data == nullptr || size <= 0) {
+        return std::string();
+    }
+    return std::string(static_cast<const char*>(data), static_cast<size_t>(size));
+}
+
+// 汇总粒度：表名与桶宽度（秒）
+struct RollupGranularity {
+    const char* table;
+    int bucketSeconds;
+    bool routes;  // 是否同时维护按路由的响应时间汇总
+};
+
+const RollupGranularity kRollupGranularities[] = {
+    {"request_rollup_minute", 60, true},
+    {"request_rollup_hour", 3600, true},
+    {"request_rollup_day", 86400, false},
+};
+
+const int kRetentionIntervalSeconds = 60;
+
+// 提交事务，失败时（例如锁等待超时后的 SQLITE_BUSY）回滚，避免连接带着未结束的事务回到连接池
+bool commitOrRollback(sqlite3* db, const std::string& context) {
+    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK) {
+        return true;
+    }
+    log(LogLevel::LOGERROR, context + " - Failed to commit transaction: " + std::string(sqlite3_errmsg(db)));
+    sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    return false;
+}
+
+}  // namespace
+
+StatisticsManager::StatisticsManager(DBManager& dbManager, size_t bufferCapacity, int flushIntervalMs, size_t flushBatchSize, int bucketSeconds,
+                                     const StatisticsRetention& retention)
+    : dbManager(dbManager), ringBuffer(bufferCapacity > 0 ? bufferCapacity : 1), ringHead(0), ringSize(0), droppedRecords(0),
+      flushIntervalMs(flushIntervalMs > 0 ? flushIntervalMs : 1000), flushBatchSize(flushBatchSize > 0 ? flushBatchSize : 1), stopWriter(false),
+      aggregator(bucketSeconds, flushIntervalMs / 1000 + 5), inFlightRequests(0), retention(retention),
+      lastRetentionRun(std::chrono::steady_clock::now()), retentionBacklog(true) {
+    writerThread = std::thread(&StatisticsManager::writerLoop, this);
+}
+
+StatisticsManager::~StatisticsManager() {
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        stopWriter = true;
+    }
+    bufferCondition.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();  // 写入线程退出前会把缓冲区剩余记录写完
+    }
+}
+
+// 记录一次请求：只在缓冲区中占一个槽位，不触碰数据库
+bool StatisticsManager::recordRequest(RequestRecord record) {
+    {
+        std::lock_guard<std::mutex> lock(liveLatencyMutex);
+        liveLatency.record(routeOf(record.requestPath), record.responseTime, std::chrono::steady_clock::now());
+    }
+
+    bool shouldWake = false;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        if (ringSize >= ringBuffer.size()) {
+            // 缓冲区已满：丢弃新记录，保证统计永远不会拖慢请求处理
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        ringBuffer[(ringHead + ringSize) % ringBuffer.size()] = std::move(record);
+        ++ringSize;
+        shouldWake = (ringSize >= flushBatchSize);
+    }
+
+    if (shouldWake) {
+        bufferCondition.notify_one();
+    }
+    return true;
+}
+
+size_t StatisticsManager::getDroppedRecordCount() const {
+    return droppedRecords.load(std::memory_order_relaxed);
+}
+
+int StatisticsManager::beginRequest() {
+    return inFlightRequests.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void StatisticsManager::endRequest() {
+    inFlightRequests.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// 从环形缓冲区取出最多 maxRecords 条记录
+size_t StatisticsManager::drainBuffer(std::vector<RequestRecord>& batch, size_t maxRecords) {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    size_t count = std::min(ringSize, maxRecords);
+    for (size_t i = 0; i < count; ++i) {
+        batch.push_back(std::move(ringBuffer[ringHead]));
+        ringHead = (ringHead + 1) % ringBuffer.size();
+    }
+    ringSize -= count;
+    return count;
+}
+
+void StatisticsManager::flush() {
+    flushPending(false);
+}
+
+// 写入缓冲区中的原始记录，并将已经结束的聚合桶落库；persistOpenBuckets 为 true 时连同未结束的桶一起落库
+void StatisticsManager::flushPending(bool persistOpenBuckets) {
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+    std::vector<RequestRecord> batch;
+    batch.reserve(flushBatchSize);
+    while (drainBuffer(batch, flushBatchSize) > 0) {
+        writeBatch(batch);
+        batch.clear();
+    }
+
+    if (persistOpenBuckets) {
+        persistBuckets(aggregator.takeAllBuckets());
+    } else {
+        persistBuckets(aggregator.takeCompletedBuckets(std::chrono::system_clock::now()));
+    }
+}
+
+// 后台写入线程：每隔 flushIntervalMs 或缓冲区累计 flushBatchSize 条记录时批量写入
+void StatisticsManager::writerLoop() {
+    // 首次启用汇总表时，用已有的原始记录补齐汇总数据
+    {
+        std::lock_guard<std::mutex> flushLock(flushMutex);
+        backfillRollups();
+    }
+
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(bufferMutex);
+            bufferCondition.wait_for(lock, std::chrono::milliseconds(flushIntervalMs), [this]() {
+                return stopWriter || ringSize >= flushBatchSize;
+            });
+            stopping = stopWriter;
+        }
+
+        // 退出前把尚未结束的聚合桶也写入，避免丢失
+        flushPending(stopping);
+
+        if (stopping) {
+            break;
+        }
+
+        // 过期数据每分钟清理一次；若上次没删完则在下一轮继续
+        auto now = std::chrono::steady_clock::now();
+        if (retentionBacklog || now - lastRetentionRun >= std::chrono::seconds(kRetentionIntervalSeconds)) {
+            lastRetentionRun = now;
+            applyRetention();
+        }
+    }
+}
+
+// 在一个事务中写入整批原始记录，复用预编译语句；同时把记录累加到内存聚合桶
+void StatisticsManager::writeBatch(const std::vector<RequestRecord>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+
+    // 历史 URL 计数在批内先合并，每个 URL 只写一次
+    std::unordered_map<std::string, int> historyCounts;
+    for (const auto& record : batch) {
+        aggregator.add(record);
+        historyCounts[record.requestPath]++;
+    }
 
-// 插入请求统计
-void StatisticsManager::insertRequestStatistics(const std::string& clientIp, const std::string& requestPath, const std::string& httpMethod,
-                                                int responseTime, int statusCode, int responseSize, int requestSize, const std::string& fileType, int requestLatency) {
-    // 从连接池中获取一个连接，保证线程独立的连接使用
     sqlite3* db = dbManager.getDbConnection();
+    if (db == nullptr) {
+        log(LogLevel::LOGERROR, "writeBatch - No database connection available, dropping " + std::to_string(batch.size()) + " records.");
+        droppedRecords.fetch_add(batch.size(), std::memory_order_relaxed);
+        return;
+    }
 
     // 设置锁等待时间，避免频繁锁定
     sqlite3_busy_timeout(db, 5000);
 
-    // 开启事务
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    if (sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "writeBatch - Failed to begin transaction: " + std::string(sqlite3_errmsg(db)));
+        droppedRecords.fetch_add(batch.size(), std::memory_order_relaxed);
+        dbManager.releaseDbConnection(db);
+        return;
+    }
+
+    const char* insertSQL = "INSERT INTO request_statistics (client_ip, request_path, http_method, request_time, response_time, status_code, response_size, request_size, file_type, request_latency) "
+                            "VALUES (?, ?, ?, datetime(?, 'unixepoch'), ?, ?, ?, ?, ?, ?)";
+    const char* historySQL = "INSERT INTO top_urls_history (url, total_request_count) "
+                             "VALUES (?, ?) "
+                             "ON CONFLICT(url) DO UPDATE SET total_request_count = total_request_count + excluded.total_request_count";
 
-    // 插入 request_statistics 表
-    std::string query = "INSERT INTO request_statistics (client_ip, request_path, http_method, request_time, response_time, status_code, response_size, request_size, file_type, request_latency) "
-                        "VALUES (?, ?, ?, datetime('now'), ?, ?, ?, ?, ?, ?)";
-    std::vector<SQLParam> params = {
-        clientIp, requestPath, httpMethod, responseTime, statusCode, responseSize, requestSize, fileType, requestLatency
-    };
-    executeSQL(db, query, params);
+    sqlite3_stmt* insertStmt = nullptr;
+    sqlite3_stmt* historyStmt = nullptr;
 
-    // 更新 URL 统计信息，合并到一个事务中
-    updateTopUrlsInTransaction(db, std::chrono::system_clock::now(), requestPath);
+    bool prepared = sqlite3_prepare_v2(db, insertSQL, -1, &insertStmt, nullptr) == SQLITE_OK &&
+                    sqlite3_prepare_v2(db, historySQL, -1, &historyStmt, nullptr) == SQLITE_OK;
 
-    // 提交事务
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    if (prepared) {
+        for (const auto& record : batch) {
+            bindAndStep(db, insertStmt, {record.clientIp, record.requestPath, record.httpMethod, toEpochSeconds(record.requestTime), record.responseTime,
+                                         record.statusCode, record.responseSize, record.requestSize, record.fileType, record.requestLatency});
+        }
+        for (const auto& entry : historyCounts) {
+            bindAndStep(db, historyStmt, {entry.first, entry.second});
+        }
+        updateRollups(db, batch);
+        if (!commitOrRollback(db, "writeBatch")) {
+            log(LogLevel::LOGERROR, "writeBatch - Dropping " + std::to_string(batch.size()) + " records.");
+            droppedRecords.fetch_add(batch.size(), std::memory_order_relaxed);
+        }
+    } else {
+        log(LogLevel::LOGERROR, "writeBatch - Failed to prepare SQL statement: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        droppedRecords.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+
+    sqlite3_finalize(insertStmt);
+    sqlite3_finalize(historyStmt);
 
-    // 释放连接到连接池中
     dbManager.releaseDbConnection(db);
 }
 
-void StatisticsManager::updateTopUrlsInTransaction(sqlite3* db, const std::chrono::time_point<std::chrono::system_clock>& periodStart, const std::string& url) {
-    std::string periodQuery = "INSERT INTO top_urls_period (period_start, url, request_count) "
-                              "VALUES (?, ?, 1) "
-                              "ON CONFLICT(period_start, url) DO UPDATE SET request_count = request_count + 1";
-    std::vector<SQLParam> periodParams = {
-        static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(periodStart.time_since_epoch()).count()), url
-    };
-    executeSQL(db, periodQuery, periodParams);
-
-    std::string historyQuery = "INSERT INTO top_urls_history (url, total_request_count) "
-                               "VALUES (?, 1) "
-                               "ON CONFLICT(url) DO UPDATE SET total_request_count = total_request_count + 1";
-    std::vector<SQLParam> historyParams = { url };
-    executeSQL(db, historyQuery, historyParams);
-}
+// 每个聚合桶写入一行 service_usage，桶内每个 URL 写入一行 top_urls_period
+void StatisticsManager::persistBuckets(const std::vector<UsageBucket>& completedBuckets) {
+    if (completedBuckets.empty()) {
+        return;
+    }
 
-// 更新服务使用数据
-void StatisticsManager::updateServiceUsage(const std::chrono::time_point<std::chrono::system_clock>& periodStart, int totalRequests, int successfulRequests,
-                                           int failedRequests, int totalRequestSize, int totalResponseSize, int uniqueIps, int maxConcurrentRequests,
-                                           int maxResponseTime, int avgResponseTime) {
     sqlite3* db = dbManager.getDbConnection();
-    
-    // 开启事务
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    if (db == nullptr) {
+        log(LogLevel::LOGERROR, "persistBuckets - No database connection available, dropping " + std::to_string(completedBuckets.size()) + " buckets.");
+        return;
+    }
 
-    std::string query = "INSERT OR REPLACE INTO service_usage (period_start, total_requests, successful_requests, failed_requests, "
-                        "total_request_size, total_response_size, unique_ips, max_concurrent_requests, max_response_time, avg_response_time) "
-                        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
-    std::vector<SQLParam> params = {
-        static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(periodStart.time_since_epoch()).count()),
-        totalRequests, successfulRequests, failedRequests, totalRequestSize, totalResponseSize, uniqueIps, maxConcurrentRequests, maxResponseTime, avgResponseTime
-    };
-    executeSQL(db, query, params);
+    sqlite3_busy_timeout(db, 5000);
+
+    if (sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "persistBuckets - Failed to begin transaction: " + std::string(sqlite3_errmsg(db)));
+        dbManager.releaseDbConnection(db);
+        return;
+    }
+
+    // 迟到的记录可能让同一个桶写入两次，此时累加而不是覆盖
+    const char* usageSQL = "INSERT INTO service_usage (period_start, total_requests, successful_requests, failed_requests, "
+                           "total_request_size, total_response_size, unique_ips, max_concurrent_requests, max_response_time, avg_response_time) "
+                           "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+                           "ON CONFLICT(period_start) DO UPDATE SET "
+                           "avg_response_time = (avg_response_time * total_requests + excluded.avg_response_time * excluded.total_requests) "
+                           "/ (total_requests + excluded.total_requests), "
+                           "total_requests = total_requests + excluded.total_requests, "
+                           "successful_requests = successful_requests + excluded.successful_requests, "
+                           "failed_requests = failed_requests + excluded.failed_requests, "
+                           "total_request_size = total_request_size + excluded.total_request_size, "
+                           "total_response_size = total_response_size + excluded.total_response_size, "
+                           "unique_ips = MAX(unique_ips, excluded.unique_ips), "
+                           "max_concurrent_requests = MAX(max_concurrent_requests, excluded.max_concurrent_requests), "
+                           "max_response_time = MAX(max_response_time, excluded.max_response_time)";
+    const char* periodSQL = "INSERT INTO top_urls_period (period_start, url, request_count) "
+                            "VALUES (?, ?, ?) "
+                            "ON CONFLICT(period_start, url) DO UPDATE SET request_count = request_count + excluded.request_count";
+
+    sqlite3_stmt* usageStmt = nullptr;
+    sqlite3_stmt* periodStmt = nullptr;
+
+    bool prepared = sqlite3_prepare_v2(db, usageSQL, -1, &usageStmt, nullptr) == SQLITE_OK &&
+                    sqlite3_prepare_v2(db, periodSQL, -1, &periodStmt, nullptr) == SQLITE_OK;
+
+    if (prepared) {
+        for (const auto& bucket : completedBuckets) {
+            bindAndStep(db, usageStmt, {bucket.periodStart, bucket.totalRequests, bucket.successfulRequests, bucket.failedRequests,
+                                        bucket.totalRequestSize, bucket.totalResponseSize, static_cast<int64_t>(bucket.uniqueIps.estimate()),
+                                        bucket.maxConcurrentRequests, bucket.maxResponseTime, bucket.averageResponseTime()});
+            for (const auto& entry : bucket.urlCounts) {
+                bindAndStep(db, periodStmt, {bucket.periodStart, entry.first, entry.second});
+            }
+        }
+        if (!commitOrRollback(db, "persistBuckets")) {
+            log(LogLevel::LOGERROR, "persistBuckets - Dropping " + std::to_string(completedBuckets.size()) + " buckets.");
+        }
+    } else {
+        log(LogLevel::LOGERROR, "persistBuckets - Failed to prepare SQL statement: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+
+    sqlite3_finalize(usageStmt);
+    sqlite3_finalize(periodStmt);
 
-    // 提交事务
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-    
-    // 释放连接
     dbManager.releaseDbConnection(db);
 }
 
-// 执行 SQL 插入或更新
-void StatisticsManager::executeSQL(sqlite3* db, const std::string& query, const std::vector<SQLParam>& params) {
-    sqlite3_stmt* stmt;
+// 增量维护汇总表：批内先按桶聚合，再与已落库的桶合并（HyperLogLog 与直方图在内存中合并）
+void StatisticsManager::updateRollups(sqlite3* db, const std::vector<RequestRecord>& batch) {
+    for (const auto& granularity : kRollupGranularities) {
+        StatisticsAggregator batchAggregator(granularity.bucketSeconds, 0);
+        for (const auto& record : batch) {
+            batchAggregator.add(record);
+        }
 
-    // 准备 SQL 语句
-    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-        // 绑定参数
-        for (size_t i = 0; i < params.size(); ++i) {
-            int index = static_cast<int>(i + 1);
-            const SQLParam& param = params[i];
-            switch (param.type) {
-                case SQLParam::Type::Text:
-                    sqlite3_bind_text(stmt, index, param.textValue.c_str(), -1, SQLITE_TRANSIENT);
-                    break;
-                case SQLParam::Type::Int:
-                    sqlite3_bind_int(stmt, index, param.intValue);
-                    break;
-                case SQLParam::Type::Double:
-                    sqlite3_bind_double(stmt, index, param.doubleValue);
-                    break;
+        std::string table = granularity.table;
+        std::string selectSQL = "SELECT unique_ips_sketch, response_time_histogram FROM " + table + " WHERE bucket_start = ?";
+        std::string upsertSQL = "INSERT INTO " + table + " (bucket_start, total_requests, successful_requests, failed_requests, "
+                                "total_request_size, total_response_size, max_request_size, max_response_size, sum_response_time, "
+                                "max_response_time, unique_ips, unique_ips_sketch, response_time_histogram) "
+                                "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+                                "ON CONFLICT(bucket_start) DO UPDATE SET "
+                                "total_requests = total_requests + excluded.total_requests, "
+                                "successful_requests = successful_requests + excluded.successful_requests, "
+                                "failed_requests = failed_requests + excluded.failed_requests, "
+                                "total_request_size = total_request_size + excluded.total_request_size, "
+                                "total_response_size = total_response_size + excluded.total_response_size, "
+                                "max_request_size = MAX(max_request_size, excluded.max_request_size), "
+                                "max_response_size = MAX(max_response_size, excluded.max_response_size), "
+                                "sum_response_time = sum_response_time + excluded.sum_response_time, "
+                                "max_response_time = MAX(max_response_time, excluded.max_response_time), "
+                                "unique_ips = excluded.unique_ips, "
+                                "unique_ips_sketch = excluded.unique_ips_sketch, "
+                                "response_time_histogram = excluded.response_time_histogram";
+
+        sqlite3_stmt* selectStmt = nullptr;
+        sqlite3_stmt* upsertStmt = nullptr;
+        if (sqlite3_prepare_v2(db, selectSQL.c_str(), -1, &selectStmt, nullptr) != SQLITE_OK ||
+            sqlite3_prepare_v2(db, upsertSQL.c_str(), -1, &upsertStmt, nullptr) != SQLITE_OK) {
+            log(LogLevel::LOGERROR, "updateRollups - Failed to prepare SQL statement for " + table + ": " + std::string(sqlite3_errmsg(db)));
+            sqlite3_finalize(selectStmt);
+            sqlite3_finalize(upsertStmt);
+            continue;
+        }
+
+        for (auto& bucket : batchAggregator.takeAllBuckets()) {
+            sqlite3_reset(selectStmt);
+            sqlite3_bind_int64(selectStmt, 1, bucket.periodStart);
+            if (sqlite3_step(selectStmt) == SQLITE_ROW) {
+                bucket.uniqueIps.merge(HyperLogLog::deserialize(columnBlob(selectStmt, 0)));
+                bucket.responseTimes.merge(LatencyHistogram::deserialize(columnBlob(selectStmt, 1)));
+            }
+
+            bindAndStep(db, upsertStmt, {bucket.periodStart, bucket.totalRequests, bucket.successfulRequests, bucket.failedRequests,
+                                         bucket.totalRequestSize, bucket.totalResponseSize, bucket.maxRequestSize, bucket.maxResponseSize,
+                                         bucket.sumResponseTime, bucket.maxResponseTime, static_cast<int64_t>(bucket.uniqueIps.estimate()),
+                                         SQLParam::blob(bucket.uniqueIps.serialize()), SQLParam::blob(bucket.responseTimes.serialize())});
+
+            if (granularity.routes) {
+                updateRouteRollups(db, granularity.bucketSeconds, bucket);
             }
         }
 
-        // 执行 SQL 语句
-        if (sqlite3_step(stmt) != SQLITE_DONE) {
-            log(LogLevel::LOGERROR, query + " Failed to execute SQL statement: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_finalize(selectStmt);
+        sqlite3_finalize(upsertStmt);
+    }
+
+    // 按天、按维度汇总：请求方法、状态码、文件类型、客户端 IP
+    std::map<std::tuple<int64_t, std::string, std::string>, std::pair<int, int64_t>> dimensionCounts;
+    for (const auto& record : batch) {
+        int64_t requestTime = toEpochSeconds(record.requestTime);
+        int64_t day = requestTime - (requestTime % 86400);
+        int64_t traffic = static_cast<int64_t>(record.requestSize) + record.responseSize;
+        const std::pair<const char*, std::string> dimensions[] = {
+            {"method", record.httpMethod},
+            {"status", std::to_string(record.statusCode)},
+            {"file_type", record.fileType},
+            {"ip", record.clientIp},
+        };
+        for (const auto& dimension : dimensions) {
+            auto& entry = dimensionCounts[std::make_tuple(day, dimension.first, dimension.second)];
+            entry.first++;
+            entry.second += traffic;
         }
-        sqlite3_finalize(stmt);
+    }
+
+    const char* dimensionSQL = "INSERT INTO request_rollup_dimension (bucket_start, dimension, value, request_count, traffic) "
+                               "VALUES (?, ?, ?, ?, ?) "
+                               "ON CONFLICT(bucket_start, dimension, value) DO UPDATE SET "
+                               "request_count = request_count + excluded.request_count, traffic = traffic + excluded.traffic";
+    sqlite3_stmt* dimensionStmt = nullptr;
+    if (sqlite3_prepare_v2(db, dimensionSQL, -1, &dimensionStmt, nullptr) == SQLITE_OK) {
+        for (const auto& entry : dimensionCounts) {
+            bindAndStep(db, dimensionStmt, {std::get<0>(entry.first), std::get<1>(entry.first), std::get<2>(entry.first),
+                                            entry.second.first, entry.second.second});
+        }
+    } else {
+        log(LogLevel::LOGERROR, "updateRollups - Failed to prepare dimension SQL statement: " + std::string(sqlite3_errmsg(db)));
+    }
+    sqlite3_finalize(dimensionStmt);
+}
+
+// 按路由合并并写入响应时间直方图
+void StatisticsManager::updateRouteRollups(sqlite3* db, int granularity, const UsageBucket& bucket) {
+    const char* selectSQL = "SELECT response_time_histogram FROM request_rollup_route WHERE granularity = ? AND bucket_start = ? AND route = ?";
+    const char* upsertSQL = "INSERT INTO request_rollup_route (granularity, bucket_start, route, request_count, response_time_histogram) "
+                            "VALUES (?, ?, ?, ?, ?) "
+                            "ON CONFLICT(granularity, bucket_start, route) DO UPDATE SET "
+                            "request_count = request_count + excluded.request_count, "
+                            "response_time_histogram = excluded.response_time_histogram";
+    sqlite3_stmt* selectStmt = nullptr;
+    sqlite3_stmt* upsertStmt = nullptr;
+    if (sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, upsertSQL, -1, &upsertStmt, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "updateRouteRollups - Failed to prepare SQL statement: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_finalize(selectStmt);
+        sqlite3_finalize(upsertStmt);
+        return;
+    }
+
+    for (const auto& entry : bucket.routeResponseTimes) {
+        LatencyHistogram merged = entry.second;
+        sqlite3_reset(selectStmt);
+        sqlite3_bind_int(selectStmt, 1, granularity);
+        sqlite3_bind_int64(selectStmt, 2, bucket.periodStart);
+        sqlite3_bind_text(selectStmt, 3, entry.first.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(selectStmt) == SQLITE_ROW) {
+            merged.merge(LatencyHistogram::deserialize(columnBlob(selectStmt, 0)));
+        }
+
+        bindAndStep(db, upsertStmt, {granularity, bucket.periodStart, entry.first, static_cast<int64_t>(entry.second.count()),
+                                     SQLParam::blob(merged.serialize())});
+    }
+
+    sqlite3_finalize(selectStmt);
+    sqlite3_finalize(upsertStmt);
+}
+
+// 汇总表第一次启用时，用已有的原始记录在一个事务中补齐汇总数据
+void StatisticsManager::backfillRollups() {
+    sqlite3* db = dbManager.getDbConnection();
+    if (db == nullptr) {
+        return;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    bool backfilled = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT value FROM settings WHERE key = 'statistics_rollups_backfilled'", -1, &stmt, nullptr) == SQLITE_OK) {
+        backfilled = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+
+    if (backfilled) {
+        dbManager.releaseDbConnection(db);
+        return;
+    }
+
+    log(LogLevel::INFO, "Backfilling statistics rollups from request_statistics...");
+    if (sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "backfillRollups - Failed to begin transaction: " + std::string(sqlite3_errmsg(db)));
+        dbManager.releaseDbConnection(db);
+        return;
+    }
+
+    const char* selectSQL = "SELECT client_ip, request_path, http_method, CAST(strftime('%s', request_time) AS INTEGER), response_time, "
+                            "status_code, response_size, request_size, file_type, request_latency "
+                            "FROM request_statistics ORDER BY id";
+    size_t total = 0;
+    if (sqlite3_prepare_v2(db, selectSQL, -1, &stmt, nullptr) == SQLITE_OK) {
+        std::vector<RequestRecord> chunk;
+        chunk.reserve(flushBatchSize);
+        auto columnText = [&stmt](int column) {
+            const unsigned char* text = sqlite3_column_text(stmt, column);
+            return text ? std::string(reinterpret_cast<const char*>(text)) : std::string();
+        };
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            RequestRecord record;
+            record.clientIp = columnText(0);
+            record.requestPath = columnText(1);
+            record.httpMethod = columnText(2);
+            record.requestTime = std::chrono::system_clock::time_point(std::chrono::seconds(sqlite3_column_int64(stmt, 3)));
+            record.responseTime = sqlite3_column_int(stmt, 4);
+            record.statusCode = sqlite3_column_int(stmt, 5);
+            record.responseSize = sqlite3_column_int(stmt, 6);
+            record.requestSize = sqlite3_column_int(stmt, 7);
+            record.fileType = columnText(8);
+            record.requestLatency = sqlite3_column_int(stmt, 9);
+            chunk.push_back(std::move(record));
+
+            if (chunk.size() >= flushBatchSize) {
+                updateRollups(db, chunk);
+                total += chunk.size();
+                chunk.clear();
+            }
+        }
+        updateRollups(db, chunk);
+        total += chunk.size();
     } else {
-        log(LogLevel::LOGERROR, query + " Failed to prepare SQL statement: " + std::string(sqlite3_errmsg(db)));
+        log(LogLevel::LOGERROR, "backfillRollups - Failed to prepare SELECT statement: " + std::string(sqlite3_errmsg(db)));
+    }
+    sqlite3_finalize(stmt);
+
+    sqlite3_exec(db, "INSERT OR REPLACE INTO settings (key, value) VALUES ('statistics_rollups_backfilled', '1');", nullptr, nullptr, nullptr);
+    // 提交失败时标记也一起回滚，下次启动重新回填
+    bool committed = commitOrRollback(db, "backfillRollups");
+    dbManager.releaseDbConnection(db);
+
+    if (committed) {
+        log(LogLevel::INFO, "Statistics rollups backfilled from " + std::to_string(total) + " records.");
+    }
+}
+
+// 按保留策略分批删除过期的原始记录和汇总数据，每张表每轮最多删除 deleteBatchSize 行
+void StatisticsManager::applyRetention() {
+    sqlite3* db = dbManager.getDbConnection();
+    if (db == nullptr) {
+        return;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    int64_t now = toEpochSeconds(std::chrono::system_clock::now());
+    int64_t rawCutoff = now - static_cast<int64_t>(retention.rawDays) * 86400;
+    int64_t minuteCutoff = now - static_cast<int64_t>(retention.minuteRollupDays) * 86400;
+    int64_t hourCutoff = now - static_cast<int64_t>(retention.hourRollupDays) * 86400;
+
+    int deleted[] = {
+        deleteExpiredRows(db, "request_statistics", "request_time < datetime(?, 'unixepoch')", rawCutoff),
+        deleteExpiredRows(db, "top_urls_period", "period_start < ?", rawCutoff),
+        deleteExpiredRows(db, "request_rollup_minute", "bucket_start < ?", minuteCutoff),
+        deleteExpiredRows(db, "request_rollup_hour", "bucket_start < ?", hourCutoff),
+        deleteExpiredRows(db, "request_rollup_route", "granularity = 60 AND bucket_start < ?", minuteCutoff),
+        deleteExpiredRows(db, "request_rollup_route", "granularity = 3600 AND bucket_start < ?", hourCutoff),
+        deleteExpiredRows(db, "service_usage", "period_start < ?", hourCutoff),
+        // 按天、按维度的汇总每天每个 IP/方法/状态码/文件类型一行，同样只保留最近 hourRollupDays 天，
+        // 否则分布统计的 GROUP BY 开销会随历史增长
+        deleteExpiredRows(db, "request_rollup_dimension", "bucket_start < ?", hourCutoff),
+    };
+
+    retentionBacklog = false;
+    for (int count : deleted) {
+        if (count >= retention.deleteBatchSize) {
+            retentionBacklog = true;  // 还有未删完的数据，下一轮继续
+        }
     }
+
+    dbManager.releaseDbConnection(db);
 }
 
+int StatisticsManager::deleteExpiredRows(sqlite3* db, const std::string& table, const std::string& condition, int64_t threshold) {
+    std::string deleteSQL = "DELETE FROM " + table + " WHERE rowid IN (SELECT rowid FROM " + table + " WHERE " + condition + " LIMIT ?)";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, deleteSQL.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "deleteExpiredRows - Failed to prepare DELETE statement for " + table + ": " + std::string(sqlite3_errmsg(db)));
+        return 0;
+    }
+
+    int deleted = 0;
+    if (bindAndStep(db, stmt, {threshold, retention.deleteBatchSize})) {
+        deleted = sqlite3_changes(db);
+    }
+    sqlite3_finalize(stmt);
+    return deleted;
+}
+
+// 插入请求统计（写入缓冲区，由后台线程批量落库）
+void StatisticsManager::insertRequestStatistics(const std::string& clientIp, const std::string& requestPath, const std::string& httpMethod,
+                                                int responseTime, int statusCode, int responseSize, int requestSize, const std::string& fileType, int requestLatency) {
+    RequestRecord record;
+    record.clientIp = clientIp;
+    record.requestPath = requestPath;
+    record.httpMethod = httpMethod;
+    record.fileType = fileType;
+    record.responseTime = responseTime;
+    record.statusCode = statusCode;
+    record.responseSize = responseSize;
+    record.requestSize = requestSize;
+    record.requestLatency = requestLatency;
+    record.requestTime = std::chrono::system_clock::now();
+    recordRequest(std::move(record));
+}
+
+// 以下查询都基于汇总表，耗时与历史数据量无关
+
 // 获取总请求数
 int StatisticsManager::getTotalRequests() {
-    std::string query = "SELECT COUNT(*) FROM request_statistics";
+    std::string query = "SELECT COALESCE(SUM(total_requests), 0) FROM request_rollup_day";
     return executeCountQuery(query, {});
 }
 
 // 获取总流量消耗
 int StatisticsManager::getTotalTraffic() {
-    std::string query = "SELECT SUM(request_size + response_size) FROM request_statistics";
+    std::string query = "SELECT COALESCE(SUM(total_request_size + total_response_size), 0) FROM request_rollup_day";
     return executeCountQuery(query, {});
 }
 
 // 获取平均流量
 std::tuple<int, int> StatisticsManager::getAverageTraffic() {
-    std::string query = "SELECT AVG(request_size), AVG(response_size) FROM request_statistics";
+    std::string query = "SELECT SUM(total_request_size) / SUM(total_requests), SUM(total_response_size) / SUM(total_requests) FROM request_rollup_day";
     sqlite3* db = dbManager.getDbConnection();
     sqlite3_stmt* stmt;
     std::tuple<int, int> result(0, 0);
@@ -144,7 +654,7 @@ std::tuple<int, int> StatisticsManager::getAverageTraffic() {
 
 // 获取最大单次流量
 std::tuple<int, int> StatisticsManager::getMaxSingleTraffic() {
-    std::string query = "SELECT MAX(request_size), MAX(response_size) FROM request_statistics";
+    std::string query = "SELECT MAX(max_request_size), MAX(max_response_size) FROM request_rollup_day";
     sqlite3* db = dbManager.getDbConnection();
     sqlite3_stmt* stmt;
     std::tuple<int, int> result(0, 0);
@@ -160,26 +670,33 @@ std::tuple<int, int> StatisticsManager::getMaxSingleTraffic() {
     return result;
 }
 
-// 获取唯一 IP 数量
+// 获取唯一 IP 数量（合并每天的 HyperLogLog）
 int StatisticsManager::getUniqueIpCount() {
-    std::string query = "SELECT COUNT(DISTINCT client_ip) FROM request_statistics";
-    return executeCountQuery(query, {});
+    HyperLogLog uniqueIps;
+    mergeSketches("SELECT unique_ips_sketch, NULL FROM request_rollup_day", {}, &uniqueIps, nullptr);
+    return static_cast<int>(uniqueIps.estimate());
 }
 
 // 获取活跃 IP 数量
 int StatisticsManager::getActiveIpCount(const std::chrono::time_point<std::chrono::system_clock>& periodStart) {
-    std::string query = "SELECT COUNT(DISTINCT client_ip) FROM request_statistics WHERE request_time >= datetime(?, 'unixepoch')";
-    std::vector<SQLParam> params = {
-        static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(periodStart.time_since_epoch()).count())
-    };
-    return executeCountQuery(query, params);
+    int64_t start = toEpochSeconds(periodStart);
+    int64_t minuteCutoff = toEpochSeconds(std::chrono::system_clock::now()) - static_cast<int64_t>(retention.minuteRollupDays) * 86400;
+
+    // 分钟汇总仍在保留期内时用分钟粒度，否则退化为小时粒度
+    bool useMinutes = start >= minuteCutoff;
+    std::string table = useMinutes ? "request_rollup_minute" : "request_rollup_hour";
+    int64_t granularity = useMinutes ? 60 : 3600;
+
+    HyperLogLog uniqueIps;
+    mergeSketches("SELECT unique_ips_sketch, NULL FROM " + table + " WHERE bucket_start > ?", {start - granularity}, &uniqueIps, nullptr);
+    return static_cast<int>(uniqueIps.estimate());
 }
 
 // 获取 IP 请求统计信息
 std::vector<std::tuple<std::string, int, int>> StatisticsManager::getIpRequestStatistics() {
     std::vector<std::tuple<std::string, int, int>> stats;
     sqlite3* db = dbManager.getDbConnection();
-    std::string query = "SELECT client_ip, COUNT(*), SUM(request_size + response_size) FROM request_statistics GROUP BY client_ip";
+    std::string query = "SELECT value, SUM(request_count), SUM(traffic) FROM request_rollup_dimension WHERE dimension = 'ip' GROUP BY value";
     sqlite3_stmt* stmt;
 
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
@@ -197,14 +714,14 @@ std::vector<std::tuple<std::string, int, int>> StatisticsManager::getIpRequestSt
 
 // 请求方法分布
 std::vector<std::tuple<std::string, int>> StatisticsManager::getRequestMethodDistribution() {
-    return executeDistributionQuery("SELECT http_method, COUNT(*) FROM request_statistics GROUP BY http_method");
+    return executeDistributionQuery("SELECT value, SUM(request_count) FROM request_rollup_dimension WHERE dimension = 'method' GROUP BY value");
 }
 
 // 状态码分布
 std::vector<std::tuple<int, int>> StatisticsManager::getStatusCodeDistribution() {
     std::vector<std::tuple<int, int>> stats;
     sqlite3* db = dbManager.getDbConnection();
-    std::string query = "SELECT status_code, COUNT(*) FROM request_statistics GROUP BY status_code";
+    std::string query = "SELECT CAST(value AS INTEGER), SUM(request_count) FROM request_rollup_dimension WHERE dimension = 'status' GROUP BY value";
     sqlite3_stmt* stmt;
 
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
@@ -221,35 +738,62 @@ std::vector<std::tuple<int, int>> StatisticsManager::getStatusCodeDistribution()
 
 // 文件类型分布
 std::vector<std::tuple<std::string, int>> StatisticsManager::getFileTypeDistribution() {
-    return executeDistributionQuery("SELECT file_type, COUNT(*) FROM request_statistics GROUP BY file_type");
+    return executeDistributionQuery("SELECT value, SUM(request_count) FROM request_rollup_dimension WHERE dimension = 'file_type' GROUP BY value");
 }
 
 // 获取平均响应时间
 int StatisticsManager::getAverageResponseTime() {
-    std::string query = "SELECT AVG(response_time) FROM request_statistics";
+    std::string query = "SELECT SUM(sum_response_time) / SUM(total_requests) FROM request_rollup_day";
     return executeCountQuery(query, {});
 }
 
 // 获取最大响应时间
 int StatisticsManager::getMaxResponseTime() {
-    std::string query = "SELECT MAX(response_time) FROM request_statistics";
+    std::string query = "SELECT MAX(max_response_time) FROM request_rollup_day";
     return executeCountQuery(query, {});
 }
 
-// 获取 95% 响应时间
+// 获取 95% 响应时间（合并每天的响应时间直方图）
 int StatisticsManager::get95thPercentileResponseTime() {
-    std::string query = "SELECT response_time FROM request_statistics ORDER BY response_time LIMIT 1 OFFSET (SELECT COUNT(*) FROM request_statistics) * 95 / 100";
-    return executeCountQuery(query, {});
+    LatencyHistogram responseTimes;
+    mergeSketches("SELECT NULL, response_time_histogram FROM request_rollup_day", {}, nullptr, &responseTimes);
+    return responseTimes.percentile(0.95);
+}
+
+// 实时响应时间分位数
+LatencyPercentiles StatisticsManager::getLiveResponseTimePercentiles(const std::string& route) {
+    std::lock_guard<std::mutex> lock(liveLatencyMutex);
+    return liveLatency.snapshot(route, std::chrono::steady_clock::now());
 }
 
-// 获取响应时间分布
+// 历史响应时间分位数：分钟汇总仍在保留期内时用分钟粒度，否则用小时粒度
+LatencyPercentiles StatisticsManager::getResponseTimePercentiles(const std::chrono::time_point<std::chrono::system_clock>& periodStart,
+                                                                 const std::string& route) {
+    int64_t start = toEpochSeconds(periodStart);
+    int64_t minuteCutoff = toEpochSeconds(std::chrono::system_clock::now()) - static_cast<int64_t>(retention.minuteRollupDays) * 86400;
+    int granularity = start >= minuteCutoff ? 60 : 3600;
+
+    std::string query = "SELECT NULL, response_time_histogram FROM request_rollup_route WHERE granularity = ? AND bucket_start > ?";
+    std::vector<SQLParam> params = {granularity, start - granularity};
+    if (!route.empty()) {
+        query += " AND route = ?";
+        params.emplace_back(route);
+    }
+
+    LatencyHistogram responseTimes;
+    mergeSketches(query, params, nullptr, &responseTimes);
+    return responseTimes.percentiles();
+}
+
+// 获取响应时间分布（按小时，基于小时汇总表的保留期）
 std::vector<std::tuple<std::string, int>> StatisticsManager::getResponseTimeDistribution() {
-    return executeDistributionQuery("SELECT strftime('%H', request_time) AS hour, AVG(response_time) FROM request_statistics GROUP BY hour");
+    return executeDistributionQuery("SELECT strftime('%H', bucket_start, 'unixepoch') AS hour, SUM(sum_response_time) / SUM(total_requests) "
+                                    "FROM request_rollup_hour GROUP BY hour");
 }
 
 // 获取失败率
 float StatisticsManager::getFailureRate() {
-    std::string query = "SELECT (SELECT COUNT(*) FROM request_statistics WHERE status_code >= 400) * 1.0 / COUNT(*) FROM request_statistics";
+    std::string query = "SELECT SUM(failed_requests) * 1.0 / SUM(total_requests) FROM request_rollup_day";
     sqlite3* db = dbManager.getDbConnection();
     sqlite3_stmt* stmt;
     float failureRate = 0.0;
@@ -264,54 +808,61 @@ float StatisticsManager::getFailureRate() {
     return failureRate;
 }
 
-// 获取超时请求数
+// 获取超时请求数（按直方图桶估算）
 int StatisticsManager::getTimeoutRequestCount(int timeoutThreshold) {
-    std::string query = "SELECT COUNT(*) FROM request_statistics WHERE response_time > ?";
-    std::vector<SQLParam> params = { timeoutThreshold };
-    return executeCountQuery(query, params);
+    LatencyHistogram responseTimes;
+    mergeSketches("SELECT NULL, response_time_histogram FROM request_rollup_day", {}, nullptr, &responseTimes);
+    return static_cast<int>(responseTimes.countAbove(timeoutThreshold));
 }
 
-// 获取当前时间段统计
+// 获取当前时间段统计（最近一小时）
 std::tuple<int, int, int> StatisticsManager::getCurrentPeriodStatistics() {
-    std::string query = "SELECT COUNT(*), SUM(request_size + response_size), COUNT(DISTINCT client_ip) FROM request_statistics WHERE request_time >= datetime('now', '-1 hour')";
-    sqlite3* db = dbManager.getDbConnection();
-    sqlite3_stmt* stmt;
+    int64_t start = toEpochSeconds(std::chrono::system_clock::now()) - 3600;
+    std::string query = "SELECT COALESCE(SUM(total_requests), 0), COALESCE(SUM(total_request_size + total_response_size), 0) "
+                        "FROM request_rollup_minute WHERE bucket_start >= ?";
     std::tuple<int, int, int> result(0, 0, 0);
 
+    sqlite3* db = dbManager.getDbConnection();
+    sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, start);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             std::get<0>(result) = sqlite3_column_int(stmt, 0);  // 请求数
             std::get<1>(result) = sqlite3_column_int(stmt, 1);  // 流量
-            std::get<2>(result) = sqlite3_column_int(stmt, 2);  // IP 数量
         }
         sqlite3_finalize(stmt);
     }
     dbManager.releaseDbConnection(db);
+
+    HyperLogLog uniqueIps;
+    mergeSketches("SELECT unique_ips_sketch, NULL FROM request_rollup_minute WHERE bucket_start >= ?", {start}, &uniqueIps, nullptr);
+    std::get<2>(result) = static_cast<int>(uniqueIps.estimate());  // IP 数量
     return result;
 }
 
 // 获取历史统计
 std::tuple<int, int, int> StatisticsManager::getHistoricalStatistics() {
-    std::string query = "SELECT COUNT(*), SUM(request_size + response_size), COUNT(DISTINCT client_ip) FROM request_statistics";
-    sqlite3* db = dbManager.getDbConnection();
-    sqlite3_stmt* stmt;
+    std::string query = "SELECT COALESCE(SUM(total_requests), 0), COALESCE(SUM(total_request_size + total_response_size), 0) FROM request_rollup_day";
     std::tuple<int, int, int> result(0, 0, 0);
 
+    sqlite3* db = dbManager.getDbConnection();
+    sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             std::get<0>(result) = sqlite3_column_int(stmt, 0);  // 请求数
             std::get<1>(result) = sqlite3_column_int(stmt, 1);  // 流量
-            std::get<2>(result) = sqlite3_column_int(stmt, 2);  // IP 数量
         }
         sqlite3_finalize(stmt);
     }
     dbManager.releaseDbConnection(db);
+
+    std::get<2>(result) = getUniqueIpCount();  // IP 数量
     return result;
 }
 
 // 获取每日峰值
 std::tuple<int, int> StatisticsManager::getDailyPeak() {
-    std::string query = "SELECT MAX(total_requests), MAX(total_request_size + total_response_size) FROM service_usage WHERE period_start >= datetime('now', '-1 day')";
+    std::string query = "SELECT MAX(total_requests), MAX(total_request_size + total_response_size) FROM service_usage WHERE period_start >= CAST(strftime('%s', 'now', '-1 day') AS INTEGER)";
     sqlite3* db = dbManager.getDbConnection();
     sqlite3_stmt* stmt;
     std::tuple<int, int> result(0, 0);
@@ -329,7 +880,7 @@ std::tuple<int, int> StatisticsManager::getDailyPeak() {
 
 // 获取某时间段请求次数最多的 URL
 std::vector<std::tuple<std::string, int>> StatisticsManager::getTopUrlsByPeriod(const std::chrono::time_point<std::chrono::system_clock>& periodStart, int limit) {
-    std::string query = "SELECT url, request_count FROM top_urls_period WHERE period_start >= ? ORDER BY request_count DESC LIMIT ?";
+    std::string query = "SELECT url, SUM(request_count) AS total FROM top_urls_period WHERE period_start >= ? GROUP BY url ORDER BY total DESC LIMIT ?";
     sqlite3* db = dbManager.getDbConnection();
     sqlite3_stmt* stmt;
     std::vector<std::tuple<std::string, int>> result;
@@ -396,6 +947,8 @@ int StatisticsManager::executeCountQuery(const std::string& query, const std::ve
             const SQLParam& param = params[i];
             if (param.type == SQLParam::Type::Int) {
                 sqlite3_bind_int(stmt, index, param.intValue);
+            } else if (param.type == SQLParam::Type::Int64) {
+                sqlite3_bind_int64(stmt, index, param.int64Value);
             } else if (param.type == SQLParam::Type::Text) {
                 sqlite3_bind_text(stmt, index, std::move(param.textValue.c_str()), -1, SQLITE_TRANSIENT);
             }
@@ -415,6 +968,40 @@ int StatisticsManager::executeCountQuery(const std::string& query, const std::ve
     return count;
 }
 
+// 合并多行汇总数据中的 HyperLogLog 和响应时间直方图
+void StatisticsManager::mergeSketches(const std::string& query, const std::vector<SQLParam>& params, HyperLogLog* uniqueIps,
+                                      LatencyHistogram* responseTimes) {
+    sqlite3* db = dbManager.getDbConnection();
+    sqlite3_stmt* stmt;
+
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+        for (size_t i = 0; i < params.size(); ++i) {
+            int index = static_cast<int>(i + 1);
+            const SQLParam& param = params[i];
+            if (param.type == SQLParam::Type::Int) {
+                sqlite3_bind_int(stmt, index, param.intValue);
+            } else if (param.type == SQLParam::Type::Int64) {
+                sqlite3_bind_int64(stmt, index, param.int64Value);
+            } else if (param.type == SQLParam::Type::Text) {
+                sqlite3_bind_text(stmt, index, param.textValue.c_str(), -1, SQLITE_TRANSIENT);
+            }
+        }
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (uniqueIps != nullptr) {
+                uniqueIps->merge(HyperLogLog::deserialize(columnBlob(stmt, 0)));
+            }
+            if (responseTimes != nullptr) {
+                responseTimes->merge(LatencyHistogram::deserialize(columnBlob(stmt, 1)));
+            }
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        log(LogLevel::LOGERROR, "mergeSketches - Failed to prepare SQL statement: " + std::string(sqlite3_errmsg(db)));
+    }
+    dbManager.releaseDbConnection(db);
+}
+
 // 执行分布查询
 std::vector<std::tuple<std::string, int>> StatisticsManager::executeDistributionQuery(const std::string& query) {
     std::vector<std::tuple<std::string, int>> stats;
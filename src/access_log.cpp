@@ -0,0 +1,203 @@
+// access_log.cpp
+
+#include "access_log.h"
+#include "metrics.h"
+#include "utils.h"
+#include <cstring>
+#include <sys/stat.h>
+
+namespace {
+
+// 每个线程独立的 xorshift 随机数，用于采样
+double nextSample() {
+    thread_local uint64_t state = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) |
+                                  (reinterpret_cast<uintptr_t>(&state) << 1) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<double>(state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void appendJsonString(std::string& out, const std::string& value) {
+    out += '"';
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendField(std::string& out, const char* name, int64_t value) {
+    out += ",\"";
+    out += name;
+    out += "\":";
+    out += std::to_string(value);
+}
+
+Counter& droppedLines() {
+    static Counter& counter = MetricsRegistry::getInstance().counter("access_log_dropped_total", "Access log lines dropped because the buffer was full");
+    return counter;
+}
+
+}  // namespace
+
+AccessLog::AccessLog(const AccessLogOptions& options)
+    : options(options), stopWriter(false), file(nullptr), fileBytes(0) {
+    if (this->options.enabled) {
+        writerThread = std::thread(&AccessLog::writerLoop, this);
+    }
+}
+
+AccessLog::~AccessLog() {
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        stopWriter = true;
+    }
+    bufferCondition.notify_one();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+bool AccessLog::shouldRecord(int status, int64_t totalMicros) const {
+    if (!options.enabled) {
+        return false;
+    }
+    if (status >= 500 || totalMicros >= static_cast<int64_t>(options.slowRequestMs) * 1000) {
+        return true;
+    }
+    return options.sampleRate >= 1.0 || (options.sampleRate > 0.0 && nextSample() < options.sampleRate);
+}
+
+std::string AccessLog::formatRecord(const AccessLogRecord& record) {
+    std::string line;
+    line.reserve(256 + record.path.size());
+
+    int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count();
+    line += "{\"ts\":";
+    line += std::to_string(timeMs);
+    line += ",\"ip\":";
+    appendJsonString(line, record.clientIp);
+    line += ",\"method\":";
+    appendJsonString(line, record.method);
+    line += ",\"path\":";
+    appendJsonString(line, record.path);
+    appendField(line, "status", record.status);
+    appendField(line, "req_bytes", static_cast<int64_t>(record.requestBytes));
+    appendField(line, "resp_bytes", static_cast<int64_t>(record.responseBytes));
+    appendField(line, "total_us", record.totalMicros);
+    appendField(line, "queue_us", record.queueMicros);
+    appendField(line, "handler_us", record.handlerMicros);
+    appendField(line, "db_us", record.dbMicros);
+    appendField(line, "upstream_us", record.upstreamMicros);
+    appendField(line, "send_us", record.sendMicros);
+    line += ",\"cache\":\"";
+    line += record.cacheResult;
+    line += "\"}\n";
+    return line;
+}
+
+void AccessLog::record(const AccessLogRecord& record) {
+    std::string line = formatRecord(record);
+    bool shouldWake = false;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        if (pending.size() >= options.bufferCapacity) {
+            droppedLines().inc();
+            return;
+        }
+        pending.push_back(std::move(line));
+        shouldWake = pending.size() == 1;
+    }
+    if (shouldWake) {
+        bufferCondition.notify_one();
+    }
+}
+
+void AccessLog::writerLoop() {
+    std::vector<std::string> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(bufferMutex);
+            bufferCondition.wait(lock, [this]() { return stopWriter || !pending.empty(); });
+            if (pending.empty() && stopWriter) {
+                break;
+            }
+            batch.swap(pending);
+        }
+        writeLines(batch);
+        batch.clear();
+    }
+}
+
+void AccessLog::openFile() {
+    file = std::fopen(options.path.c_str(), "a");
+    if (file == nullptr) {
+        log(LogLevel::LOGERROR, "Unable to open access log: " + options.path);
+        return;
+    }
+    struct stat st;
+    fileBytes = (stat(options.path.c_str(), &st) == 0) ? static_cast<size_t>(st.st_size) : 0;
+}
+
+// access.log -> access.log.1 -> ... -> access.log.N，超出的历史文件被覆盖
+void AccessLog::rotate() {
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    for (int i = options.maxFiles - 1; i >= 1; --i) {
+        std::string from = options.path + "." + std::to_string(i);
+        std::string to = options.path + "." + std::to_string(i + 1);
+        std::rename(from.c_str(), to.c_str());
+    }
+    if (options.maxFiles > 0) {
+        std::rename(options.path.c_str(), (options.path + ".1").c_str());
+    } else {
+        std::remove(options.path.c_str());
+    }
+    fileBytes = 0;
+}
+
+void AccessLog::writeLines(const std::vector<std::string>& lines) {
+    if (file == nullptr) {
+        openFile();
+    }
+
+    std::string buffer;
+    for (const auto& line : lines) {
+        // 当前文件写不下时先写出已攒的部分，再轮转
+        if (fileBytes + buffer.size() + line.size() > options.maxFileBytes && fileBytes + buffer.size() > 0) {
+            if (file != nullptr) {
+                std::fwrite(buffer.data(), 1, buffer.size(), file);
+            }
+            buffer.clear();
+            rotate();
+            openFile();
+        }
+        buffer += line;
+    }
+
+    if (file == nullptr) {
+        return;
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), file);
+    std::fflush(file);
+    fileBytes += buffer.size();
+}
@@ -2,6 +2,7 @@
 #include "db_manager.h"
 #include "config.h"
 #include "http_client.h"
+#include "telegram_scheduler.h"
 #include "utils.h"
 #include <fstream>
 #include "db_manager.h"
@@ -246,7 +247,7 @@ void Bot::listUsersForBan(const std::string& chatId, int page, int pageSize, con
 // 发送带有键盘的消息
 void Bot::sendMessageWithKeyboard(const std::string& chatId, const std::string& message, const std::string& keyboard) {
     std::string sendMessageUrl = telegramApiUrl + "/bot" + apiToken + "/sendMessage?chat_id=" + chatId + "&text=" + buildTelegramUrl(message) + "&reply_markup=" + buildTelegramUrl(keyboard);
-    sendHttpRequest(sendMessageUrl);
+    sendReply(chatId, sendMessageUrl);
 }
 
 void Bot::processCallbackQuery(const nlohmann::json& callbackQuery) {
@@ -301,10 +302,10 @@ void Bot::processCallbackQuery(const nlohmann::json& callbackQuery) {
 // 在 processUpdate 中处理回调查询
 void Bot::processUpdate(const nlohmann::json& update) {
     try {
-        log(LogLevel::INFO, "Processing update: " + update.dump());
+        LOG(LogLevel::DEBUG, "Processing update: " + update.dump());
         if (update.contains("callback_query")) {
             const auto& callbackQuery = update["callback_query"];
-            log(LogLevel::INFO, "Processing callback query: " + callbackQuery.dump());
+            LOG(LogLevel::DEBUG, "Processing callback query: " + callbackQuery.dump());
             processCallbackQuery(callbackQuery);  // 处理回调
             return;
         }
@@ -395,24 +396,12 @@ void Bot::forwardMessageToChannel(const nlohmann::json& message) {
 
     std::string apiUrl = config.getTelegramApiUrl() + "/bot" + config.getApiToken() + "/forwardMessage";
 
-    httplib::Client cli(config.getTelegramApiUrl());
-    cli.set_read_timeout(60, 0);
-
-    auto res = cli.Post(("/bot" + config.getApiToken() + "/forwardMessage").c_str(),
-                        requestBody.dump(),
-                        "application/json");
-
-    if (res && res->status == 200) {
-        log(LogLevel::INFO, "Message forwarded to channel successfully.");
-    } else {
-        log(LogLevel::LOGERROR, "Failed to forward message to channel.");
-        if (res) {
-            log(LogLevel::LOGERROR, "Status code: " + std::to_string(res->status));
-            log(LogLevel::LOGERROR, "Response: " + res->body);
-        } else {
-            log(LogLevel::LOGERROR, "No response from Telegram API.");
-        }
-    }
+    UpstreamRequest request;
+    request.url = apiUrl;
+    request.body = requestBody.dump();
+    request.contentType = "application/json";
+    request.timeoutSeconds = 60;
+    TelegramScheduler::getInstance().send(channelId, std::move(request));
 }
 
 // collect命令：收集并保存文件
@@ -555,15 +544,22 @@ bool Bot::isOwner(const std::string& userId) {
 void Bot::sendMessage(const std::string& chatId, const std::string& message) {
     std::string sendMessageUrl = telegramApiUrl + "/bot" + apiToken + "/sendMessage?chat_id=" + chatId +"&parse_mode=MarkdownV2&text=" + buildTelegramUrl(escapeTelegramUrl(message));
     // std::cout << "Request URL: " << sendMessageUrl << std::endl;
-    sendHttpRequest(sendMessageUrl);
+    sendReply(chatId, sendMessageUrl);
 }
 
 void Bot::handleWebhook(const nlohmann::json& webhookRequest) {
-    log(LogLevel::INFO, "Received Webhook: " + webhookRequest.dump());
+    LOG(LogLevel::DEBUG, "Received Webhook: " + webhookRequest.dump());
     processUpdate(webhookRequest);
 }
 
 void Bot::editMessageWithKeyboard(const std::string& chatId, const std::string& messageId, const std::string& message, const std::string& keyboard) {
     std::string editMessageUrl = telegramApiUrl + "/bot" + apiToken + "/editMessageText?chat_id=" + chatId + "&message_id=" + messageId + "&text=" + buildTelegramUrl(message) + "&reply_markup=" + buildTelegramUrl(keyboard);
-    sendHttpRequest(editMessageUrl);
+    // 快速连续点击翻页按钮时，同一条消息只发送最后一次编辑
+    sendReply(chatId, editMessageUrl, chatId + ":" + messageId);
+}
+
+void Bot::sendReply(const std::string& chatId, const std::string& url, const std::string& coalesceKey) {
+    UpstreamRequest request;
+    request.url = url;
+    TelegramScheduler::getInstance().send(chatId, std::move(request), coalesceKey);
 }
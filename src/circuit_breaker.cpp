@@ -0,0 +1,78 @@
+#include "circuit_breaker.h"
+#include "utils.h"
+#include <algorithm>
+
+CircuitBreaker::CircuitBreaker(const CircuitBreakerOptions& options)
+    : options(options), state(State::Closed), consecutiveFailures(0), probeInFlight(false) {}
+
+void CircuitBreaker::configure(const CircuitBreakerOptions& newOptions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    options = newOptions;
+    options.failureThreshold = std::max(options.failureThreshold, 1);
+    options.openSeconds = std::max(options.openSeconds, 1);
+}
+
+bool CircuitBreaker::allowRequest() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (state == State::Closed) {
+        return true;
+    }
+
+    auto now = Clock::now();
+    auto openDuration = std::chrono::seconds(options.openSeconds);
+    if (state == State::Open) {
+        if (now - openedAt < openDuration) {
+            return false;
+        }
+        state = State::HalfOpen;
+        log(LogLevel::INFO, "Circuit breaker half-open, sending a probe request");
+    }
+    // 半开时只放行一个探测请求；探测请求迟迟没有结果（例如调用方没有记录）时，再放行一个
+    if (probeInFlight && now - probeStartedAt < openDuration) {
+        return false;
+    }
+    probeInFlight = true;
+    probeStartedAt = now;
+    return true;
+}
+
+void CircuitBreaker::recordSuccess() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (state != State::Closed) {
+        log(LogLevel::INFO, "Circuit breaker closed, upstream recovered");
+    }
+    state = State::Closed;
+    consecutiveFailures = 0;
+    probeInFlight = false;
+}
+
+void CircuitBreaker::recordFailure() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (state == State::HalfOpen) {
+        state = State::Open;
+        openedAt = Clock::now();
+        probeInFlight = false;
+        log(LogLevel::WARNING, "Circuit breaker probe failed, staying open for " + std::to_string(options.openSeconds) + " seconds");
+        return;
+    }
+    if (state == State::Closed && ++consecutiveFailures >= options.failureThreshold) {
+        state = State::Open;
+        openedAt = Clock::now();
+        log(LogLevel::LOGERROR, "Circuit breaker opened after " + std::to_string(consecutiveFailures) +
+                                    " consecutive upstream failures, failing fast for " + std::to_string(options.openSeconds) + " seconds");
+    }
+}
+
+CircuitBreaker::State CircuitBreaker::getState() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state;
+}
+
+int CircuitBreaker::getRetryAfterSeconds() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (state == State::Closed) {
+        return 0;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::seconds>(openedAt + std::chrono::seconds(options.openSeconds) - Clock::now());
+    return std::max(static_cast<int>(remaining.count()), 1);
+}
@@ -0,0 +1,178 @@
+#include "compression.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+#ifdef BROTLI_SUPPORT
+#include <brotli/encode.h>
+#endif
+#ifdef ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+namespace {
+
+// 压缩结果会缓存，每个对象只压缩一次，因此选择接近最高的压缩级别；
+// 不用 Brotli 11 / Zstd 19 以上，它们对 1 MB 的文本需要数百毫秒，首个请求的延迟过高
+#ifdef BROTLI_SUPPORT
+const int kBrotliQuality = 9;
+#endif
+#ifdef ZSTD_SUPPORT
+const int kZstdLevel = 15;
+#endif
+
+std::string trim(const std::string& value) {
+    size_t start = value.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(start, end - start + 1);
+}
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+    return value;
+}
+
+#ifdef BROTLI_SUPPORT
+std::string brotliCompress(const std::string& data) {
+    std::string output(BrotliEncoderMaxCompressedSize(data.size()), '\0');
+    size_t outputSize = output.size();
+    if (output.empty() ||
+        !BrotliEncoderCompress(kBrotliQuality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, data.size(),
+                               reinterpret_cast<const uint8_t*>(data.data()), &outputSize,
+                               reinterpret_cast<uint8_t*>(&output[0]))) {
+        throw std::runtime_error("BrotliEncoderCompress failed while compressing.");
+    }
+    output.resize(outputSize);
+    return output;
+}
+#endif
+
+#ifdef ZSTD_SUPPORT
+std::string zstdCompress(const std::string& data) {
+    std::string output(ZSTD_compressBound(data.size()), '\0');
+    size_t outputSize = ZSTD_compress(&output[0], output.size(), data.data(), data.size(), kZstdLevel);
+    if (ZSTD_isError(outputSize)) {
+        throw std::runtime_error(std::string("ZSTD_compress failed while compressing: ") + ZSTD_getErrorName(outputSize));
+    }
+    output.resize(outputSize);
+    return output;
+}
+#endif
+
+}  // namespace
+
+const char* contentEncodingName(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return "gzip";
+        case ContentEncoding::Brotli: return "br";
+        case ContentEncoding::Zstd: return "zstd";
+        default: return "";
+    }
+}
+
+const char* contentEncodingSuffix(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip: return ".gz";
+        case ContentEncoding::Brotli: return ".br";
+        case ContentEncoding::Zstd: return ".zst";
+        default: return "";
+    }
+}
+
+ContentEncoding negotiateContentEncoding(const std::string& acceptEncoding) {
+    // 按优先顺序排列的已支持编码
+    std::vector<ContentEncoding> supported;
+#ifdef BROTLI_SUPPORT
+    supported.push_back(ContentEncoding::Brotli);
+#endif
+#ifdef ZSTD_SUPPORT
+    supported.push_back(ContentEncoding::Zstd);
+#endif
+    supported.push_back(ContentEncoding::Gzip);
+
+    // 未出现的编码取 * 的 q 值，没有 * 时为 0（不接受）
+    std::vector<double> quality(supported.size(), -1.0);
+    double wildcard = 0.0;
+    size_t start = 0;
+    while (start <= acceptEncoding.size()) {
+        size_t end = acceptEncoding.find(',', start);
+        if (end == std::string::npos) {
+            end = acceptEncoding.size();
+        }
+        std::string item = acceptEncoding.substr(start, end - start);
+        start = end + 1;
+
+        double q = 1.0;
+        size_t semicolon = item.find(';');
+        if (semicolon != std::string::npos) {
+            std::string parameter = toLower(trim(item.substr(semicolon + 1)));
+            if (parameter.compare(0, 2, "q=") == 0) {
+                q = std::atof(parameter.c_str() + 2);
+            }
+            item = item.substr(0, semicolon);
+        }
+        std::string name = toLower(trim(item));
+        if (name == "x-gzip") {
+            name = "gzip";
+        }
+        if (name == "*") {
+            wildcard = q;
+            continue;
+        }
+        for (size_t i = 0; i < supported.size(); ++i) {
+            if (name == contentEncodingName(supported[i])) {
+                quality[i] = q;
+            }
+        }
+    }
+
+    ContentEncoding best = ContentEncoding::Identity;
+    double bestQuality = 0.0;
+    for (size_t i = 0; i < supported.size(); ++i) {
+        double q = quality[i] < 0 ? wildcard : quality[i];
+        if (q > bestQuality) {
+            best = supported[i];
+            bestQuality = q;
+        }
+    }
+    return best;
+}
+
+bool isCompressibleMimeType(const std::string& mimeType, const std::vector<std::string>& compressibleTypes) {
+    std::string type = toLower(trim(mimeType.substr(0, mimeType.find(';'))));
+    if (type.empty()) {
+        return false;
+    }
+    for (const std::string& compressible : compressibleTypes) {
+        std::string pattern = toLower(compressible);
+        bool prefix = !pattern.empty() && pattern.back() == '/';
+        if (prefix ? type.compare(0, pattern.size(), pattern) == 0 : type == pattern) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string compressContent(const std::string& data, ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip:
+            return gzipCompress(data);
+#ifdef BROTLI_SUPPORT
+        case ContentEncoding::Brotli:
+            return brotliCompress(data);
+#endif
+#ifdef ZSTD_SUPPORT
+        case ContentEncoding::Zstd:
+            return zstdCompress(data);
+#endif
+        case ContentEncoding::Identity:
+            return data;
+        default:
+            throw std::runtime_error(std::string("Unsupported content encoding: ") + contentEncodingName(encoding));
+    }
+}
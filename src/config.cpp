@@ -159,3 +159,266 @@ std::string Config::getTelegramChannelId() const {
     }
     return configData["channel_id"].get<std::string>();
 }
+
+int Config::getStatisticsBufferCapacity() const {
+    return getOptional<int>("statistics", "buffer_capacity", 8192);
+}
+
+int Config::getStatisticsFlushIntervalMs() const {
+    return getOptional<int>("statistics", "flush_interval_ms", 1000);
+}
+
+int Config::getStatisticsFlushBatchSize() const {
+    return getOptional<int>("statistics", "flush_batch_size", 512);
+}
+
+int Config::getStatisticsBucketSeconds() const {
+    return getOptional<int>("statistics", "bucket_seconds", 60);
+}
+
+int Config::getStatisticsRawRetentionDays() const {
+    return getOptional<int>("statistics", "raw_retention_days", 7);
+}
+
+int Config::getStatisticsMinuteRollupRetentionDays() const {
+    return getOptional<int>("statistics", "minute_rollup_retention_days", 2);
+}
+
+int Config::getStatisticsHourRollupRetentionDays() const {
+    return getOptional<int>("statistics", "hour_rollup_retention_days", 90);
+}
+
+int Config::getStatisticsRetentionBatchSize() const {
+    return getOptional<int>("statistics", "retention_batch_size", 1000);
+}
+
+bool Config::getMetricsEnabled() const {
+    return getOptional<bool>("metrics", "enabled", true);
+}
+
+std::string Config::getLogLevel() const {
+    return getOptional<std::string>("logging", "level", "info");
+}
+
+std::string Config::getLogFile() const {
+    return getOptional<std::string>("logging", "file", "bot.log");
+}
+
+bool Config::getLogToConsole() const {
+    return getOptional<bool>("logging", "console", true);
+}
+
+bool Config::getAccessLogEnabled() const {
+    return getOptional<bool>("access_log", "enabled", false);
+}
+
+std::string Config::getAccessLogPath() const {
+    return getOptional<std::string>("access_log", "path", "access.log");
+}
+
+double Config::getAccessLogSampleRate() const {
+    return getOptional<double>("access_log", "sample_rate", 1.0);
+}
+
+int Config::getAccessLogSlowRequestMs() const {
+    return getOptional<int>("access_log", "slow_request_ms", 1000);
+}
+
+int Config::getAccessLogMaxSizeMB() const {
+    return getOptional<int>("access_log", "max_size_mb", 64);
+}
+
+int Config::getAccessLogMaxFiles() const {
+    return getOptional<int>("access_log", "max_files", 5);
+}
+
+bool Config::getChromeTraceEnabled() const {
+    return getOptional<bool>("tracing", "chrome_trace", false);
+}
+
+std::string Config::getChromeTracePath() const {
+    return getOptional<std::string>("tracing", "chrome_trace_path", "trace.json");
+}
+
+int Config::getChromeTraceMaxEvents() const {
+    return getOptional<int>("tracing", "max_events", 100000);
+}
+
+int Config::getServerListeners() const {
+    return getOptional<int>("server", "listeners", 1);
+}
+
+int Config::getServerWorkerThreads() const {
+    return getOptional<int>("server", "worker_threads", 0);
+}
+
+int Config::getServerMaxQueuedConnections() const {
+    return getOptional<int>("server", "max_queued_connections", 0);
+}
+
+int Config::getServerListenBacklog() const {
+    return getOptional<int>("server", "listen_backlog", 128);
+}
+
+int Config::getServerKeepAliveMaxCount() const {
+    return getOptional<int>("server", "keep_alive_max_count", 100);
+}
+
+int Config::getServerKeepAliveTimeoutSeconds() const {
+    return getOptional<int>("server", "keep_alive_timeout_seconds", 5);
+}
+
+int Config::getServerReadTimeoutSeconds() const {
+    return getOptional<int>("server", "read_timeout_seconds", 5);
+}
+
+int Config::getServerWriteTimeoutSeconds() const {
+    return getOptional<int>("server", "write_timeout_seconds", 5);
+}
+
+int Config::getThreadPoolMinThreads() const {
+    return getOptional<int>("thread_pool", "min_threads", 2);
+}
+
+int Config::getThreadPoolMaxThreads() const {
+    return getOptional<int>("thread_pool", "max_threads", 8);
+}
+
+int Config::getThreadPoolIdleTimeoutMs() const {
+    return getOptional<int>("thread_pool", "idle_timeout_ms", 30000);
+}
+
+int Config::getThreadPoolQueueCapacity(const std::string& lane) const {
+    return getOptional<int>("thread_pool", lane + "_queue_capacity", lane == "high" ? 1024 : 4096);
+}
+
+std::string Config::getThreadPoolOverflowPolicy(const std::string& lane) const {
+    return getOptional<std::string>("thread_pool", lane + "_overflow_policy", lane == "low" ? "drop_oldest" : "block");
+}
+
+int Config::getHttpClientMaxIdleHandles() const {
+    return getOptional<int>("http_client", "max_idle_handles", 16);
+}
+
+bool Config::getHttpClientHttp2() const {
+    return getOptional<bool>("http_client", "http2", true);
+}
+
+int Config::getHttpClientConnectTimeoutSeconds() const {
+    return getOptional<int>("http_client", "connect_timeout_seconds", 10);
+}
+
+int Config::getHttpClientMaxHostConnections() const {
+    return getOptional<int>("http_client", "max_host_connections", 32);
+}
+
+bool Config::getEventServerEnabled() const {
+    return getOptional<bool>("event_server", "enabled", false);
+}
+
+std::string Config::getEventServerHostname() const {
+    return getOptional<std::string>("event_server", "hostname", getHostname());
+}
+
+int Config::getEventServerPort() const {
+    return getOptional<int>("event_server", "port", 8081);
+}
+
+int Config::getEventServerThreads() const {
+    return getOptional<int>("event_server", "threads", 2);
+}
+
+int Config::getEventServerMinWorkerThreads() const {
+    return getOptional<int>("event_server", "min_worker_threads", 2);
+}
+
+int Config::getEventServerMaxWorkerThreads() const {
+    return getOptional<int>("event_server", "max_worker_threads", 8);
+}
+
+int Config::getEventServerMaxConnections() const {
+    return getOptional<int>("event_server", "max_connections", 20000);
+}
+
+int Config::getEventServerIdleTimeoutSeconds() const {
+    return getOptional<int>("event_server", "idle_timeout_seconds", 60);
+}
+
+int Config::getEventServerListenBacklog() const {
+    return getOptional<int>("event_server", "listen_backlog", 1024);
+}
+
+int Config::getCacheStaleGraceSeconds() const {
+    return getOptional<int>("cache", "stale_grace_seconds", 86400);
+}
+
+int Config::getCircuitBreakerFailureThreshold() const {
+    return getOptional<int>("circuit_breaker", "failure_threshold", 5);
+}
+
+int Config::getCircuitBreakerOpenSeconds() const {
+    return getOptional<int>("circuit_breaker", "open_seconds", 30);
+}
+
+int Config::getTelegramOutboundGlobalPerSecond() const {
+    return getOptional<int>("telegram_outbound", "global_per_second", 30);
+}
+
+int Config::getTelegramOutboundPrivateChatIntervalMs() const {
+    return getOptional<int>("telegram_outbound", "private_chat_interval_ms", 1000);
+}
+
+int Config::getTelegramOutboundGroupPerMinute() const {
+    return getOptional<int>("telegram_outbound", "group_per_minute", 20);
+}
+
+int Config::getTelegramOutboundMaxRetries() const {
+    return getOptional<int>("telegram_outbound", "max_retries", 5);
+}
+
+int Config::getTelegramOutboundBaseBackoffMs() const {
+    return getOptional<int>("telegram_outbound", "base_backoff_ms", 500);
+}
+
+int Config::getTelegramOutboundMaxBackoffMs() const {
+    return getOptional<int>("telegram_outbound", "max_backoff_ms", 30000);
+}
+
+int Config::getTelegramOutboundMaxQueuedPerChat() const {
+    return getOptional<int>("telegram_outbound", "max_queued_per_chat", 100);
+}
+
+int Config::getUploadMaxBatchFiles() const {
+    return getOptional<int>("upload", "max_batch_files", 50);
+}
+
+int Config::getUploadMaxParallelUploads() const {
+    return getOptional<int>("upload", "max_parallel_uploads", 4);
+}
+
+int Config::getUploadMaxFileSizeMb() const {
+    return getOptional<int>("upload", "max_file_size_mb", 50);
+}
+
+// 为空时使用系统临时目录
+std::string Config::getUploadSpoolDir() const {
+    return getOptional<std::string>("upload", "spool_dir", "");
+}
+
+bool Config::getCompressionEnabled() const {
+    return getOptional<bool>("compression", "enabled", true);
+}
+
+// 图片、视频等已压缩格式再做 gzip 几乎没有收益，只白白消耗 CPU
+std::vector<std::string> Config::getCompressionTypes() const {
+    return getOptional<std::vector<std::string>>("compression", "types",
+        {"text/", "application/json", "application/javascript", "application/xml", "image/svg+xml"});
+}
+
+int Config::getCompressionMinSizeBytes() const {
+    return getOptional<int>("compression", "min_size_bytes", 256);
+}
+
+int Config::getCompressionMaxSizeBytes() const {
+    return getOptional<int>("compression", "max_size_bytes", 1048576);
+}
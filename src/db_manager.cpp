@@ -1,5 +1,7 @@
 #include "db_manager.h"
 #include "utils.h"
+#include "metrics.h"
+#include "request_context.h"
 #include <iostream>
 #include <mutex>
 #include <thread>
@@ -39,7 +41,114 @@ void DBManager::stopPoolThread() {
     stopThread.store(true);  // 将 stopThread 置为 true
 }
 
+namespace {
+
+// 从连接池获取连接的等待时间（含加锁与等待空闲连接）
+void recordPoolWait(const std::chrono::steady_clock::time_point& startTime) {
+    static Histogram& waitTime = MetricsRegistry::getInstance().histogram(
+        "db_pool_wait_seconds", "Time spent waiting for a SQLite connection from the pool", {},
+        {0.00001, 0.0001, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0});
+    waitTime.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+}
+
+// 插入一条文件记录，file_id 已存在时更新；由调用方管理事务
+bool upsertFile(sqlite3* db, const FileRecord& file) {
+    // 首先检查 file_id 是否已经存在
+    std::string checkFileSQL = "SELECT COUNT(*) FROM files WHERE file_id = ?";
+    sqlite3_stmt* checkStmt;
+    int rc = sqlite3_prepare_v2(db, checkFileSQL.c_str(), -1, &checkStmt, nullptr);
+    if (rc != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "addFile - Failed to prepare SELECT statement addFile (File Check): " + std::string(sqlite3_errmsg(db)));
+        return false;
+    }
+
+    // 绑定 file_id 参数
+    sqlite3_bind_text(checkStmt, 1, file.fileId.c_str(), -1, SQLITE_STATIC);
+    rc = sqlite3_step(checkStmt);
+
+    if (rc != SQLITE_ROW) {
+        log(LogLevel::LOGERROR, "Failed to step SELECT statement: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_finalize(checkStmt);
+        return false;
+    }
+
+    int fileExists = sqlite3_column_int(checkStmt, 0); // 如果大于0，表示文件已存在
+    sqlite3_finalize(checkStmt);
+
+    if (fileExists > 0) {
+        // 如果文件已存在，执行更新操作
+        std::string updateFileSQL = R"(
+            UPDATE files SET 
+                file_link = ?,
+                file_name = ?,
+                short_id = ?,
+                short_link = ?,
+                extension = ?,
+                content_hash = COALESCE(NULLIF(?, ''), content_hash)
+            WHERE file_id = ?
+        )";
+        sqlite3_stmt* updateStmt;
+        rc = sqlite3_prepare_v2(db, updateFileSQL.c_str(), -1, &updateStmt, nullptr);
+        if (rc != SQLITE_OK) {
+            log(LogLevel::LOGERROR, "Failed to prepare UPDATE statement (File): " + std::string(sqlite3_errmsg(db)));
+            return false;
+        }
+
+        // 绑定更新语句的参数
+        sqlite3_bind_text(updateStmt, 1, file.fileLink.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(updateStmt, 2, file.fileName.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(updateStmt, 3, file.shortId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(updateStmt, 4, file.shortLink.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(updateStmt, 5, file.extension.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(updateStmt, 6, file.contentHash.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(updateStmt, 7, file.fileId.c_str(), -1, SQLITE_STATIC);
+
+        rc = sqlite3_step(updateStmt);
+        sqlite3_finalize(updateStmt);
+
+        if (rc != SQLITE_DONE) {
+            log(LogLevel::LOGERROR, "Failed to update file record: " + std::string(sqlite3_errmsg(db)));
+            return false;
+        }
+    } else {
+        // 如果文件不存在，执行插入操作
+        std::string insertFileSQL = R"(
+            INSERT INTO files (user_id, file_id, file_link, file_name, short_id, short_link, extension, content_hash)
+            VALUES ((SELECT id FROM users WHERE telegram_id = ?), ?, ?, ?, ?, ?, ?, NULLIF(?, ''))
+        )";
+        sqlite3_stmt* insertStmt;
+        rc = sqlite3_prepare_v2(db, insertFileSQL.c_str(), -1, &insertStmt, nullptr);
+        if (rc != SQLITE_OK) {
+            log(LogLevel::LOGERROR, "Failed to prepare INSERT statement (File): " + std::string(sqlite3_errmsg(db)));
+            return false;
+        }
+
+        // 绑定插入语句的参数
+        sqlite3_bind_text(insertStmt, 1, file.userId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 2, file.fileId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 3, file.fileLink.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 4, file.fileName.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 5, file.shortId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 6, file.shortLink.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 7, file.extension.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(insertStmt, 8, file.contentHash.c_str(), -1, SQLITE_STATIC);
+
+        rc = sqlite3_step(insertStmt);
+        sqlite3_finalize(insertStmt);
+
+        if (rc != SQLITE_DONE) {
+            log(LogLevel::LOGERROR, "Failed to insert file record: " + std::string(sqlite3_errmsg(db)));
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
 sqlite3* DBManager::getDbConnection() {
+    auto startTime = std::chrono::steady_clock::now();
+    markDbAcquireStart();
     std::unique_lock<std::mutex> lock(poolMutex);  // 确保线程安全
 
     // 如果有可用的连接，直接返回
@@ -47,6 +156,7 @@ sqlite3* DBManager::getDbConnection() {
         sqlite3* db = connectionPool.front();
         connectionPool.pop();
         connectionIdleTime.erase(db);  // 移除空闲时间记录
+        recordPoolWait(startTime);
         return db;
     }
 
@@ -55,9 +165,13 @@ sqlite3* DBManager::getDbConnection() {
         sqlite3* db = nullptr;
         if (sqlite3_open_v2(dbFile.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
             log(LogLevel::LOGERROR, "Can't open database: " + std::string(sqlite3_errmsg(db)));
+            markDbReleased();
             return nullptr;  // 确保在失败时返回 nullptr
         } else {
+            // 与统计写入等其他连接并发时，等待锁释放而不是立即返回 SQLITE_BUSY
+            sqlite3_busy_timeout(db, 5000);
             ++currentConnectionCount;  // 增加连接计数
+            recordPoolWait(startTime);
             return db;  // 动态创建新连接并返回
         }
     }
@@ -69,14 +183,17 @@ sqlite3* DBManager::getDbConnection() {
     if (!connectionPool.empty()) {
         sqlite3* db = connectionPool.front();
         connectionPool.pop();
+        recordPoolWait(startTime);
         return db;
     }
 
+    markDbReleased();
     return nullptr;
 }
 
 // 释放连接：将连接归还池中
 void DBManager::releaseDbConnection(sqlite3* db) {
+    markDbReleased();
     std::unique_lock<std::mutex> lock(poolMutex);
     connectionPool.push(db);
     connectionIdleTime[db] = std::chrono::steady_clock::now();  // 记录空闲时间
@@ -241,6 +358,70 @@ bool DBManager::createTables() {
         return false;
     }
     log(LogLevel::INFO, "Service usage table created or exists already.");
+
+    // 创建按分钟/小时/天聚合的请求统计汇总表
+    const std::vector<std::string> rollupTables = {"request_rollup_minute", "request_rollup_hour", "request_rollup_day"};
+    for (const auto& table : rollupTables) {
+        log(LogLevel::INFO, "Creating or updating " + table + " table...");
+        std::string rollupTableSQL = "CREATE TABLE IF NOT EXISTS " + table + " ("
+                                     "bucket_start INTEGER PRIMARY KEY, "
+                                     "total_requests INTEGER NOT NULL, "
+                                     "successful_requests INTEGER NOT NULL, "
+                                     "failed_requests INTEGER NOT NULL, "
+                                     "total_request_size INTEGER NOT NULL, "
+                                     "total_response_size INTEGER NOT NULL, "
+                                     "max_request_size INTEGER NOT NULL, "
+                                     "max_response_size INTEGER NOT NULL, "
+                                     "sum_response_time INTEGER NOT NULL, "
+                                     "max_response_time INTEGER NOT NULL, "
+                                     "unique_ips INTEGER NOT NULL, "
+                                     "unique_ips_sketch BLOB, "
+                                     "response_time_histogram BLOB);";
+        rc = sqlite3_exec(db, rollupTableSQL.c_str(), 0, 0, &errMsg);
+        if (rc != SQLITE_OK) {
+            log(LogLevel::LOGERROR, "SQL error (" + table + " Table): " + std::string(errMsg));
+            sqlite3_free(errMsg);
+            releaseDbConnection(db);
+            return false;
+        }
+        log(LogLevel::INFO, table + " table created or exists already.");
+    }
+
+    // 创建按天、按维度（请求方法、状态码、文件类型、IP）聚合的汇总表
+    log(LogLevel::INFO, "Creating or updating request_rollup_dimension table...");
+    const char* rollupDimensionTableSQL = "CREATE TABLE IF NOT EXISTS request_rollup_dimension ("
+                                          "bucket_start INTEGER NOT NULL, "
+                                          "dimension TEXT NOT NULL, "
+                                          "value TEXT NOT NULL, "
+                                          "request_count INTEGER NOT NULL, "
+                                          "traffic INTEGER NOT NULL, "
+                                          "PRIMARY KEY (bucket_start, dimension, value));";
+    rc = sqlite3_exec(db, rollupDimensionTableSQL, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "SQL error (Rollup Dimension Table): " + std::string(errMsg));
+        sqlite3_free(errMsg);
+        releaseDbConnection(db);
+        return false;
+    }
+    log(LogLevel::INFO, "Request rollup dimension table created or exists already.");
+
+    // 创建按路由聚合的响应时间汇总表（分钟/小时粒度，保存可合并的延迟直方图）
+    log(LogLevel::INFO, "Creating or updating request_rollup_route table...");
+    const char* rollupRouteTableSQL = "CREATE TABLE IF NOT EXISTS request_rollup_route ("
+                                      "granularity INTEGER NOT NULL, "
+                                      "bucket_start INTEGER NOT NULL, "
+                                      "route TEXT NOT NULL, "
+                                      "request_count INTEGER NOT NULL, "
+                                      "response_time_histogram BLOB, "
+                                      "PRIMARY KEY (granularity, bucket_start, route));";
+    rc = sqlite3_exec(db, rollupRouteTableSQL, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "SQL error (Rollup Route Table): " + std::string(errMsg));
+        sqlite3_free(errMsg);
+        releaseDbConnection(db);
+        return false;
+    }
+    log(LogLevel::INFO, "Request rollup route table created or exists already.");
     // 创建用户表，如果不存在则创建
     log(LogLevel::INFO, "Creating or updating users table...");
     const char* userTableSQL = "CREATE TABLE IF NOT EXISTS users ("
@@ -318,10 +499,12 @@ bool DBManager::createTables() {
     addColumnIfNotExists("files", "is_valid", "BOOLEAN DEFAULT 1");
     addColumnIfNotExists("files", "created_at", "TEXT DEFAULT (datetime('now'))");
     addColumnIfNotExists("files", "updated_at", "TEXT DEFAULT (datetime('now'))");
+    addColumnIfNotExists("files", "content_hash", "TEXT");
 
-    // 为 short_id 和 file_id 创建索引
+    // 为 short_id、file_id 和 content_hash 创建索引
     const char* fileIndexSQL = "CREATE INDEX IF NOT EXISTS idx_files_short_id ON files(short_id);"
-                               "CREATE INDEX IF NOT EXISTS idx_files_file_id ON files(file_id);";
+                               "CREATE INDEX IF NOT EXISTS idx_files_file_id ON files(file_id);"
+                               "CREATE INDEX IF NOT EXISTS idx_files_content_hash ON files(content_hash);";
     rc = sqlite3_exec(db, fileIndexSQL, 0, 0, &errMsg);
     if (rc != SQLITE_OK) {
         log(LogLevel::LOGERROR, "SQL error (File Table Index): " + std::string(errMsg));
@@ -464,109 +647,37 @@ bool DBManager::addUserIfNotExists(const std::string& telegramId, const std::str
 }
 
 bool DBManager::addFile(const std::string& userId, const std::string& fileId, const std::string& fileLink, const std::string& fileName, const std::string& shortId, const std::string& shortLink, const std::string& extension) {
-    sqlite3* db = getDbConnection();
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    return addFiles({FileRecord{userId, fileId, fileLink, fileName, shortId, shortLink, extension}});
+}
 
-    // 首先检查 file_id 是否已经存在
-    std::string checkFileSQL = "SELECT COUNT(*) FROM files WHERE file_id = ?";
-    sqlite3_stmt* checkStmt;
-    int rc = sqlite3_prepare_v2(db, checkFileSQL.c_str(), -1, &checkStmt, nullptr);
-    if (rc != SQLITE_OK) {
-        log(LogLevel::LOGERROR, "addFile - Failed to prepare SELECT statement addFile (File Check): " + std::string(sqlite3_errmsg(db)));
-        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-        releaseDbConnection(db);
-        return false;
+bool DBManager::addFiles(const std::vector<FileRecord>& files) {
+    if (files.empty()) {
+        return true;
     }
 
-    // 绑定 file_id 参数
-    sqlite3_bind_text(checkStmt, 1, std::move(fileId.c_str()), -1, SQLITE_STATIC);
-    rc = sqlite3_step(checkStmt);
-    
-    if (rc != SQLITE_ROW) {
-        log(LogLevel::LOGERROR, "Failed to step SELECT statement: " + std::string(sqlite3_errmsg(db)));
-        sqlite3_finalize(checkStmt);
-        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    sqlite3* db = getDbConnection();
+    if (sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "addFiles - Failed to begin transaction: " + std::string(sqlite3_errmsg(db)));
         releaseDbConnection(db);
         return false;
     }
 
-    int fileExists = sqlite3_column_int(checkStmt, 0); // 如果大于0，表示文件已存在
-    sqlite3_finalize(checkStmt);
-
-    if (fileExists > 0) {
-        // 如果文件已存在，执行更新操作
-        std::string updateFileSQL = R"(
-            UPDATE files SET 
-                file_link = ?,
-                file_name = ?,
-                short_id = ?,
-                short_link = ?,
-                extension = ?
-            WHERE file_id = ?
-        )";
-        sqlite3_stmt* updateStmt;
-        rc = sqlite3_prepare_v2(db, updateFileSQL.c_str(), -1, &updateStmt, nullptr);
-        if (rc != SQLITE_OK) {
-            log(LogLevel::LOGERROR, "Failed to prepare UPDATE statement (File): " + std::string(sqlite3_errmsg(db)));
-            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-            releaseDbConnection(db);
-            return false;
-        }
-
-        // 绑定更新语句的参数
-        sqlite3_bind_text(updateStmt, 1, std::move(fileLink.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(updateStmt, 2, std::move(fileName.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(updateStmt, 3, std::move(shortId.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(updateStmt, 4, std::move(shortLink.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(updateStmt, 5, std::move(extension.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(updateStmt, 6, std::move(fileId.c_str()), -1, SQLITE_STATIC);
-
-        rc = sqlite3_step(updateStmt);
-        sqlite3_finalize(updateStmt);
-
-        if (rc != SQLITE_DONE) {
-            log(LogLevel::LOGERROR, "Failed to update file record: " + std::string(sqlite3_errmsg(db)));
-            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-            releaseDbConnection(db);
-            return false;
-        }
-    } else {
-        // 如果文件不存在，执行插入操作
-        std::string insertFileSQL = R"(
-            INSERT INTO files (user_id, file_id, file_link, file_name, short_id, short_link, extension)
-            VALUES ((SELECT id FROM users WHERE telegram_id = ?), ?, ?, ?, ?, ?, ?)
-        )";
-        sqlite3_stmt* insertStmt;
-        rc = sqlite3_prepare_v2(db, insertFileSQL.c_str(), -1, &insertStmt, nullptr);
-        if (rc != SQLITE_OK) {
-            log(LogLevel::LOGERROR, "Failed to prepare INSERT statement (File): " + std::string(sqlite3_errmsg(db)));
-            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-            releaseDbConnection(db);
-            return false;
-        }
-
-        // 绑定插入语句的参数
-        sqlite3_bind_text(insertStmt, 1, std::move(userId.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(insertStmt, 2, std::move(fileId.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(insertStmt, 3, std::move(fileLink.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(insertStmt, 4, std::move(fileName.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(insertStmt, 5, std::move(shortId.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(insertStmt, 6, std::move(shortLink.c_str()), -1, SQLITE_STATIC);
-        sqlite3_bind_text(insertStmt, 7, std::move(extension.c_str()), -1, SQLITE_STATIC);
-
-        rc = sqlite3_step(insertStmt);
-        sqlite3_finalize(insertStmt);
-
-        if (rc != SQLITE_DONE) {
-            log(LogLevel::LOGERROR, "Failed to insert file record: " + std::string(sqlite3_errmsg(db)));
+    for (const FileRecord& file : files) {
+        if (!upsertFile(db, file)) {
             sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
             releaseDbConnection(db);
             return false;
         }
     }
 
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-    log(LogLevel::INFO, "File record inserted or updated successfully.");
+    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        log(LogLevel::LOGERROR, "addFiles - Failed to commit: " + std::string(sqlite3_errmsg(db)));
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        releaseDbConnection(db);
+        return false;
+    }
+    log(LogLevel::INFO, files.size() == 1 ? "File record inserted or updated successfully."
+                                          : std::to_string(files.size()) + " file records inserted or updated successfully.");
     releaseDbConnection(db);
     return true;
 }
@@ -722,6 +833,38 @@ std::string DBManager::getFileIdByShortId(const std::string& shortId) {
     return fileId;
 }
 
+bool DBManager::getFileByContentHash(const std::string& contentHash, std::string& fileId, std::string& shortId) {
+    if (contentHash.empty()) {
+        return false;
+    }
+
+    sqlite3* db = getDbConnection();
+    const char* query = "SELECT file_id, short_id FROM files "
+                        "WHERE content_hash = ? AND short_id IS NOT NULL AND short_id != '' "
+                        "ORDER BY id DESC LIMIT 1";
+    sqlite3_stmt* stmt;
+    bool found = false;
+
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, contentHash.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const unsigned char* fileIdText = sqlite3_column_text(stmt, 0);
+            const unsigned char* shortIdText = sqlite3_column_text(stmt, 1);
+            if (fileIdText != nullptr && shortIdText != nullptr) {
+                fileId = reinterpret_cast<const char*>(fileIdText);
+                shortId = reinterpret_cast<const char*>(shortIdText);
+                found = true;
+            }
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        log(LogLevel::LOGERROR, "getFileByContentHash - Failed to prepare SELECT statement: " + std::string(sqlite3_errmsg(db)));
+    }
+
+    releaseDbConnection(db);
+    return found;
+}
+
 void DBManager::setRegistrationOpen(bool isOpen) {
     sqlite3* db = getDbConnection();
 
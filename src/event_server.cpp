@@ -0,0 +1,838 @@
+// event_server.cpp
+
+#include "event_server.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+// 单次可写事件中最多发送的字节数，避免一个快速客户端独占事件循环
+constexpr size_t kMaxBytesPerWrite = 4 * 1024 * 1024;
+constexpr size_t kReadChunkSize = 8192;
+
+const char* statusReason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 206: return "Partial Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 416: return "Range Not Satisfiable";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    return value;
+}
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+// 解析单个范围的 Range 头（bytes=a-b / bytes=a- / bytes=-n），多个范围时不支持，按完整内容返回
+// 返回 1 表示有效范围，0 表示忽略，-1 表示范围无法满足
+int parseRange(const std::string& header, size_t totalSize, size_t& first, size_t& last) {
+    if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos) {
+        return 0;
+    }
+    std::string spec = header.substr(6);
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos) {
+        return 0;
+    }
+    std::string startText = trim(spec.substr(0, dash));
+    std::string endText = trim(spec.substr(dash + 1));
+    try {
+        if (startText.empty()) {
+            if (endText.empty()) {
+                return 0;
+            }
+            size_t suffix = std::stoull(endText);
+            if (suffix == 0 || totalSize == 0) {
+                return -1;
+            }
+            first = suffix >= totalSize ? 0 : totalSize - suffix;
+            last = totalSize - 1;
+            return 1;
+        }
+        first = std::stoull(startText);
+        last = endText.empty() ? totalSize - 1 : std::min<size_t>(std::stoull(endText), totalSize - 1);
+    } catch (const std::exception&) {
+        return 0;
+    }
+    if (totalSize == 0 || first >= totalSize || first > last) {
+        return -1;
+    }
+    return 1;
+}
+
+}  // namespace
+
+std::string EventRequest::header(const std::string& name) const {
+    auto it = headers.find(name);
+    return it != headers.end() ? it->second : std::string();
+}
+
+#ifdef __linux__
+
+enum class ConnectionState {
+    Reading,     // 等待完整的请求头
+    Resolving,   // 请求已交给线程池处理
+    Writing,     // 发送响应
+};
+
+struct EventServer::Connection {
+    int fd = -1;
+    uint64_t generation = 0;   // 区分复用同一 fd 的不同连接
+    ConnectionState state = ConnectionState::Reading;
+    uint32_t interest = 0;
+
+    EventRequest request;
+    std::string input;
+    bool keepAlive = false;
+    bool headOnly = false;
+    bool peerClosed = false;   // 客户端已关闭写方向（half-close），仍需响应已收到的请求
+
+    std::string output;        // 响应头（错误响应时也包含正文）
+    size_t outputSent = 0;
+    std::string body;
+    size_t bodyOffset = 0;
+    size_t bodyEnd = 0;
+    int fileFd = -1;
+    off_t fileOffset = 0;
+    off_t fileEnd = 0;
+
+    EventRequestLog requestLog;
+    std::function<void(const EventRequestLog&)> onComplete;
+    std::chrono::steady_clock::time_point lastActivity;
+};
+
+struct EventServer::Loop {
+    int epollFd = -1;
+    int listenFd = -1;
+    int wakeFd = -1;
+    std::thread thread;
+
+    struct Completion {
+        int fd;
+        uint64_t generation;
+        std::chrono::steady_clock::time_point handledAt;
+        EventResponse response;
+    };
+
+    std::mutex completionMutex;
+    std::vector<Completion> completions;
+
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    uint64_t nextGeneration = 1;
+
+    ~Loop() {
+        for (int fd : {epollFd, listenFd, wakeFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+};
+
+// 一个请求的结果交付状态，由 Responder 的所有副本共享；最后一个副本销毁时仍未交付则返回 500
+struct EventServer::PendingResponse {
+    EventServer* server;
+    Loop* loop;
+    int fd;
+    uint64_t generation;
+    std::atomic<bool> delivered;
+
+    PendingResponse(EventServer* server, Loop* loop, int fd, uint64_t generation)
+        : server(server), loop(loop), fd(fd), generation(generation), delivered(false) {}
+
+    ~PendingResponse() {
+        if (!delivered.load()) {
+            log(LogLevel::LOGERROR, "Event server handler finished without a response");
+            EventResponse response;
+            response.status = 500;
+            response.body = "Internal Server Error";
+            server->deliver(*loop, fd, generation, std::move(response));
+        }
+        server->releasePending();
+    }
+};
+
+namespace {
+
+int createListenSocket(const std::string& hostname, int port, int backlog) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo* result = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(hostname.empty() ? nullptr : hostname.c_str(), service.c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* address = result; address != nullptr; address = address->ai_next) {
+        fd = ::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0 && ::listen(fd, backlog) == 0) {
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+std::string formatAddress(const struct sockaddr_storage& address) {
+    char text[INET6_ADDRSTRLEN] = {0};
+    if (address.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in&>(address).sin_addr, text, sizeof(text));
+    } else if (address.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6&>(address).sin6_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+}  // namespace
+
+EventServer::EventServer(const EventServerOptions& options, Handler handler)
+    : options(options), handler(std::move(handler)), stopping(false), connectionCount(0), started(false), pendingResponses(0) {}
+
+EventServer::~EventServer() {
+    stop();
+}
+
+bool EventServer::start() {
+    int loopCount = std::max(options.loopThreads, 1);
+    for (int i = 0; i < loopCount; ++i) {
+        auto loop = std::make_unique<Loop>();
+        loop->listenFd = createListenSocket(options.hostname, options.port, options.listenBacklog);
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->listenFd < 0 || loop->epollFd < 0 || loop->wakeFd < 0) {
+            log(LogLevel::LOGERROR, "Event server failed to listen on " + options.hostname + ":" + std::to_string(options.port) +
+                                        ": " + std::strerror(errno));
+            loops.clear();
+            return false;
+        }
+
+        // data.fd 为 -1 / -2 分别表示监听套接字和唤醒事件，其余为连接 fd
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = -1;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->listenFd, &event);
+        event.data.fd = -2;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &event);
+        loops.push_back(std::move(loop));
+    }
+
+    workerPool = std::make_unique<ThreadPool>(std::max(options.minWorkerThreads, 0), std::max(options.maxWorkerThreads, 1),
+                                              std::chrono::seconds(30));
+    for (auto& loop : loops) {
+        Loop* loopPtr = loop.get();
+        loop->thread = std::thread([this, loopPtr]() { runLoop(*loopPtr); });
+    }
+    started = true;
+    log(LogLevel::INFO, "Event server running on port: " + std::to_string(options.port) + " with " +
+                            std::to_string(loopCount) + " event loops");
+    return true;
+}
+
+void EventServer::stop() {
+    if (!started) {
+        return;
+    }
+    started = false;
+    stopping.store(true);
+    for (auto& loop : loops) {
+        loop->wake();
+    }
+    for (auto& loop : loops) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+
+    // 先等线程池执行完剩余任务、异步处理中的请求交付结果（它们会向已停止的事件循环投递），再释放事件循环
+    workerPool.reset();
+    {
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingDone.wait(lock, [this]() { return pendingResponses == 0; });
+    }
+    for (auto& loop : loops) {
+        for (auto& completion : loop->completions) {
+            if (completion.response.fileFd >= 0) {
+                ::close(completion.response.fileFd);
+            }
+        }
+        while (!loop->connections.empty()) {
+            closeConnection(*loop, *loop->connections.begin()->second);
+        }
+    }
+    loops.clear();
+}
+
+void EventServer::runLoop(Loop& loop) {
+    std::vector<struct epoll_event> events(256);
+    auto lastSweep = std::chrono::steady_clock::now();
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int count = epoll_wait(loop.epollFd, events.data(), static_cast<int>(events.size()), 1000);
+        if (count < 0 && errno != EINTR) {
+            log(LogLevel::LOGERROR, "epoll_wait failed: " + std::string(std::strerror(errno)));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == -1) {
+                acceptConnections(loop);
+            } else if (fd == -2) {
+                uint64_t value;
+                while (::read(loop.wakeFd, &value, sizeof(value)) > 0) {
+                }
+                processCompletions(loop);
+            } else {
+                auto it = loop.connections.find(fd);
+                if (it != loop.connections.end()) {
+                    handleEvent(loop, *it->second, events[i].events);
+                }
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= std::chrono::seconds(1)) {
+            lastSweep = now;
+            closeIdleConnections(loop);
+        }
+    }
+}
+
+void EventServer::acceptConnections(Loop& loop) {
+    for (;;) {
+        struct sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        int fd = accept4(loop.listenFd, reinterpret_cast<struct sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log(LogLevel::WARNING, "Event server accept failed: " + std::string(std::strerror(errno)));
+            }
+            return;
+        }
+
+        if (connectionCount.load(std::memory_order_relaxed) >= options.maxConnections) {
+            ::close(fd);
+            continue;
+        }
+
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->generation = loop.nextGeneration++;
+        connection->request.remoteAddr = formatAddress(address);
+        connection->lastActivity = std::chrono::steady_clock::now();
+
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connection->interest = event.events;
+        loop.connections[fd] = std::move(connection);
+        connectionCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void EventServer::updateInterest(Loop& loop, Connection& connection, uint32_t events) {
+    if (connection.interest == events) {
+        return;
+    }
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = connection.fd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.interest = events;
+}
+
+void EventServer::handleEvent(Loop& loop, Connection& connection, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        closeConnection(loop, connection);
+        return;
+    }
+    if (connection.state == ConnectionState::Reading && (events & (EPOLLIN | EPOLLRDHUP))) {
+        readRequest(loop, connection);
+    } else if (connection.state == ConnectionState::Writing && (events & EPOLLOUT)) {
+        writeResponse(loop, connection);
+    }
+}
+
+void EventServer::readRequest(Loop& loop, Connection& connection) {
+    char buffer[kReadChunkSize];
+    for (;;) {
+        ssize_t received = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<size_t>(received));
+            connection.lastActivity = std::chrono::steady_clock::now();
+            if (connection.input.size() > options.maxRequestHeaderBytes) {
+                break;
+            }
+            continue;
+        }
+        if (received == 0) {
+            connection.peerClosed = true;  // 客户端关闭连接，已收到完整请求时仍然响应
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            closeConnection(loop, connection);
+            return;
+        }
+        break;
+    }
+
+    switch (parseRequest(loop, connection)) {
+        case ParseResult::Ready:
+            dispatch(loop, connection);
+            break;
+        case ParseResult::Incomplete:
+            // 客户端已关闭时不会再收到剩余部分
+            if (connection.peerClosed) {
+                closeConnection(loop, connection);
+            }
+            break;
+        case ParseResult::Responded:
+            break;  // 连接可能已被关闭，不能再访问 connection
+    }
+}
+
+EventServer::ParseResult EventServer::parseRequest(Loop& loop, Connection& connection) {
+    size_t headerEnd = connection.input.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        if (connection.input.size() > options.maxRequestHeaderBytes) {
+            sendError(loop, connection, 431, "Request Header Fields Too Large");
+            return ParseResult::Responded;
+        }
+        return ParseResult::Incomplete;
+    }
+
+    connection.headOnly = false;
+    std::string head = connection.input.substr(0, headerEnd);
+    connection.input.erase(0, headerEnd + 4);
+
+    EventRequest& request = connection.request;
+    request.headers.clear();
+    request.receivedAt = std::chrono::steady_clock::now();
+
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        sendError(loop, connection, 400, "Bad Request");
+        return ParseResult::Responded;
+    }
+    request.method = requestLine.substr(0, firstSpace);
+    std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    std::string version = requestLine.substr(secondSpace + 1);
+    request.path = target.substr(0, target.find('?'));
+
+    size_t position = lineEnd;
+    while (position != std::string::npos && position < head.size()) {
+        size_t next = head.find("\r\n", position + 2);
+        std::string line = head.substr(position + 2, next == std::string::npos ? std::string::npos : next - position - 2);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            request.headers[toLower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+        position = next;
+    }
+
+    std::string connectionHeader = toLower(request.header("connection"));
+    if (version == "HTTP/1.1") {
+        connection.keepAlive = connectionHeader != "close";
+    } else if (version == "HTTP/1.0") {
+        connection.keepAlive = connectionHeader == "keep-alive";
+    } else {
+        sendError(loop, connection, 400, "Bad Request");
+        return ParseResult::Responded;
+    }
+    if (connection.peerClosed) {
+        connection.keepAlive = false;
+    }
+
+    // 只处理下载请求，不支持请求体
+    if (request.method != "GET" && request.method != "HEAD") {
+        connection.keepAlive = false;
+        sendError(loop, connection, 405, "Method Not Allowed");
+        return ParseResult::Responded;
+    }
+    if (!request.header("transfer-encoding").empty() ||
+        (!request.header("content-length").empty() && request.header("content-length") != "0")) {
+        connection.keepAlive = false;
+        sendError(loop, connection, 400, "Bad Request");
+        return ParseResult::Responded;
+    }
+    connection.headOnly = request.method == "HEAD";
+    return ParseResult::Ready;
+}
+
+void EventServer::dispatch(Loop& loop, Connection& connection) {
+    connection.state = ConnectionState::Resolving;
+    connection.requestLog = EventRequestLog();
+    connection.requestLog.dispatchedAt = std::chrono::steady_clock::now();
+    // 处理期间不关心读写事件（EPOLLERR / EPOLLHUP 仍会上报）
+    updateInterest(loop, connection, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        ++pendingResponses;
+    }
+    auto pending = std::make_shared<PendingResponse>(this, &loop, connection.fd, connection.generation);
+    Responder respond = [pending](EventResponse&& response) {
+        if (pending->delivered.exchange(true)) {
+            if (response.fileFd >= 0) {
+                ::close(response.fileFd);
+            }
+            return;
+        }
+        pending->server->deliver(*pending->loop, pending->fd, pending->generation, std::move(response));
+    };
+
+    // 任务被线程池拒绝时 respond 随之销毁，由 PendingResponse 返回 500
+    workerPool->enqueue([this, request = connection.request, respond = std::move(respond)]() {
+        try {
+            handler(request, respond);
+        } catch (const std::exception& e) {
+            log(LogLevel::LOGERROR, "Event server handler failed: " + std::string(e.what()));
+            EventResponse response;
+            response.status = 500;
+            response.body = "Internal Server Error";
+            respond(std::move(response));
+        }
+    });
+}
+
+void EventServer::deliver(Loop& loop, int fd, uint64_t generation, EventResponse&& response) {
+    {
+        std::lock_guard<std::mutex> lock(loop.completionMutex);
+        loop.completions.push_back({fd, generation, std::chrono::steady_clock::now(), std::move(response)});
+    }
+    loop.wake();
+}
+
+void EventServer::releasePending() {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (--pendingResponses == 0) {
+        pendingDone.notify_all();
+    }
+}
+
+void EventServer::processCompletions(Loop& loop) {
+    std::vector<Loop::Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(loop.completionMutex);
+        completions.swap(loop.completions);
+    }
+
+    for (auto& completion : completions) {
+        auto it = loop.connections.find(completion.fd);
+        if (it == loop.connections.end() || it->second->generation != completion.generation ||
+            it->second->state != ConnectionState::Resolving) {
+            // 连接已经关闭
+            if (completion.response.fileFd >= 0) {
+                ::close(completion.response.fileFd);
+            }
+            continue;
+        }
+        it->second->requestLog.handledAt = completion.handledAt;
+        startResponse(loop, *it->second, std::move(completion.response));
+    }
+}
+
+void EventServer::sendError(Loop& loop, Connection& connection, int status, const std::string& message) {
+    if (connection.state == ConnectionState::Reading) {
+        connection.requestLog = EventRequestLog();
+        connection.requestLog.dispatchedAt = std::chrono::steady_clock::now();
+        connection.requestLog.handledAt = connection.requestLog.dispatchedAt;
+    }
+    if (status >= 400 && status != 404 && status != 416) {
+        connection.keepAlive = false;
+    }
+    EventResponse response;
+    response.status = status;
+    response.body = message;
+    startResponse(loop, connection, std::move(response));
+}
+
+void EventServer::startResponse(Loop& loop, Connection& connection, EventResponse&& response) {
+    connection.state = ConnectionState::Writing;
+    connection.output.clear();
+    connection.outputSent = 0;
+    connection.body.clear();
+    connection.bodyOffset = 0;
+    connection.bodyEnd = 0;
+    connection.fileFd = -1;
+
+    bool fromFile = response.fileFd >= 0;
+    size_t totalSize = fromFile ? response.fileSize : response.body.size();
+    size_t first = 0;
+    size_t last = totalSize == 0 ? 0 : totalSize - 1;
+    int status = response.status;
+    std::string contentRange;
+
+    if (status == 200) {
+        std::string range = connection.request.header("range");
+        int rangeResult = range.empty() ? 0 : parseRange(range, totalSize, first, last);
+        if (rangeResult == 1) {
+            status = 206;
+            contentRange = "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(totalSize);
+        } else if (rangeResult == -1) {
+            if (fromFile) {
+                ::close(response.fileFd);
+            }
+            fromFile = false;
+            status = 416;
+            contentRange = "bytes */" + std::to_string(totalSize);
+            response.body.clear();
+            totalSize = 0;
+        }
+    }
+    size_t contentLength = (status == 416 || totalSize == 0) ? 0 : last - first + 1;
+
+    std::string& output = connection.output;
+    output.reserve(256);
+    output += "HTTP/1.1 " + std::to_string(status) + " " + statusReason(status) + "\r\n";
+    output += "Content-Type: " + response.contentType + "\r\n";
+    output += "Content-Length: " + std::to_string(contentLength) + "\r\n";
+    if (response.status == 200) {
+        output += "Accept-Ranges: bytes\r\n";
+    }
+    if (!contentRange.empty()) {
+        output += "Content-Range: " + contentRange + "\r\n";
+    }
+    for (const auto& header : response.headers) {
+        output += header.first + ": " + header.second + "\r\n";
+    }
+    output += connection.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    connection.requestLog.status = status;
+    connection.onComplete = std::move(response.onComplete);
+    if (!connection.headOnly && contentLength > 0) {
+        if (fromFile) {
+            connection.fileFd = response.fileFd;
+            connection.fileOffset = static_cast<off_t>(first);
+            connection.fileEnd = static_cast<off_t>(last + 1);
+            fromFile = false;  // 所有权已转移
+        } else {
+            connection.body = std::move(response.body);
+            connection.bodyOffset = first;
+            connection.bodyEnd = last + 1;
+        }
+    }
+    if (fromFile) {
+        ::close(response.fileFd);
+    }
+
+    connection.lastActivity = std::chrono::steady_clock::now();
+    writeResponse(loop, connection);
+}
+
+void EventServer::writeResponse(Loop& loop, Connection& connection) {
+    size_t writtenThisRound = 0;
+    for (;;) {
+        ssize_t written = 0;
+        if (connection.outputSent < connection.output.size()) {
+            // 响应头和内存中的正文一起发送
+            struct iovec parts[2];
+            parts[0].iov_base = const_cast<char*>(connection.output.data()) + connection.outputSent;
+            parts[0].iov_len = connection.output.size() - connection.outputSent;
+            parts[1].iov_base = const_cast<char*>(connection.body.data()) + connection.bodyOffset;
+            parts[1].iov_len = connection.bodyEnd - connection.bodyOffset;
+            struct msghdr message;
+            std::memset(&message, 0, sizeof(message));
+            message.msg_iov = parts;
+            message.msg_iovlen = parts[1].iov_len > 0 ? 2 : 1;
+            written = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL | (connection.fileFd >= 0 ? MSG_MORE : 0));
+            if (written > 0) {
+                size_t headerPart = std::min<size_t>(static_cast<size_t>(written), parts[0].iov_len);
+                connection.outputSent += headerPart;
+                connection.bodyOffset += static_cast<size_t>(written) - headerPart;
+            }
+        } else if (connection.bodyOffset < connection.bodyEnd) {
+            written = ::send(connection.fd, connection.body.data() + connection.bodyOffset,
+                             connection.bodyEnd - connection.bodyOffset, MSG_NOSIGNAL);
+            if (written > 0) {
+                connection.bodyOffset += static_cast<size_t>(written);
+            }
+        } else if (connection.fileFd >= 0 && connection.fileOffset < connection.fileEnd) {
+            // 零拷贝：内核直接从页缓存发送文件内容
+            size_t chunk = std::min<size_t>(static_cast<size_t>(connection.fileEnd - connection.fileOffset), kMaxBytesPerWrite);
+            written = ::sendfile(connection.fd, connection.fileFd, &connection.fileOffset, chunk);
+            if (written == 0) {
+                closeConnection(loop, connection);  // 文件被截断
+                return;
+            }
+        } else {
+            finishResponse(loop, connection);
+            return;
+        }
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                updateInterest(loop, connection, EPOLLOUT);
+                return;
+            }
+            closeConnection(loop, connection);
+            return;
+        }
+
+        connection.requestLog.bytesSent += static_cast<size_t>(written);
+        connection.lastActivity = std::chrono::steady_clock::now();
+        writtenThisRound += static_cast<size_t>(written);
+        if (writtenThisRound >= kMaxBytesPerWrite) {
+            // 让出事件循环，剩余部分等下一次可写事件
+            updateInterest(loop, connection, EPOLLOUT);
+            return;
+        }
+    }
+}
+
+void EventServer::finishResponse(Loop& loop, Connection& connection) {
+    connection.requestLog.completed = true;
+    connection.requestLog.finishedAt = std::chrono::steady_clock::now();
+    if (connection.onComplete) {
+        connection.onComplete(connection.requestLog);
+        connection.onComplete = nullptr;
+    }
+
+    if (connection.fileFd >= 0) {
+        ::close(connection.fileFd);
+        connection.fileFd = -1;
+    }
+    connection.body.clear();
+    connection.body.shrink_to_fit();
+    connection.output.clear();
+
+    if (!connection.keepAlive) {
+        closeConnection(loop, connection);
+        return;
+    }
+
+    connection.state = ConnectionState::Reading;
+    connection.lastActivity = std::chrono::steady_clock::now();
+    updateInterest(loop, connection, EPOLLIN | EPOLLRDHUP);
+
+    // 客户端可能已经发来了下一个请求
+    if (!connection.input.empty() && parseRequest(loop, connection) == ParseResult::Ready) {
+        dispatch(loop, connection);
+    }
+}
+
+void EventServer::closeConnection(Loop& loop, Connection& connection) {
+    if (connection.state == ConnectionState::Writing && connection.onComplete) {
+        connection.requestLog.completed = false;
+        connection.requestLog.finishedAt = std::chrono::steady_clock::now();
+        connection.onComplete(connection.requestLog);
+    }
+    if (connection.fileFd >= 0) {
+        ::close(connection.fileFd);
+    }
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+    ::close(connection.fd);
+    loop.connections.erase(connection.fd);  // connection 在此之后失效
+    connectionCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EventServer::closeIdleConnections(Loop& loop) {
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(options.idleTimeoutSeconds);
+    std::vector<int> expired;
+    for (const auto& entry : loop.connections) {
+        // 处理中的请求不计入空闲时间
+        if (entry.second->state != ConnectionState::Resolving && entry.second->lastActivity < deadline) {
+            expired.push_back(entry.first);
+        }
+    }
+    for (int fd : expired) {
+        closeConnection(loop, *loop.connections[fd]);
+    }
+}
+
+#else  // !__linux__
+
+struct EventServer::Connection {};
+struct EventServer::Loop {};
+
+EventServer::EventServer(const EventServerOptions& options, Handler handler)
+    : options(options), handler(std::move(handler)), stopping(false), connectionCount(0), started(false), pendingResponses(0) {}
+
+EventServer::~EventServer() {}
+
+bool EventServer::start() {
+    log(LogLevel::LOGERROR, "Event server requires Linux epoll and is not available on this platform");
+    return false;
+}
+
+void EventServer::stop() {}
+
+#endif
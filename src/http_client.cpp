@@ -2,8 +2,12 @@
 #include <curl/curl.h>
 #include <iostream>
 #include "utils.h"
+#include "metrics.h"
+#include "request_context.h"
 #include <mutex>
 #include <iomanip>
+#include <chrono>
+#include <vector>
 
 // 线程安全的CURL初始化和清理
 std::mutex curlMutex;  // 用于保证CURL全局初始化的线程安全
@@ -20,6 +24,19 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s)
     return newLength;
 }
 
+// Telegram 上游请求的耗时与失败次数
+void recordUpstreamRequest(double durationSeconds, bool failed) {
+    static Histogram& duration = MetricsRegistry::getInstance().histogram(
+        "upstream_request_duration_seconds", "Latency of requests to the Telegram API", {{"upstream", "telegram"}});
+    static Counter& failures = MetricsRegistry::getInstance().counter(
+        "upstream_request_failures_total", "Failed requests to the Telegram API", {{"upstream", "telegram"}});
+    duration.observe(durationSeconds);
+    RequestContext::current().upstreamMicros += static_cast<int64_t>(durationSeconds * 1e6);
+    if (failed) {
+        failures.inc();
+    }
+}
+
 // 确保CURL全局只初始化一次
 void initCurlOnce() {
     std::lock_guard<std::mutex> lock(curlMutex);
@@ -29,33 +46,209 @@ void initCurlOnce() {
     }
 }
 
+namespace {
+
+void setDefaultOptions(CURL* curl, const HttpClientOptions& options, bool http2Supported) {
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);          // 多线程下不能依赖信号实现超时
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, options.connectTimeoutSeconds);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 60L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);     // 启用TCP Keep-Alive
+    if (options.http2 && http2Supported) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    }
+}
+
+// curl easy 句柄池，句柄通过同一个 CURLSH 共享 DNS 缓存、TLS 会话和连接缓存
+class CurlHandlePool {
+public:
+    static CurlHandlePool& getInstance() {
+        static CurlHandlePool instance;
+        return instance;
+    }
+
+    void configure(const HttpClientOptions& newOptions) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        options = newOptions;
+        http2Supported = (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+        if (options.http2 && !http2Supported) {
+            log(LogLevel::WARNING, "libcurl was built without HTTP/2 support, using HTTP/1.1 for Telegram API requests");
+        }
+    }
+
+    HttpClientOptions getOptions() {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return options;
+    }
+
+    void applyDefaults(CURL* curl) {
+        setDefaultOptions(curl, getOptions(), http2Supported);
+    }
+
+    CURL* acquire() {
+        CURL* curl = nullptr;
+        HttpClientOptions current;
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            current = options;
+            if (!idleHandles.empty()) {
+                curl = idleHandles.back();
+                idleHandles.pop_back();
+            }
+        }
+        if (!curl) {
+            curl = curl_easy_init();
+            if (!curl) {
+                return nullptr;
+            }
+        }
+
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        setDefaultOptions(curl, current, http2Supported);
+        return curl;
+    }
+
+    void release(CURL* curl) {
+        // reset 只清除选项，连接、DNS 和 TLS 会话缓存保留在共享对象中
+        curl_easy_reset(curl);
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            if (idleHandles.size() < options.maxIdleHandles) {
+                idleHandles.push_back(curl);
+                return;
+            }
+        }
+        curl_easy_cleanup(curl);
+    }
+
+private:
+    CURLSH* share;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+    std::mutex poolMutex;
+    std::vector<CURL*> idleHandles;
+    HttpClientOptions options;
+    bool http2Supported;
+
+    CurlHandlePool() : http2Supported(false) {
+        initCurlOnce();
+        share = curl_share_init();
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        configure(HttpClientOptions());
+    }
+
+    ~CurlHandlePool() {
+        for (CURL* curl : idleHandles) {
+            curl_easy_cleanup(curl);
+        }
+        curl_share_cleanup(share);
+    }
+
+    static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<CurlHandlePool*>(userptr)->shareLocks[data].lock();
+    }
+
+    static void unlockShare(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<CurlHandlePool*>(userptr)->shareLocks[data].unlock();
+    }
+};
+
+Counter& upstreamConnections() {
+    static Counter& counter = MetricsRegistry::getInstance().counter(
+        "upstream_connections_opened_total", "New connections opened to the Telegram API (the rest reuse a pooled connection)",
+        {{"upstream", "telegram"}});
+    return counter;
+}
+
+}  // namespace
+
+void configureHttpClient(const HttpClientOptions& options) {
+    CurlHandlePool::getInstance().configure(options);
+}
+
+PooledCurlHandle::PooledCurlHandle() : handle(CurlHandlePool::getInstance().acquire()) {}
+
+PooledCurlHandle::~PooledCurlHandle() {
+    if (handle) {
+        CurlHandlePool::getInstance().release(handle);
+    }
+}
+
+void applyUpstreamDefaults(CURL* curl) {
+    CurlHandlePool::getInstance().applyDefaults(curl);
+}
+
+HttpClientOptions getHttpClientOptions() {
+    return CurlHandlePool::getInstance().getOptions();
+}
+
+CircuitBreaker& getTelegramCircuitBreaker() {
+    static CircuitBreaker breaker;
+    return breaker;
+}
+
+void recordUpstreamRejected() {
+    static Counter& rejected = MetricsRegistry::getInstance().counter(
+        "upstream_circuit_rejected_total", "Requests to the Telegram API rejected by the open circuit breaker", {{"upstream", "telegram"}});
+    rejected.inc();
+}
+
+void recordUpstreamTransfer(CURL* curl, double durationSeconds, CURLcode result) {
+    recordUpstreamRequest(durationSeconds, result != CURLE_OK);
+
+    // 只有连不上、超时和 5xx 说明上游不可用；客户端断开导致的写入中止、4xx 都不计入
+    long status = 0;
+    if (result == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    }
+    bool clientAborted = result == CURLE_WRITE_ERROR || result == CURLE_ABORTED_BY_CALLBACK;
+    if (!clientAborted) {
+        if (result != CURLE_OK || status >= 500) {
+            getTelegramCircuitBreaker().recordFailure();
+        } else {
+            getTelegramCircuitBreaker().recordSuccess();
+        }
+    }
+
+    long newConnections = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnections) == CURLE_OK && newConnections > 0) {
+        upstreamConnections().inc(static_cast<uint64_t>(newConnections));
+    }
+}
+
+CURLcode performUpstreamRequest(CURL* curl) {
+    if (!getTelegramCircuitBreaker().allowRequest()) {
+        recordUpstreamRejected();
+        return CURLE_COULDNT_CONNECT;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    CURLcode res = curl_easy_perform(curl);
+    recordUpstreamTransfer(curl, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count(), res);
+    return res;
+}
+
 // 发送 HTTP 请求并返回响应，兼容原来的单线程调用，也能在多线程中使用
 std::string sendHttpRequest(const std::string& url) {
-    initCurlOnce();  // 确保全局CURL只初始化一次
-
-    CURL* curl = curl_easy_init();  // 每个线程独立使用自己的CURL句柄
-    CURLcode res;
+    PooledCurlHandle curl;  // 从池中借出句柄，复用已建立的连接
     std::string response;
 
     if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);  // 自动处理重定向
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);        // 设置超时时间
-
-        // 使用共享连接池来减少连接开销
-        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 60L);
-        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);   // 启用TCP Keep-Alive
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
+        curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);  // 自动处理重定向
+        curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, 10L);        // 设置超时时间
 
-        res = curl_easy_perform(curl);
+        CURLcode res = performUpstreamRequest(curl.get());
         if (res != CURLE_OK) {
             log(LogLevel::LOGERROR, "curl_easy_perform() failed: " + std::string(curl_easy_strerror(res)) + " URL: " + url);
         } 
         // else {
         //     log(LogLevel::INFO,"API Response: " + std::string(response) );
         // }
-        curl_easy_cleanup(curl);  // 清理当前线程的CURL句柄
     } else {
         log(LogLevel::LOGERROR, "Failed to initialize CURL.");
     }
@@ -63,6 +256,82 @@ std::string sendHttpRequest(const std::string& url) {
     return response;
 }
 
+HttpResponse postJson(const std::string& url, const std::string& body, long timeoutSeconds) {
+    HttpResponse response;
+    PooledCurlHandle curl;
+    if (!curl) {
+        log(LogLevel::LOGERROR, "Failed to initialize CURL.");
+        return response;
+    }
+
+    struct curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+    curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS, body.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body.size()));
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response.body);
+    curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, timeoutSeconds);
+
+    CURLcode res = performUpstreamRequest(curl.get());
+    curl_slist_free_all(headers);
+    if (res != CURLE_OK) {
+        log(LogLevel::LOGERROR, "curl_easy_perform() failed: " + std::string(curl_easy_strerror(res)));
+        return response;
+    }
+    response.ok = true;
+    curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response.status);
+    return response;
+}
+
+void fillMimeParts(curl_mime* mime, const std::vector<HttpFormField>& fields) {
+    for (const HttpFormField& field : fields) {
+        curl_mimepart* part = curl_mime_addpart(mime);
+        curl_mime_name(part, field.name.c_str());
+        if (!field.filePath.empty()) {
+            curl_mime_filedata(part, field.filePath.c_str());  // 同时把文件名设为路径的最后一段，下面按需覆盖
+        } else {
+            curl_mime_data(part, field.content.data(), field.content.size());  // 复制一份内容
+        }
+        if (!field.filename.empty()) {
+            curl_mime_filename(part, field.filename.c_str());
+        }
+        if (!field.contentType.empty()) {
+            curl_mime_type(part, field.contentType.c_str());
+        }
+    }
+}
+
+HttpResponse postMultipart(const std::string& url, const std::vector<HttpFormField>& fields, long timeoutSeconds) {
+    HttpResponse response;
+    PooledCurlHandle curl;
+    if (!curl) {
+        log(LogLevel::LOGERROR, "Failed to initialize CURL.");
+        return response;
+    }
+
+    curl_mime* mime = curl_mime_init(curl.get());
+    fillMimeParts(mime, fields);
+
+    curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_MIMEPOST, mime);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response.body);
+    curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, timeoutSeconds);
+
+    CURLcode res = performUpstreamRequest(curl.get());
+    if (res == CURLE_OK) {
+        response.ok = true;
+        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response.status);
+    } else {
+        log(LogLevel::LOGERROR, "curl_easy_perform() failed: " + std::string(curl_easy_strerror(res)));
+    }
+    // 句柄归还前解除对 mime 的引用
+    curl_easy_setopt(curl.get(), CURLOPT_MIMEPOST, nullptr);
+    curl_mime_free(mime);
+    return response;
+}
+
 // 构建 Telegram 发送消息的 URL 并对文本参数进行编码
 std::string buildTelegramUrl(const std::string& text) {
     std::ostringstream escaped;
@@ -1,8 +1,11 @@
 #include "image_cache_manager.h"
 #include "utils.h"
+#include "metrics.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
 
 #ifdef _WIN32
 #include <direct.h>
@@ -10,11 +13,21 @@
 #include <sys/stat.h>
 #else
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <limits.h>
 #endif
 
+namespace {
+
+CacheTierMetrics& diskCacheMetrics() {
+    static CacheTierMetrics metrics("disk");
+    return metrics;
+}
+
+}  // namespace
+
 ImageCacheManager::ImageCacheManager(const std::string& cacheDir, size_t maxDiskUsageMB, int maxCacheAgeSeconds)
     : maxDiskUsageBytes(maxDiskUsageMB * 1024 * 1024), maxCacheAgeSeconds(maxCacheAgeSeconds) {
 
@@ -59,7 +72,7 @@ void ImageCacheManager::cacheImage(const std::string& fileId, const std::string&
     if (file.is_open()) {
         file.write(imageData.c_str(), imageData.size());
         file.close();
-        log(LogLevel::INFO, "Cached image: " + fileId + " at " + filePath);
+        LOG(LogLevel::DEBUG, "Cached image: " + fileId + " at " + filePath);
 
         // 检查缓存大小是否超出限制
         cleanUpFilesOnDiskSpaceLimit();
@@ -76,18 +89,89 @@ std::string ImageCacheManager::getCachedImage(const std::string& fileId, const s
         std::ifstream file(filePath.c_str(), std::ios::binary);
         if (file.is_open()) {
             std::string imageData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-            log(LogLevel::INFO, "Cache hit: " + fileId + " from " + filePath);
+            LOG(LogLevel::DEBUG, "Cache hit: " + fileId + " from " + filePath);
+            diskCacheMetrics().record(true);
             return imageData;
         } else {
             log(LogLevel::LOGERROR, "Failed to open cached file: " + filePath);
         }
     } else {
-        log(LogLevel::WARNING, "Cache miss for file ID: " + fileId);
+        LOG(LogLevel::DEBUG, "Cache miss for file ID: " + fileId);
     }
 
+    diskCacheMetrics().record(false);
     return "";
 }
 
+int ImageCacheManager::openCachedImage(const std::string& fileId, const std::string& extension, size_t& fileSize) {
+#ifdef _WIN32
+    return -1;
+#else
+    // 持锁打开，避免读到正在写入的文件；打开后即使文件被清理线程删除，描述符仍然有效
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    std::string filePath = getCacheFilePath(fileId, extension);
+
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        diskCacheMetrics().record(false);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        diskCacheMetrics().record(false);
+        return -1;
+    }
+    fileSize = static_cast<size_t>(st.st_size);
+    diskCacheMetrics().record(true);
+    return fd;
+#endif
+}
+
+std::string ImageCacheManager::getDownloadPath(const std::string& fileId) const {
+    // 同一文件的并发下载各自写不同的临时文件
+    static std::atomic<uint64_t> sequence(0);
+    return getCacheFilePath(fileId, "." + std::to_string(sequence.fetch_add(1, std::memory_order_relaxed)) + ".download");
+}
+
+int ImageCacheManager::openDownloadedFile(const std::string& downloadPath, const std::string& fileId, const std::string& extension,
+                                          bool keep, size_t& fileSize) {
+#ifdef _WIN32
+    std::remove(downloadPath.c_str());
+    return -1;
+#else
+    int fd = ::open(downloadPath.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        log(LogLevel::LOGERROR, "Failed to open downloaded file or file is empty: " + downloadPath);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        std::remove(downloadPath.c_str());
+        return -1;
+    }
+    fileSize = static_cast<size_t>(st.st_size);
+
+    if (keep) {
+        // 同一目录内改名是原子的，openCachedImage 不会看到写了一半的文件
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        std::string filePath = getCacheFilePath(fileId, extension);
+        if (std::rename(downloadPath.c_str(), filePath.c_str()) == 0) {
+            LOG(LogLevel::DEBUG, "Cached image: " + fileId + " at " + filePath);
+            return fd;
+        }
+        log(LogLevel::LOGERROR, "Failed to move downloaded file into cache: " + filePath);
+    }
+    std::remove(downloadPath.c_str());
+    return fd;
+#endif
+}
+
+void ImageCacheManager::enforceDiskLimit() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cleanUpFilesOnDiskSpaceLimit();
+}
+
 std::string ImageCacheManager::getCacheFilePath(const std::string& fileId, const std::string& extension) const {
 #ifdef _WIN32
     return cacheDir + "\\" + fileId + extension;
@@ -4,27 +4,36 @@
 #include "server.h"
 #include "utils.h"
 #include "http_client.h"
+#include "upstream_engine.h"
+#include "telegram_scheduler.h"
 #include "db_manager.h"
 #include "CacheManager.h"
 #include <thread>
 #include <chrono>
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <nlohmann/json.hpp>
 
 void setWebhook(const std::string& apiToken, const std::string& webhookUrl, const std::string& secretToken, std::string& telegramApiUrl) {
     try {
+        int attempt = 0;
         while (true) {
             std::string setWebhookUrl = telegramApiUrl + "/bot" + apiToken + "/setWebhook?url=" + webhookUrl + "/webhook&secret_token=" + secretToken;
             log(LogLevel::INFO, "Trying to set Webhook with url: " + setWebhookUrl);
             std::string response = sendHttpRequest(setWebhookUrl);
 
-            if (response.find("404") == std::string::npos) { 
+            // 以响应中的 ok 字段判断是否成功；429 时按 retry_after 等待，其他失败（网络错误、5xx 等）按退避重试
+            nlohmann::json jsonResponse = nlohmann::json::parse(response, nullptr, false);
+            if (jsonResponse.is_object() && jsonResponse.contains("ok") && jsonResponse["ok"] == true) {
                 log(LogLevel::INFO,"Webhook set successfully. Response: " + response);
                 break;
-            } else {
-                log(LogLevel::LOGERROR, "Failed to set Webhook. Response: " + response);
-                std::this_thread::sleep_for(std::chrono::seconds(10));
             }
+            int retryAfter = TelegramScheduler::parseRetryAfter(response);
+            std::chrono::milliseconds delay = retryAfter >= 0 ? std::chrono::milliseconds(retryAfter * 1000LL)
+                                                               : TelegramScheduler::getInstance().backoffDelay(++attempt);
+            log(LogLevel::LOGERROR, "Failed to set Webhook. Response: " + response + ", retrying in " + std::to_string(delay.count()) + " ms");
+            std::this_thread::sleep_for(delay);
         }
     } catch (const std::system_error& e) {
         log(LogLevel::LOGERROR, "System error occurred in setWebhook: " + std::string(e.what()));
@@ -53,27 +62,63 @@ int main(int argc, char* argv[]) {
         std::string secretToken = config.getSecretToken();
         std::string telegramApiUrl = config.getTelegramApiUrl();
 
+        // 日志级别与输出位置
+        configureLogger(config.getLogFile(), config.getLogToConsole());
+        setLogLevel(parseLogLevel(config.getLogLevel()));
+
         log(LogLevel::INFO,"Starting application...");
 
-        // 初始化线程池
-        ThreadPool pool(4);
+        // Telegram API 客户端：复用连接的 curl 句柄池
+        HttpClientOptions httpClientOptions;
+        httpClientOptions.maxIdleHandles = static_cast<size_t>(std::max(config.getHttpClientMaxIdleHandles(), 0));
+        httpClientOptions.http2 = config.getHttpClientHttp2();
+        httpClientOptions.connectTimeoutSeconds = std::max(config.getHttpClientConnectTimeoutSeconds(), 1);
+        httpClientOptions.maxHostConnections = std::max(config.getHttpClientMaxHostConnections(), 1);
+        configureHttpClient(httpClientOptions);
+
+        // Telegram 连续失败时熔断，请求快速失败，已缓存的内容继续提供
+        CircuitBreakerOptions breakerOptions;
+        breakerOptions.failureThreshold = config.getCircuitBreakerFailureThreshold();
+        breakerOptions.openSeconds = config.getCircuitBreakerOpenSeconds();
+        getTelegramCircuitBreaker().configure(breakerOptions);
+
+        TelegramSchedulerOptions schedulerOptions;
+        schedulerOptions.globalPerSecond = config.getTelegramOutboundGlobalPerSecond();
+        schedulerOptions.privateChatIntervalMs = config.getTelegramOutboundPrivateChatIntervalMs();
+        schedulerOptions.groupPerMinute = config.getTelegramOutboundGroupPerMinute();
+        schedulerOptions.maxRetries = std::max(config.getTelegramOutboundMaxRetries(), 0);
+        schedulerOptions.baseBackoffMs = config.getTelegramOutboundBaseBackoffMs();
+        schedulerOptions.maxBackoffMs = config.getTelegramOutboundMaxBackoffMs();
+        schedulerOptions.maxQueuedPerChat = static_cast<size_t>(std::max(config.getTelegramOutboundMaxQueuedPerChat(), 1));
+        TelegramScheduler::getInstance().configure(schedulerOptions);
 
         // 创建 ImageCacheManager 实例，使用配置文件中的参数
         ImageCacheManager cacheManager("cache", config.getCacheMaxSizeMB(), config.getCacheMaxAgeSeconds());
 
         // 创建并启动缓存管理器（在单独的线程中运行）
-        CacheManager cacheManagerSystem(100, 60);  // 最大缓存大小100，清理间隔60秒
+        // 最大缓存大小100，清理间隔60秒；过期项在宽限期内保留，Telegram 不可用时继续使用
+        CacheManager cacheManagerSystem(100, 60, config.getCacheStaleGraceSeconds());
 
         // 创建 Bot 实例
         Bot bot(apiToken, dbManager);
 
+        // 后台线程池：Webhook 处理、磁盘缓存写入等，HTTP 服务使用自己的工作线程
+        // 线程数随排队任务在配置范围内伸缩；在其使用的对象之后创建，保证先于它们析构并执行完剩余任务
+        ThreadPool pool(std::max(config.getThreadPoolMinThreads(), 0), std::max(config.getThreadPoolMaxThreads(), 1),
+                        std::chrono::milliseconds(std::max(config.getThreadPoolIdleTimeoutMs(), 0)));
+        for (TaskPriority priority : {TaskPriority::High, TaskPriority::Normal, TaskPriority::Low}) {
+            std::string lane = taskPriorityName(priority);
+            pool.setQueueLimit(priority, std::max(config.getThreadPoolQueueCapacity(lane), 0),
+                               parseOverflowPolicy(config.getThreadPoolOverflowPolicy(lane)));
+        }
+
         // 获取配置的 Webhook URL
         std::string webhookUrl = config.getWebhookUrl();
 
         // 设置 Webhook，处理404错误
         setWebhook(apiToken, webhookUrl, secretToken, telegramApiUrl);
 
-        // 启动服务器，在一个单独的线程中运行
+        // 启动服务器，监听和 accept 在这个单独的线程中运行
         std::thread serverThread([&]() {
             try {
                 startServer(config, cacheManager, pool, bot, cacheManagerSystem, dbManager);
@@ -88,6 +133,10 @@ int main(int argc, char* argv[]) {
         // 停止缓存管理线程
         cacheManagerSystem.stopCleanupThread();
 
+        // 未完成的 Telegram 请求以失败结束（机器人回复不再发送）
+        TelegramScheduler::getInstance().shutdown();
+        UpstreamEngine::getInstance().shutdown();
+
     } catch (const std::system_error& e) {
         log(LogLevel::LOGERROR, "System error occurred in main: " + std::string(e.what()));
         return 1;
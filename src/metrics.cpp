@@ -0,0 +1,222 @@
+// metrics.cpp
+
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+// 转义标签值中的反斜杠、双引号和换行
+std::string escapeLabelValue(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string formatLabels(const MetricLabels& labels) {
+    if (labels.empty()) {
+        return "";
+    }
+    std::string formatted = "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i > 0) {
+            formatted += ",";
+        }
+        formatted += labels[i].first + "=\"" + escapeLabelValue(labels[i].second) + "\"";
+    }
+    return formatted + "}";
+}
+
+// 在已有标签后追加 le 标签（直方图桶）
+std::string appendLabel(const std::string& labels, const std::string& name, const std::string& value) {
+    std::string extra = name + "=\"" + value + "\"";
+    if (labels.empty()) {
+        return "{" + extra + "}";
+    }
+    return labels.substr(0, labels.size() - 1) + "," + extra + "}";
+}
+
+std::string formatNumber(double value) {
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    std::ostringstream out;
+    out.precision(12);
+    out << value;
+    return out.str();
+}
+
+}  // namespace
+
+// ---------------- Histogram ----------------
+
+Histogram::Histogram(std::vector<double> bounds)
+    : upperBounds(std::move(bounds)), buckets(new std::atomic<uint64_t>[upperBounds.size() + 1]) {
+    std::sort(upperBounds.begin(), upperBounds.end());
+    for (size_t i = 0; i <= upperBounds.size(); ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(double value) {
+    size_t index = std::lower_bound(upperBounds.begin(), upperBounds.end(), value) - upperBounds.begin();
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(static_cast<uint64_t>(std::llround(std::max(value, 0.0) * 1e6)), std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> Histogram::bucketCounts() const {
+    std::vector<uint64_t> counts(upperBounds.size() + 1);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+double Histogram::sum() const {
+    return static_cast<double>(sumMicros.load(std::memory_order_relaxed)) / 1e6;
+}
+
+uint64_t Histogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+std::vector<double> Histogram::latencyBuckets() {
+    return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0};
+}
+
+// ---------------- MetricsRegistry ----------------
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+MetricsRegistry::Series& MetricsRegistry::getOrCreateSeries(const std::string& name, const std::string& help, const std::string& type,
+                                                            const MetricLabels& labels) {
+    Family*& family = familyIndex[name];
+    if (family == nullptr) {
+        families.push_back(std::make_unique<Family>());
+        family = families.back().get();
+        family->name = name;
+        family->help = help;
+        family->type = type;
+    }
+
+    std::string formattedLabels = formatLabels(labels);
+    for (auto& series : family->series) {
+        if (series->labels == formattedLabels) {
+            return *series;
+        }
+    }
+    family->series.push_back(std::make_unique<Series>());
+    family->series.back()->labels = formattedLabels;
+    return *family->series.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Series& series = getOrCreateSeries(name, help, "counter", labels);
+    if (!series.counter) {
+        series.counter = std::make_unique<Counter>();
+    }
+    return *series.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Series& series = getOrCreateSeries(name, help, "gauge", labels);
+    if (!series.gauge) {
+        series.gauge = std::make_unique<Gauge>();
+    }
+    return *series.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const MetricLabels& labels,
+                                      const std::vector<double>& upperBounds) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Series& series = getOrCreateSeries(name, help, "histogram", labels);
+    if (!series.histogram) {
+        series.histogram = std::make_unique<Histogram>(upperBounds);
+    }
+    return *series.histogram;
+}
+
+void MetricsRegistry::callback(const std::string& name, const std::string& help, const std::string& type, const MetricLabels& labels,
+                               std::function<double()> valueFunction) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Series& series = getOrCreateSeries(name, help, type, labels);
+    series.valueFunction = std::move(valueFunction);
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::ostringstream out;
+
+    for (const auto& family : families) {
+        out << "# HELP " << family->name << " " << family->help << "\n";
+        out << "# TYPE " << family->name << " " << family->type << "\n";
+
+        for (const auto& series : family->series) {
+            if (series->counter) {
+                out << family->name << series->labels << " " << series->counter->get() << "\n";
+            } else if (series->gauge) {
+                out << family->name << series->labels << " " << series->gauge->get() << "\n";
+            } else if (series->valueFunction) {
+                out << family->name << series->labels << " " << formatNumber(series->valueFunction()) << "\n";
+            } else if (series->histogram) {
+                const Histogram& histogram = *series->histogram;
+                std::vector<uint64_t> counts = histogram.bucketCounts();
+                const std::vector<double>& bounds = histogram.getUpperBounds();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    cumulative += counts[i];
+                    std::string le = i < bounds.size() ? formatNumber(bounds[i]) : "+Inf";
+                    out << family->name << "_bucket" << appendLabel(series->labels, "le", le) << " " << cumulative << "\n";
+                }
+                out << family->name << "_sum" << series->labels << " " << formatNumber(histogram.sum()) << "\n";
+                out << family->name << "_count" << series->labels << " " << cumulative << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+// ---------------- RouteMetrics ----------------
+
+RouteMetrics::RouteMetrics(const std::string& route) {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    const char* statusClasses[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+    for (int i = 0; i < 5; ++i) {
+        responses[i] = &registry.counter("http_requests_total", "HTTP requests handled, by route and status class",
+                                         {{"route", route}, {"status", statusClasses[i]}});
+    }
+    duration = &registry.histogram("http_request_duration_seconds", "Time spent handling HTTP requests", {{"route", route}});
+    bytesServed = &registry.counter("http_response_bytes_total", "Response body bytes served", {{"route", route}});
+}
+
+void RouteMetrics::observe(int status, double durationSeconds, size_t bytes) {
+    int statusClass = std::min(std::max(status / 100, 1), 5) - 1;
+    responses[statusClass]->inc();
+    duration->observe(durationSeconds);
+    bytesServed->inc(bytes);
+}
+
+// ---------------- CacheTierMetrics ----------------
+
+CacheTierMetrics::CacheTierMetrics(const std::string& tier) {
+    MetricsRegistry& registry = MetricsRegistry::getInstance();
+    hits = &registry.counter("cache_requests_total", "Cache lookups, by tier and result", {{"tier", tier}, {"result", "hit"}});
+    misses = &registry.counter("cache_requests_total", "Cache lookups, by tier and result", {{"tier", tier}, {"result", "miss"}});
+}
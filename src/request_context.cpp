@@ -0,0 +1,44 @@
+// request_context.cpp
+
+#include "request_context.h"
+
+namespace {
+
+thread_local RequestContext context;
+thread_local int64_t pendingQueueMicros = 0;
+
+// 同一线程可能嵌套获取连接，只统计最外层
+thread_local int dbDepth = 0;
+thread_local std::chrono::steady_clock::time_point dbAcquireStart;
+
+}  // namespace
+
+RequestContext& RequestContext::current() {
+    return context;
+}
+
+void RequestContext::begin(const std::chrono::steady_clock::time_point& now) {
+    receivedAt = now;
+    handledAt = now;
+    queueMicros = pendingQueueMicros;
+    pendingQueueMicros = 0;
+    dbMicros = 0;
+    upstreamMicros = 0;
+    cacheResult = "none";
+}
+
+void setConnectionQueueMicros(int64_t micros) {
+    pendingQueueMicros = micros;
+}
+
+void markDbAcquireStart() {
+    if (dbDepth++ == 0) {
+        dbAcquireStart = std::chrono::steady_clock::now();
+    }
+}
+
+void markDbReleased() {
+    if (dbDepth > 0 && --dbDepth == 0) {
+        context.dbMicros += elapsedMicros(dbAcquireStart, std::chrono::steady_clock::now());
+    }
+}
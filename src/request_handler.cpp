@@ -3,13 +3,67 @@
 #include "utils.h"
 #include "config.h"
 #include "db_manager.h"
+#include "request_context.h"
+#include "tracing.h"
+#include "upstream_engine.h"
+#include "telegram_scheduler.h"
+#include "compression.h"
+#include "metrics.h"
 #include <nlohmann/json.hpp>
 #include <regex>
 #include <curl/curl.h>
 #include <algorithm>
+#include <cstdio>
 #include <future>
+#include <chrono>
 #include <sstream>
 
+namespace {
+
+// handleImageRequest 各阶段的追踪点
+const SpanName kShortIdLookupSpan("short_id_lookup");
+const SpanName kMemoryCacheLookupSpan("memory_cache_lookup");
+const SpanName kDiskCacheReadSpan("disk_cache_read");
+const SpanName kDiskCacheWriteSpan("disk_cache_write");
+const SpanName kTelegramGetFileSpan("telegram_get_file");
+const SpanName kTelegramDownloadSpan("telegram_download");
+const SpanName kTelegramStreamSpan("telegram_stream");
+const SpanName kCompressSpan("compress");
+
+// 上游请求失败时的状态码：熔断器断开时返回 503（配合 Retry-After），否则 500
+int upstreamFailureStatus() {
+    return getTelegramCircuitBreaker().getState() == CircuitBreaker::State::Closed ? 500 : 503;
+}
+
+void setRetryAfterHeader(httplib::Response& res) {
+    if (res.status == 503) {
+        res.set_header("Retry-After", std::to_string(getTelegramCircuitBreaker().getRetryAfterSeconds()));
+    }
+}
+
+// 压缩响应的来源：memory_hit / disk_hit 表示使用了缓存的压缩结果，compressed 表示本次压缩
+Counter& compressionResults(const char* result) {
+    return MetricsRegistry::getInstance().counter(
+        "response_compression_total", "Compressed media responses, by where the encoded variant came from", {{"result", result}});
+}
+
+Counter& compressionMemoryHits() {
+    static Counter& counter = compressionResults("memory_hit");
+    return counter;
+}
+
+Counter& compressionDiskHits() {
+    static Counter& counter = compressionResults("disk_hit");
+    return counter;
+}
+
+Counter& compressionMisses() {
+    static Counter& counter = compressionResults("compressed");
+    return counter;
+}
+
+}  // namespace
+
 std::string getMimeType(const std::string& filePath, const std::map<std::string, std::string>& mimeTypes, const std::string& defaultMimeType = "application/octet-stream") {
     try {
         // 查找文件扩展名
@@ -55,40 +109,40 @@ size_t streamWriteCallback(void* ptr, size_t size, size_t nmemb, httplib::Respon
 }
 
 void handleStreamRequest(const httplib::Request& req, httplib::Response& res, const std::string& fileDownloadUrl, const std::string& mimeType) {
-    CURL* curl = curl_easy_init();
+    PooledCurlHandle curl;  // 复用到 Telegram 的连接
     if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, fileDownloadUrl.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_URL, fileDownloadUrl.c_str());
 
         // 启用 HTTP Keep-Alive
-        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
-        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 120L);
-        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 60L);
+        curl_easy_setopt(curl.get(), CURLOPT_TCP_KEEPIDLE, 120L);
+        curl_easy_setopt(curl.get(), CURLOPT_TCP_KEEPINTVL, 60L);
 
         // 增加缓冲区大小
-        curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 102400L);
+        curl_easy_setopt(curl.get(), CURLOPT_BUFFERSIZE, 102400L);
 
         // 设置请求超时
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+        curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, 30L);
 
         // 设置分块传输
         // res.set_header("Transfer-Encoding", "chunked");
 
         // 设置回调函数，流式传输数据
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, streamWriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &res);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, streamWriteCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &res);
 
-        // 执行请求
-        curl_easy_perform(curl);
-
-        // 清理 curl 资源
-        curl_easy_cleanup(curl);
+        // 执行请求；熔断器断开时立即失败，不再等到超时
+        if (performUpstreamRequest(curl.get()) != CURLE_OK && res.body.empty()) {
+            res.status = upstreamFailureStatus();
+            setRetryAfterHeader(res);
+            res.set_content("Failed to download file from Telegram", "text/plain");
+            return;
+        }
     }
     
     res.set_header("Content-Type", mimeType);
     res.set_header("Accept-Ranges", "bytes");  // 支持分段下载
 }
-void handleImageRequest(const httplib::Request& req, httplib::Response& res, const std::string& apiToken, const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager, CacheManager& memoryCache, const std::string& telegramApiUrl, const Config& config, DBManager& dbManager) {
+void handleImageRequest(const httplib::Request& req, httplib::Response& res, const std::string& apiToken, const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager, CacheManager& memoryCache, const std::string& telegramApiUrl, const Config& config, DBManager& dbManager, ThreadPool& backgroundPool) {
     if (req.matches.size() < 2) {
         res.status = 400;
         res.set_content("Bad Request", "text/plain");
@@ -96,67 +150,78 @@ void handleImageRequest(const httplib::Request& req, httplib::Response& res, con
         return;
     }
 
-    std::string shortId = req.matches[1];
-    std::string fileId = (shortId.length() > 6) ? shortId : dbManager.getFileIdByShortId(shortId);
-
-    // 验证 fileId 的合法性
-    std::regex fileIdRegex("^[A-Za-z0-9_-]+$");
-    if (!std::regex_match(fileId, fileIdRegex)) {
+    std::string fileId = resolveFileId(req.matches[1], dbManager);
+    if (fileId.empty()) {
         res.status = 400;
         res.set_content("Invalid File ID", "text/plain");
-        log(LogLevel::LOGERROR, "Invalid file ID received: " + fileId);
         return;
     }
 
-    log(LogLevel::INFO, "Checking file path from memory cache for file ID: " + fileId);
+    LOG(LogLevel::DEBUG, "Checking file path from memory cache for file ID: " + fileId);
 
-    // Step 1: 从 memoryCache 中获取 filePath 是否存在
+    // Step 1: 从 memoryCache 中获取 filePath 是否存在（已过期但在宽限期内的路径也返回）
     std::string cachedFilePath;
-    bool isMemoryCacheHit = memoryCache.getFilePathCache(fileId, cachedFilePath);
+    CacheLookup lookup;
+    {
+        ScopedSpan span(kMemoryCacheLookupSpan);
+        lookup = memoryCache.lookupFilePathCache(fileId, cachedFilePath);
+    }
+    bool isMemoryCacheHit = lookup != CacheLookup::Miss;
+    RequestContext::current().cacheResult = lookup == CacheLookup::Fresh ? "memory_hit" : lookup == CacheLookup::Stale ? "stale" : "miss";
 
     // 获取文件的扩展名，默认为空字符串
     std::string preferredExtension = (req.has_header("Accept") && req.get_header_value("Accept").find("image/webp") != std::string::npos) ? "webp" : getFileExtension(cachedFilePath);
 
     // 如果 memory 缓存命中，检查 image 缓存（磁盘）是否命中
     if (isMemoryCacheHit) {
-        log(LogLevel::INFO, "Memory cache hit for file ID: " + fileId + ". Checking image cache.");
-        std::string cachedImageData = cacheManager.getCachedImage(fileId, preferredExtension);
+        LOG(LogLevel::DEBUG, "Memory cache hit for file ID: " + fileId + ". Checking image cache.");
+        std::string cachedImageData;
+        {
+            ScopedSpan span(kDiskCacheReadSpan);
+            cachedImageData = cacheManager.getCachedImage(fileId, preferredExtension);
+        }
 
         if (!cachedImageData.empty()) {
-            log(LogLevel::INFO, "Image cache hit for file ID: " + fileId);
+            LOG(LogLevel::DEBUG, "Image cache hit for file ID: " + fileId);
+            // 路径已过期时先用磁盘缓存响应，后台刷新路径（stale-while-revalidate）
+            if (lookup == CacheLookup::Stale) {
+                revalidateTelegramFilePath(fileId, apiToken, telegramApiUrl, memoryCache);
+            }
+            RequestContext::current().cacheResult = "disk_hit";
             // 获取文件的 MIME 类型
             std::string mimeType = getMimeType(cachedFilePath, mimeTypes);
             // 返回缓存的文件数据
-            setHttpResponse(res, cachedImageData, mimeType, req);
+            setHttpResponse(res, cachedImageData, mimeType, req, fileId, preferredExtension, config, cacheManager, memoryCache, backgroundPool);
             return;
         } else {
-            log(LogLevel::INFO, "Image cache miss for file ID: " + fileId + ". Downloading from Telegram.");
+            LOG(LogLevel::DEBUG, "Image cache miss for file ID: " + fileId + ". Downloading from Telegram.");
         }
-    } else {
-        log(LogLevel::INFO, "Memory cache miss. Requesting file information from Telegram for file ID: " + fileId);
-
-        // 如果 memoryCache 中没有 filePath，调用 getFile 接口获取文件路径
-        std::string telegramFileUrl = telegramApiUrl + "/bot" + apiToken + "/getFile?file_id=" + fileId;
-        std::string fileResponse = sendHttpRequest(telegramFileUrl);
 
-        if (fileResponse.empty()) {
-            res.status = 500;
-            res.set_content("Failed to get file information from Telegram", "text/plain");
-            log(LogLevel::LOGERROR, "Failed to retrieve file information from Telegram.");
-            return;
+        // 路径已过期且磁盘未命中：先刷新路径，刷新失败（不是 404）时沿用旧路径下载（stale-if-error）
+        if (lookup == CacheLookup::Stale) {
+            std::string refreshedPath;
+            std::string errorMessage;
+            int status = fetchTelegramFilePath(fileId, apiToken, telegramApiUrl, memoryCache, refreshedPath, errorMessage);
+            if (status == 200) {
+                cachedFilePath = refreshedPath;
+            } else if (status == 404) {
+                res.status = status;
+                res.set_content(errorMessage, "text/plain");
+                return;
+            } else {
+                log(LogLevel::WARNING, "Using stale file path for ID: " + fileId);
+            }
         }
+    } else {
+        LOG(LogLevel::DEBUG, "Memory cache miss. Requesting file information from Telegram for file ID: " + fileId);
 
-        nlohmann::json jsonResponse = nlohmann::json::parse(fileResponse);
-        if (jsonResponse.contains("result") && jsonResponse["result"].contains("file_path")) {
-            cachedFilePath = jsonResponse["result"]["file_path"];
-            log(LogLevel::INFO, "Retrieved file path: " + cachedFilePath);
-
-            // 将 filePath 存入 memoryCache
-            memoryCache.addFilePathCache(fileId, cachedFilePath, 3600);
-        } else {
-            res.status = 404;
-            res.set_content("File Not Found", "text/plain");
-            log(LogLevel::LOGERROR, "File not found in Telegram for ID: " + fileId);
+        // 如果 memoryCache 中没有 filePath，调用 getFile 接口获取文件路径
+        std::string errorMessage;
+        int status = fetchTelegramFilePath(fileId, apiToken, telegramApiUrl, memoryCache, cachedFilePath, errorMessage);
+        if (status != 200) {
+            res.status = status;
+            setRetryAfterHeader(res);
+            res.set_content(errorMessage, "text/plain");
             return;
         }
     }
@@ -164,44 +229,297 @@ void handleImageRequest(const httplib::Request& req, httplib::Response& res, con
     // 获取文件 MIME 类型
     std::string mimeType = getMimeType(cachedFilePath, mimeTypes);
 
-    // 如果文件是视频或文档，直接流式传输而不缓存
-    if (mimeType.find("video") != std::string::npos || mimeType.find("application") != std::string::npos) {
-        log(LogLevel::INFO, "Streaming file directly from Telegram (no caching) for MIME type: " + mimeType);
+    // 如果文件是视频或文档，直接流式传输而不缓存；JSON、XML 等可压缩的 application 类型走缓存路径，由 setHttpResponse 压缩
+    bool compressible = config.getCompressionEnabled() && isCompressibleMimeType(mimeType, config.getCompressionTypes());
+    if (!compressible && (mimeType.find("video") != std::string::npos || mimeType.find("application") != std::string::npos)) {
+        LOG(LogLevel::DEBUG, "Streaming file directly from Telegram (no caching) for MIME type: " + mimeType);
         std::string telegramFileDownloadUrl = telegramApiUrl + "/file/bot" + apiToken + "/" + cachedFilePath;
+        ScopedSpan span(kTelegramStreamSpan);
         handleStreamRequest(req, res, telegramFileDownloadUrl, mimeType);
         return;
     }
 
     // 从 Telegram 下载文件
     std::string telegramFileDownloadUrl = telegramApiUrl + "/file/bot" + apiToken + "/" + cachedFilePath;
-    std::string fileData = sendHttpRequest(telegramFileDownloadUrl);
+    std::string fileData;
+    {
+        ScopedSpan span(kTelegramDownloadSpan);
+        fileData = sendHttpRequest(telegramFileDownloadUrl);
+    }
 
     if (fileData.empty()) {
-        res.status = 500;
+        res.status = upstreamFailureStatus();
+        setRetryAfterHeader(res);
         res.set_content("Failed to download file from Telegram", "text/plain");
         log(LogLevel::LOGERROR, "Failed to download file from Telegram for file path: " + cachedFilePath);
         return;
     }
 
-    std::future<void> cacheFuture = std::async(std::launch::async, [&cacheManager, fileId, fileData, preferredExtension]() {
+    // 写磁盘缓存交给后台线程池的低优先级队列，不阻塞当前请求（原来的 std::async 会在 future 析构时等待写完）
+    backgroundPool.enqueueWithPriority(TaskPriority::Low, [&cacheManager, fileId, fileData, preferredExtension]() {
+        ScopedSpan span(kDiskCacheWriteSpan);
         cacheManager.cacheImage(fileId, fileData, preferredExtension);
     });
 
     // 返回文件
-    setHttpResponse(res, fileData, mimeType, req);
-    log(LogLevel::INFO, "Successfully served and cached file for file ID: " + fileId);
+    setHttpResponse(res, fileData, mimeType, req, fileId, preferredExtension, config, cacheManager, memoryCache, backgroundPool);
+    LOG(LogLevel::DEBUG, "Successfully served and cached file for file ID: " + fileId);
 }
 
-void setHttpResponse(httplib::Response& res, const std::string& fileData, const std::string& mimeType, const httplib::Request& req) {
+std::string resolveFileId(const std::string& shortId, DBManager& dbManager) {
+    std::string fileId = shortId;
+    if (shortId.length() <= 6) {
+        ScopedSpan span(kShortIdLookupSpan);
+        fileId = dbManager.getFileIdByShortId(shortId);
+    }
+
+    // 验证 fileId 的合法性
+    static const std::regex fileIdRegex("^[A-Za-z0-9_-]+$");
+    if (!std::regex_match(fileId, fileIdRegex)) {
+        log(LogLevel::LOGERROR, "Invalid file ID received: " + fileId);
+        return "";
+    }
+    return fileId;
+}
+
+namespace {
+
+// 解析 getFile 的响应，成功时写入内存缓存
+int parseTelegramFilePath(const std::string& fileId, const HttpResponse& response, CacheManager& memoryCache,
+                          std::string& filePath, std::string& errorMessage) {
+    if (!response.ok || response.body.empty()) {
+        errorMessage = "Failed to get file information from Telegram";
+        log(LogLevel::LOGERROR, "Failed to retrieve file information from Telegram.");
+        return upstreamFailureStatus();
+    }
+
+    nlohmann::json jsonResponse = nlohmann::json::parse(response.body, nullptr, false);
+    if (jsonResponse.is_discarded()) {
+        errorMessage = "Failed to get file information from Telegram";
+        log(LogLevel::LOGERROR, "Invalid getFile response from Telegram for ID: " + fileId);
+        return 500;
+    }
+    if (jsonResponse.contains("result") && jsonResponse["result"].contains("file_path")) {
+        filePath = jsonResponse["result"]["file_path"];
+        LOG(LogLevel::DEBUG, "Retrieved file path: " + filePath);
+
+        // 将 filePath 存入 memoryCache
+        memoryCache.addFilePathCache(fileId, filePath, 3600);
+        return 200;
+    }
+
+    errorMessage = "File Not Found";
+    log(LogLevel::LOGERROR, "File not found in Telegram for ID: " + fileId);
+    return 404;
+}
+
+// resolveMediaFile 的异步下载部分：通过 UpstreamEngine 把文件下载到缓存目录中的临时文件，
+// 完成后交出文件描述符用 sendfile 发送，慢速客户端不会让整个文件留在内存中；done 在引擎线程中调用
+void downloadMediaFile(MediaFile result, const std::string& fileId, const std::string& filePath, const std::string& preferredExtension,
+                       const std::string& apiToken, const std::string& telegramApiUrl, ImageCacheManager& cacheManager,
+                       ThreadPool& backgroundPool, MediaCallback done) {
+    UpstreamRequest request;
+    request.url = telegramApiUrl + "/file/bot" + apiToken + "/" + filePath;
+    std::string downloadPath = cacheManager.getDownloadPath(fileId);
+    request.outputPath = downloadPath;
+    auto submittedAt = std::chrono::steady_clock::now();
+    UpstreamEngine::getInstance().submit(std::move(request),
+        [result = std::move(result), fileId, filePath, downloadPath, preferredExtension, &cacheManager,
+         &backgroundPool, done = std::move(done), submittedAt](HttpResponse&& response) mutable {
+            auto finishedAt = std::chrono::steady_clock::now();
+            recordSpan(kTelegramDownloadSpan, submittedAt, finishedAt);
+            result.upstreamMicros += elapsedMicros(submittedAt, finishedAt);
+
+            // 非 2xx 时写入的是 Telegram 的错误信息，不能当作文件内容
+            if (!response.ok || response.status < 200 || response.status >= 300) {
+                std::remove(downloadPath.c_str());
+                result.status = upstreamFailureStatus();
+                result.errorMessage = "Failed to download file from Telegram";
+                log(LogLevel::LOGERROR, "Failed to download file from Telegram for file path: " + filePath);
+                done(std::move(result));
+                return;
+            }
+
+            // 视频和文档不缓存，与 handleImageRequest 的策略一致：打开后即删除临时文件；
+            // 其余文件直接改名为缓存文件，检查磁盘上限需要扫描目录，交给后台线程池
+            bool keep = result.contentType.find("video") == std::string::npos && result.contentType.find("application") == std::string::npos;
+            {
+                ScopedSpan span(kDiskCacheWriteSpan);
+                result.fileFd = cacheManager.openDownloadedFile(downloadPath, fileId, preferredExtension, keep, result.fileSize);
+            }
+            if (result.fileFd < 0) {
+                result.status = upstreamFailureStatus();
+                result.errorMessage = "Failed to download file from Telegram";
+                done(std::move(result));
+                return;
+            }
+            result.status = 200;
+            if (keep) {
+                backgroundPool.enqueueWithPriority(TaskPriority::Low, [&cacheManager]() { cacheManager.enforceDiskLimit(); });
+            }
+            done(std::move(result));
+        });
+}
+
+}  // namespace
+
+int fetchTelegramFilePath(const std::string& fileId, const std::string& apiToken, const std::string& telegramApiUrl,
+                          CacheManager& memoryCache, std::string& filePath, std::string& errorMessage) {
+    UpstreamRequest request;
+    request.url = telegramApiUrl + "/bot" + apiToken + "/getFile?file_id=" + fileId;
+    HttpResponse response;
+    {
+        // 经过 TelegramScheduler，429 和临时失败会短暂重试
+        ScopedSpan span(kTelegramGetFileSpan);
+        response = TelegramScheduler::getInstance().call(std::move(request)).get();
+    }
+    return parseTelegramFilePath(fileId, response, memoryCache, filePath, errorMessage);
+}
+
+void revalidateTelegramFilePath(const std::string& fileId, const std::string& apiToken, const std::string& telegramApiUrl,
+                                CacheManager& memoryCache) {
+    UpstreamRequest request;
+    request.url = telegramApiUrl + "/bot" + apiToken + "/getFile?file_id=" + fileId;
+    TelegramScheduler::getInstance().call(std::move(request), [fileId, &memoryCache](HttpResponse&& response) {
+        // 失败时保留旧值（stale-if-error），宽限期内的下一个请求会再次刷新
+        std::string filePath;
+        std::string errorMessage;
+        parseTelegramFilePath(fileId, response, memoryCache, filePath, errorMessage);
+    });
+}
+
+void resolveMediaFile(const std::string& shortId, bool acceptsWebp, const std::string& apiToken,
+                      const std::map<std::string, std::string>& mimeTypes, ImageCacheManager& cacheManager,
+                      CacheManager& memoryCache, const std::string& telegramApiUrl, DBManager& dbManager,
+                      ThreadPool& backgroundPool, MediaCallback done) {
+    MediaFile result;
+    int64_t dbMicrosBefore = RequestContext::current().dbMicros;
+    std::string fileId = resolveFileId(shortId, dbManager);
+    result.dbMicros = RequestContext::current().dbMicros - dbMicrosBefore;
+    if (fileId.empty()) {
+        result.status = 400;
+        result.errorMessage = "Invalid File ID";
+        done(std::move(result));
+        return;
+    }
+
+    std::string cachedFilePath;
+    CacheLookup lookup;
+    {
+        ScopedSpan span(kMemoryCacheLookupSpan);
+        lookup = memoryCache.lookupFilePathCache(fileId, cachedFilePath);
+    }
+    result.cacheResult = lookup == CacheLookup::Fresh ? "memory_hit" : lookup == CacheLookup::Stale ? "stale" : "miss";
+
+    // 与 handleImageRequest 相同：内存缓存命中时才检查磁盘缓存，命中则直接交出文件描述符
+    if (lookup != CacheLookup::Miss) {
+        std::string preferredExtension = acceptsWebp ? "webp" : getFileExtension(cachedFilePath);
+        int fd;
+        {
+            ScopedSpan span(kDiskCacheReadSpan);
+            fd = cacheManager.openCachedImage(fileId, preferredExtension, result.fileSize);
+        }
+        result.contentType = getMimeType(cachedFilePath, mimeTypes);
+        if (fd >= 0) {
+            // 路径已过期时先用磁盘缓存响应，后台刷新路径（stale-while-revalidate）
+            if (lookup == CacheLookup::Stale) {
+                revalidateTelegramFilePath(fileId, apiToken, telegramApiUrl, memoryCache);
+            }
+            result.cacheResult = "disk_hit";
+            result.status = 200;
+            result.fileFd = fd;
+            done(std::move(result));
+            return;
+        }
+        if (lookup == CacheLookup::Fresh) {
+            downloadMediaFile(std::move(result), fileId, cachedFilePath, preferredExtension, apiToken, telegramApiUrl,
+                              cacheManager, backgroundPool, std::move(done));
+            return;
+        }
+    }
+
+    // getFile 和下载都交给 UpstreamEngine，等待 Telegram 期间不占用工作线程；getFile 经过 TelegramScheduler 重试
+    // 路径已过期且磁盘未命中时也先刷新路径，刷新失败（不是 404）则沿用旧路径下载（stale-if-error）
+    UpstreamRequest request;
+    request.url = telegramApiUrl + "/bot" + apiToken + "/getFile?file_id=" + fileId;
+    auto submittedAt = std::chrono::steady_clock::now();
+    TelegramScheduler::getInstance().call(std::move(request),
+        [result = std::move(result), fileId, stalePath = cachedFilePath, acceptsWebp, apiToken, &mimeTypes, &cacheManager, &memoryCache,
+         telegramApiUrl, &backgroundPool, done = std::move(done), submittedAt](HttpResponse&& response) mutable {
+            auto finishedAt = std::chrono::steady_clock::now();
+            recordSpan(kTelegramGetFileSpan, submittedAt, finishedAt);
+            result.upstreamMicros += elapsedMicros(submittedAt, finishedAt);
+
+            std::string filePath;
+            result.status = parseTelegramFilePath(fileId, response, memoryCache, filePath, result.errorMessage);
+            if (result.status != 200) {
+                if (stalePath.empty() || result.status == 404) {
+                    done(std::move(result));
+                    return;
+                }
+                log(LogLevel::WARNING, "Using stale file path for ID: " + fileId);
+                filePath = stalePath;
+                result.errorMessage.clear();
+            }
+            result.contentType = getMimeType(filePath, mimeTypes);
+            std::string preferredExtension = acceptsWebp ? "webp" : getFileExtension(filePath);
+            downloadMediaFile(std::move(result), fileId, filePath, preferredExtension, apiToken, telegramApiUrl,
+                              cacheManager, backgroundPool, std::move(done));
+        });
+}
+
+void setHttpResponse(httplib::Response& res, const std::string& fileData, const std::string& mimeType, const httplib::Request& req,
+                     const std::string& fileId, const std::string& extension, const Config& config,
+                     ImageCacheManager& cacheManager, CacheManager& memoryCache, ThreadPool& backgroundPool) {
     res.set_header("Cache-Control", "max-age=3600");
 
-    // 对小文件启用压缩以节省内存占用
-    if (fileData.size() < 1048576 && req.has_header("Accept-Encoding") && req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos) {
-        res.set_content(gzipCompress(fileData), mimeType);
-        res.set_header("Content-Encoding", "gzip");
-    } else {
+    // 只压缩文本类内容：JPEG/PNG/WebP 等已压缩格式每次 gzip 都耗费大量 CPU 却几乎不减小体积
+    if (!config.getCompressionEnabled() || !isCompressibleMimeType(mimeType, config.getCompressionTypes())) {
         res.set_content(fileData, mimeType);
+        return;
+    }
+    res.set_header("Vary", "Accept-Encoding");
+    ContentEncoding encoding = negotiateContentEncoding(req.get_header_value("Accept-Encoding"));
+    if (encoding == ContentEncoding::Identity ||
+        fileData.size() < static_cast<size_t>(std::max(0, config.getCompressionMinSizeBytes())) ||
+        fileData.size() > static_cast<size_t>(std::max(0, config.getCompressionMaxSizeBytes()))) {
+        res.set_content(fileData, mimeType);
+        return;
+    }
+
+    // 压缩结果按 (fileId, 扩展名, 编码) 缓存在内存和磁盘中，同一个对象每种编码只压缩一次
+    std::string variantExtension = extension + contentEncodingSuffix(encoding);
+    std::string variantKey = "encoded:" + fileId + variantExtension;
+    std::string compressed;
+    if (memoryCache.getCache(variantKey, compressed)) {
+        compressionMemoryHits().inc();
+    } else {
+        {
+            ScopedSpan span(kDiskCacheReadSpan);
+            compressed = cacheManager.getCachedImage(fileId, variantExtension);
+        }
+        if (!compressed.empty()) {
+            compressionDiskHits().inc();
+        } else {
+            try {
+                ScopedSpan span(kCompressSpan);
+                compressed = compressContent(fileData, encoding);
+            } catch (const std::exception& e) {
+                log(LogLevel::LOGERROR, "Failed to compress response for file ID " + fileId + ": " + e.what());
+                res.set_content(fileData, mimeType);
+                return;
+            }
+            compressionMisses().inc();
+            backgroundPool.enqueueWithPriority(TaskPriority::Low, [&cacheManager, fileId, compressed, variantExtension]() {
+                ScopedSpan span(kDiskCacheWriteSpan);
+                cacheManager.cacheImage(fileId, compressed, variantExtension);
+            });
+        }
+        memoryCache.addCache(variantKey, compressed, config.getCacheMaxAgeSeconds());
     }
+
+    res.set_content(std::move(compressed), mimeType);
+    res.set_header("Content-Encoding", contentEncodingName(encoding));
 }
 
 std::string getBaseUrl(const std::string& url) {
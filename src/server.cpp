@@ -9,6 +9,13 @@
 #include "StatisticsManager.h"
 #include "http_client.h"
 #include "PicGoHandler.h"
+#include "metrics.h"
+#include "access_log.h"
+#include "request_context.h"
+#include "tracing.h"
+#include "event_server.h"
+#include "upstream_engine.h"
+#include "telegram_scheduler.h"
 #include <memory>
 #include <fstream>
 #include <vector>
@@ -18,8 +25,100 @@
 #include <algorithm>
 #include <regex>
 #include <future>
+#include <cstring>
+#include <thread>
 #include <nlohmann/json.hpp>
 
+namespace {
+
+// 包装 httplib 的线程池，记录每个连接在队列中等待的时间
+class TimedTaskQueue : public httplib::TaskQueue {
+public:
+    TimedTaskQueue(size_t threads, size_t maxQueued) : workers(threads, maxQueued) {}
+
+    bool enqueue(std::function<void()> fn) override {
+        auto queuedAt = std::chrono::steady_clock::now();
+        return workers.enqueue([fn = std::move(fn), queuedAt]() {
+            setConnectionQueueMicros(elapsedMicros(queuedAt, std::chrono::steady_clock::now()));
+            fn();
+        });
+    }
+
+    void shutdown() override {
+        workers.shutdown();
+    }
+
+private:
+    httplib::ThreadPool workers;
+};
+
+// 请求处理各阶段的追踪点（handleImageRequest 内部的阶段见 request_handler.cpp）
+const SpanName kQueueSpan("queue");
+const SpanName kRateLimitSpan("rate_limit");
+const SpanName kRefererCheckSpan("referer_check");
+const SpanName kHandlerSpan("handler");
+const SpanName kSendSpan("send");
+
+const char* const kMediaPrefixes[] = {"/images/", "/files/", "/videos/", "/audios/", "/stickers/", "/d/"};
+
+// 限流和 Referer 检查，通过时返回 0，否则返回应答的状态码（429 / 403）
+int checkMediaAccess(const Config& config, CacheManager& rateLimiter, const std::string& clientIp, const std::string& referer) {
+    LOG(LogLevel::DEBUG, "Request referer:  " + referer +", clientIP: " + clientIp);
+
+    // 进行限流检查
+    int maxRequestsPerMinute = config.getRateLimitRequestsPerMinute();
+    bool withinRateLimit;
+    {
+        ScopedSpan span(kRateLimitSpan);
+        withinRateLimit = rateLimiter.checkRateLimit(clientIp, maxRequestsPerMinute);
+    }
+    if (!withinRateLimit) {
+        return 429;
+    }
+
+    if (config.enableReferers()) {
+        if (referer.empty()) {
+            return 403;
+        }
+
+        // 获取允许的 Referer 列表
+        std::vector<std::string> allowedReferers = config.getAllowedReferers();
+        std::unordered_set<std::string> allowedReferersSet(allowedReferers.begin(), allowedReferers.end());
+
+        // 检查 Referer 是否在允许的列表中
+        bool refererAllowed;
+        {
+            ScopedSpan span(kRefererCheckSpan);
+            refererAllowed = rateLimiter.checkReferer(referer, allowedReferersSet);
+        }
+        if (!refererAllowed) {
+            return 403;
+        }
+    }
+    return 0;
+}
+
+void recordRequestStatistics(StatisticsManager& statisticsManager, const std::string& clientIp, const std::string& requestPath,
+                             const std::string& method, int statusCode, size_t responseSize, size_t requestSize,
+                             int responseTime, int requestLatency, int concurrentRequests) {
+    RequestRecord record;
+    record.clientIp = clientIp;
+    record.requestPath = requestPath;
+    record.httpMethod = method;
+    record.fileType = determineFileType(requestPath);            // 根据请求路径确定文件类型
+    record.responseTime = responseTime;
+    record.statusCode = statusCode;
+    record.responseSize = static_cast<int>(responseSize);
+    record.requestSize = static_cast<int>(requestSize);
+    record.requestLatency = requestLatency;
+    record.concurrentRequests = concurrentRequests;
+    record.requestTime = std::chrono::system_clock::now();
+
+    statisticsManager.recordRequest(std::move(record));
+}
+
+}  // namespace
+
 // 获取客户端真实 IP 地址
 std::string getClientIp(const httplib::Request& req) {
     if (req.has_header("X-Forwarded-For")) {
@@ -38,7 +137,7 @@ std::string getClientIp(const httplib::Request& req) {
 
 void handleMediaRequestWithTiming(const httplib::Request& req, httplib::Response& res, const Config& config, CacheManager& cacheManager,
                                   const std::function<void(const httplib::Request&, httplib::Response&)>& handler,
-                                  StatisticsManager& statisticsManager, ThreadPool& pool, int requestLatency) {
+                                  StatisticsManager& statisticsManager, int requestLatency, int concurrentRequests) {
     // 记录开始处理请求的时间
     auto startProcessingTime = std::chrono::steady_clock::now();
 
@@ -52,52 +151,14 @@ void handleMediaRequestWithTiming(const httplib::Request& req, httplib::Response
     int responseTime = std::chrono::duration_cast<std::chrono::milliseconds>(endProcessingTime - startProcessingTime).count();
 
     // 调用统计函数
-    handleRequestStatistics(req, res, req.path, statisticsManager, pool, responseTime, requestLatency);
+    handleRequestStatistics(req, res, req.path, statisticsManager, responseTime, requestLatency, concurrentRequests);
 }
 
-// 处理请求统计信息
+// 处理请求统计信息：只写入内存缓冲区，由 StatisticsManager 的后台线程批量落库
 void handleRequestStatistics(const httplib::Request& req, httplib::Response& res, const std::string& requestPath,
-                             StatisticsManager& statisticsManager, ThreadPool& pool, int responseTime, int requestLatency) {
-    // 获取客户端 IP 地址
-    std::string clientIp = getClientIp(req);
-
-    // 计算响应大小和请求大小
-    int responseSize = static_cast<int>(res.body.size());  // 响应的字节大小
-    int requestSize = static_cast<int>(req.body.size());   // 请求的字节大小
-
-    // 获取状态码
-    int statusCode = res.status;  // HTTP 响应状态码
-
-    // 获取请求方法
-    std::string httpMethod = req.method;
-
-    // 获取文件类型（根据请求路径确定）
-    std::string fileType = determineFileType(requestPath);
-
-    // 异步统计处理
-    pool.enqueue([=, &statisticsManager]() {
-        // 插入请求统计数据
-        statisticsManager.insertRequestStatistics(clientIp, requestPath, httpMethod, responseTime, statusCode,
-                                                  responseSize, requestSize, fileType, requestLatency);
-
-        // 更新服务使用统计数据
-        auto periodStart = std::chrono::system_clock::now();
-
-        // 以下统计数据需要根据实际情况计算，这里仅作为示例
-        int totalRequests = 1;  // 当前请求计数为 1
-        int successfulRequests = (statusCode >= 200 && statusCode < 300) ? 1 : 0;
-        int failedRequests = (statusCode >= 400) ? 1 : 0;
-        int totalRequestSize = requestSize;
-        int totalResponseSize = responseSize;
-        int uniqueIps = 1;  // 当前请求的 IP 数为 1
-        int maxConcurrentRequests = 1;  // 简化处理，实际应用中应计算并发请求数
-        int maxResponseTime = responseTime;
-        int avgResponseTime = responseTime;
-
-        statisticsManager.updateServiceUsage(periodStart, totalRequests, successfulRequests, failedRequests,
-                                             totalRequestSize, totalResponseSize, uniqueIps,
-                                             maxConcurrentRequests, maxResponseTime, avgResponseTime);
-    });
+                             StatisticsManager& statisticsManager, int responseTime, int requestLatency, int concurrentRequests) {
+    recordRequestStatistics(statisticsManager, getClientIp(req), requestPath, req.method, res.status, res.body.size(),
+                            req.body.size(), responseTime, requestLatency, concurrentRequests);
 }
 
 // 确定文件类型
@@ -140,8 +201,14 @@ std::string loadTemplate(const std::string& filepath) {
 }
 
 void startServer(const Config& config, ImageCacheManager& cacheManager, ThreadPool& pool, Bot& bot, CacheManager& rateLimiter, DBManager& dbManager) {
-    // 初始化统计管理器
-    StatisticsManager statisticsManager(dbManager);
+    // 初始化统计管理器（请求记录先进入内存缓冲区，由后台线程批量写入）
+    StatisticsRetention retention;
+    retention.rawDays = config.getStatisticsRawRetentionDays();
+    retention.minuteRollupDays = config.getStatisticsMinuteRollupRetentionDays();
+    retention.hourRollupDays = config.getStatisticsHourRollupRetentionDays();
+    retention.deleteBatchSize = config.getStatisticsRetentionBatchSize();
+    StatisticsManager statisticsManager(dbManager, config.getStatisticsBufferCapacity(), config.getStatisticsFlushIntervalMs(),
+                                        config.getStatisticsFlushBatchSize(), config.getStatisticsBucketSeconds(), retention);
 
     std::string apiToken = config.getApiToken();
     std::string hostname = config.getHostname();
@@ -154,194 +221,500 @@ void startServer(const Config& config, ImageCacheManager& cacheManager, ThreadPo
 
     PicGoHandler picGoHandler(config);
 
-    std::unique_ptr<httplib::Server> svr;
-    if (useHttps) {
-        std::string certPath = config.getSslCertificate();
-        std::string keyPath = config.getSslKey();
-        svr = std::make_unique<httplib::SSLServer>(certPath.c_str(), keyPath.c_str());
-    } else {
-        svr = std::make_unique<httplib::Server>();
+    // 按路由统计请求数、耗时和流量；表在 listen 之前建好，之后只读
+    std::map<std::string, std::unique_ptr<RouteMetrics>> routeMetrics;
+    for (const char* route : {"/images", "/files", "/videos", "/audios", "/stickers", "/d", "/upload", "/webhook",
+                              "/login", "/register", "/pic", "/", "/metrics", "other"}) {
+        routeMetrics[route] = std::make_unique<RouteMetrics>(route);
     }
 
-    auto mediaRequestHandler = [&apiToken, &mimeTypes, &cacheManager, &rateLimiter, &telegramApiUrl, &config, &dbManager](const httplib::Request& req, httplib::Response& res) {
-        handleImageRequest(req, res, apiToken, mimeTypes, cacheManager, rateLimiter, telegramApiUrl, config, dbManager);
-    };
+    MetricsRegistry& metricsRegistry = MetricsRegistry::getInstance();
+    metricsRegistry.callback("thread_pool_queue_depth", "Tasks waiting in the thread pool queue", "gauge", {},
+                             [&pool]() { return static_cast<double>(pool.getQueueDepth()); });
+    metricsRegistry.callback("thread_pool_threads", "Worker threads in the thread pool", "gauge", {},
+                             [&pool]() { return static_cast<double>(pool.getThreadCount()); });
+    for (TaskPriority priority : {TaskPriority::High, TaskPriority::Normal, TaskPriority::Low}) {
+        metricsRegistry.callback("thread_pool_lane_queue_depth", "Tasks waiting in each thread pool priority lane", "gauge",
+                                 {{"lane", taskPriorityName(priority)}},
+                                 [&pool, priority]() { return static_cast<double>(pool.getQueueDepth(priority)); });
+        metricsRegistry.callback("thread_pool_dropped_tasks_total", "Tasks dropped because their priority lane was full", "counter",
+                                 {{"lane", taskPriorityName(priority)}},
+                                 [&pool, priority]() { return static_cast<double>(pool.getDroppedTaskCount(priority)); });
+    }
+    metricsRegistry.callback("thread_pool_busy_threads", "Worker threads currently running a task", "gauge", {},
+                             [&pool]() { return static_cast<double>(pool.getBusyThreadCount()); });
+    metricsRegistry.callback("thread_pool_utilization", "Busy worker threads divided by current worker threads", "gauge", {},
+                             [&pool]() { return pool.getUtilization(); });
+    metricsRegistry.callback("statistics_dropped_records_total", "Request statistics dropped because the buffer was full or the database write failed", "counter", {},
+                             [&statisticsManager]() { return static_cast<double>(statisticsManager.getDroppedRecordCount()); });
+
+    AccessLogOptions accessLogOptions;
+    accessLogOptions.enabled = config.getAccessLogEnabled();
+    accessLogOptions.path = config.getAccessLogPath();
+    accessLogOptions.sampleRate = config.getAccessLogSampleRate();
+    accessLogOptions.slowRequestMs = config.getAccessLogSlowRequestMs();
+    accessLogOptions.maxFileBytes = static_cast<size_t>(config.getAccessLogMaxSizeMB()) * 1024 * 1024;
+    accessLogOptions.maxFiles = config.getAccessLogMaxFiles();
+    AccessLog accessLog(accessLogOptions);
+
+    // HTTP 连接由独立的工作线程处理，不与后台线程池共用；排队连接数超过上限时直接关闭新连接
+    size_t workerThreads = config.getServerWorkerThreads() > 0 ? static_cast<size_t>(config.getServerWorkerThreads())
+                                                               : static_cast<size_t>(CPPHTTPLIB_THREAD_POOL_COUNT);
+    size_t maxQueuedConnections = static_cast<size_t>(std::max(config.getServerMaxQueuedConnections(), 0));
+    int listenBacklog = std::max(config.getServerListenBacklog(), 1);
+
+    // 可选的 Chrome trace-event 记录，导出到 tracing.chrome_trace_path 或通过 /debug/trace 获取
+    if (config.getChromeTraceEnabled()) {
+        TraceRecorder::getInstance().enable(static_cast<size_t>(config.getChromeTraceMaxEvents()));
+    }
 
-    // 为路由设置通用的限流、Referer 验证和统计处理
-    auto registerMediaRoute = [&](const std::string& pattern) {
-        svr->Get(pattern, [&config, &rateLimiter, mediaRequestHandler, &statisticsManager, &pool](const httplib::Request& req, httplib::Response& res) {
-            // 记录请求到达时间
-            auto requestArrivalTime = std::chrono::steady_clock::now();
-
-            // 获取客户端 IP 地址
-            // std::string clientIp = req.remote_addr;
-            std::string clientIp;
-            if (req.has_header("X-Forwarded-For")) {
-                clientIp = req.get_header_value("X-Forwarded-For");
-            } else if (req.has_header("X-Real-IP")) {
-                clientIp = req.get_header_value("X-Real-IP");
-            } else {
-                clientIp = req.remote_addr;
+    // 多个监听实例（server.listeners）以 SO_REUSEPORT 绑定同一地址，由内核把新连接分散到各实例的 accept 循环，
+    // 每个实例有自己的工作线程（worker_threads 按实例计算）；路由处理函数共享同一组缓存、数据库连接池和统计
+    size_t listenerCount = static_cast<size_t>(std::max(config.getServerListeners(), 1));
+#ifdef _WIN32
+    if (listenerCount > 1) {
+        log(LogLevel::WARNING, "server.listeners > 1 requires SO_REUSEPORT, using a single listener");
+        listenerCount = 1;
+    }
+#endif
+    auto configureServer = [&](httplib::Server& server, socket_t& listenSocket) {
+        server.new_task_queue = [workerThreads, maxQueuedConnections] { return new TimedTaskQueue(workerThreads, maxQueuedConnections); };
+        server.set_keep_alive_max_count(static_cast<size_t>(std::max(config.getServerKeepAliveMaxCount(), 1)));
+        server.set_keep_alive_timeout(config.getServerKeepAliveTimeoutSeconds());
+        server.set_read_timeout(config.getServerReadTimeoutSeconds());
+        server.set_write_timeout(config.getServerWriteTimeoutSeconds());
+
+        // httplib 的 listen backlog 是编译期常量（5），绑定时记下监听套接字，之后按配置重新 listen 调整队列长度
+        server.set_socket_options([&listenSocket](socket_t sock) {
+            httplib::default_socket_options(sock);
+            listenSocket = sock;
+        });
+
+        server.set_pre_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+            RequestContext& context = RequestContext::current();
+            context.begin(std::chrono::steady_clock::now());
+            if (context.queueMicros > 0) {
+                recordSpan(kQueueSpan, context.receivedAt - std::chrono::microseconds(context.queueMicros), context.receivedAt);
             }
-            std::string referer = req.get_header_value("Referer");
-            log(LogLevel::INFO, "Request referer:  " + referer +", clientIP: " + clientIp);
-
-            // 进行限流检查
-            int maxRequestsPerMinute = config.getRateLimitRequestsPerMinute();
-            if (!rateLimiter.checkRateLimit(clientIp, maxRequestsPerMinute)) {
-                res.status = 429;
-                res.set_content("Too Many Requests", "text/plain");
-                return;
+            return httplib::Server::HandlerResponse::Unhandled;
+        });
+
+        server.set_post_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+            RequestContext& context = RequestContext::current();
+            context.handledAt = std::chrono::steady_clock::now();
+            recordSpan(kHandlerSpan, context.receivedAt, context.handledAt);
+        });
+
+        // 响应发送完成后调用：更新路由指标并写访问日志
+        server.set_logger([&routeMetrics, &accessLog](const httplib::Request& req, const httplib::Response& res) {
+            const RequestContext& context = RequestContext::current();
+            auto now = std::chrono::steady_clock::now();
+            int64_t totalMicros = elapsedMicros(context.receivedAt, now);
+            recordSpan(kSendSpan, context.handledAt, now);
+
+            auto it = routeMetrics.find(routeOf(req.path));
+            RouteMetrics& metrics = it != routeMetrics.end() ? *it->second : *routeMetrics.at("other");
+            metrics.observe(res.status, totalMicros / 1e6, res.body.size());
+
+            if (accessLog.shouldRecord(res.status, totalMicros)) {
+                AccessLogRecord record;
+                record.time = std::chrono::system_clock::now();
+                record.clientIp = getClientIp(req);
+                record.method = req.method;
+                record.path = req.path;
+                record.status = res.status;
+                record.requestBytes = req.body.size();
+                record.responseBytes = res.body.size();
+                record.totalMicros = totalMicros;
+                record.queueMicros = context.queueMicros;
+                record.handlerMicros = elapsedMicros(context.receivedAt, context.handledAt);
+                record.dbMicros = context.dbMicros;
+                record.upstreamMicros = context.upstreamMicros;
+                record.sendMicros = elapsedMicros(context.handledAt, now);
+                record.cacheResult = context.cacheResult;
+                accessLog.record(record);
             }
+        });
 
-            if (config.enableReferers()) {
-                if (referer.empty()) {
-                    res.status = 403;
-                    res.set_content("Forbidden", "text/plain");
+        if (TraceRecorder::getInstance().isEnabled()) {
+            server.Get("/debug/trace", [secretToken](const httplib::Request& req, httplib::Response& res) {
+                if (!req.has_header("X-Telegram-Bot-Api-Secret-Token") || req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken) {
+                    res.set_content("Unauthorized", "text/plain");
+                    res.status = 401;
                     return;
                 }
+                res.set_content(TraceRecorder::getInstance().toJson(req.has_param("clear")), "application/json");
+            });
+        }
 
-                // 获取允许的 Referer 列表
-                std::vector<std::string> allowedReferers = config.getAllowedReferers();
-                std::unordered_set<std::string> allowedReferersSet(allowedReferers.begin(), allowedReferers.end());
+        // 指标包含上游失败率、队列深度和各路由流量，与 /debug/trace 一样需要 secret_token；
+        // Prometheus 可以用 authorization: {credentials: <secret_token>} 以 Bearer 方式传递
+        if (config.getMetricsEnabled()) {
+            server.Get("/metrics", [secretToken](const httplib::Request& req, httplib::Response& res) {
+                if (secretToken.empty() || (req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken &&
+                                            req.get_header_value("Authorization") != "Bearer " + secretToken)) {
+                    res.set_content("Unauthorized", "text/plain");
+                    res.status = 401;
+                    return;
+                }
+                res.set_content(MetricsRegistry::getInstance().render(), "text/plain; version=0.0.4");
+            });
+        }
 
-                // 检查 Referer 是否在允许的列表中
-                if (!rateLimiter.checkReferer(referer, allowedReferersSet)) {
-                    res.status = 403;
-                    res.set_content("Forbidden", "text/plain");
+        auto mediaRequestHandler = [&apiToken, &mimeTypes, &cacheManager, &rateLimiter, &telegramApiUrl, &config, &dbManager, &pool](const httplib::Request& req, httplib::Response& res) {
+            handleImageRequest(req, res, apiToken, mimeTypes, cacheManager, rateLimiter, telegramApiUrl, config, dbManager, pool);
+        };
+
+        // 为路由设置通用的限流、Referer 验证和统计处理
+        auto registerMediaRoute = [&](const std::string& pattern) {
+            server.Get(pattern, [&config, &rateLimiter, mediaRequestHandler, &statisticsManager](const httplib::Request& req, httplib::Response& res) {
+                // 统计并发请求数，作用域结束时自动减一
+                InFlightRequest inFlight(statisticsManager);
+
+                // 获取客户端 IP 地址
+                // std::string clientIp = req.remote_addr;
+                std::string clientIp;
+                if (req.has_header("X-Forwarded-For")) {
+                    clientIp = req.get_header_value("X-Forwarded-For");
+                } else if (req.has_header("X-Real-IP")) {
+                    clientIp = req.get_header_value("X-Real-IP");
+                } else {
+                    clientIp = req.remote_addr;
+                }
+                int accessStatus = checkMediaAccess(config, rateLimiter, clientIp, req.get_header_value("Referer"));
+                if (accessStatus != 0) {
+                    res.status = accessStatus;
+                    res.set_content(accessStatus == 429 ? "Too Many Requests" : "Forbidden", "text/plain");
                     return;
                 }
+                auto startProcessingTime = std::chrono::steady_clock::now();
+
+                // 计算请求延迟：连接排队时间 + 请求头解析完成到开始处理之间的时间（限流、Referer 检查）
+                const RequestContext& context = RequestContext::current();
+                int requestLatency = static_cast<int>((context.queueMicros + elapsedMicros(context.receivedAt, startProcessingTime)) / 1000);
+                handleMediaRequestWithTiming(req, res, config, rateLimiter, mediaRequestHandler, statisticsManager, requestLatency,
+                                             inFlight.getConcurrentRequests());
+            });
+        };
+
+        registerMediaRoute(R"(/images/(.*))");
+        registerMediaRoute(R"(/files/(.*))");
+        registerMediaRoute(R"(/videos/(.*))");
+        registerMediaRoute(R"(/audios/(.*))");
+        registerMediaRoute(R"(/stickers/(.*))");
+        registerMediaRoute(R"(/d/(.*))");
+
+        server.Post("/upload", [&](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& contentReader) {
+            if (!req.has_header("X-Telegram-Bot-Api-Secret-Token") || req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken) {
+                res.set_content("Unauthorized", "text/plain");
+                res.status = 401;
+                return;
             }
-            auto startProcessingTime = std::chrono::steady_clock::now();
+            picGoHandler.handleUpload(req, res, contentReader, config.getOwnerId(), "", dbManager);
+        });
 
-            // 计算请求延迟
-            int requestLatency = std::chrono::duration_cast<std::chrono::milliseconds>(startProcessingTime - requestArrivalTime).count();
-            handleMediaRequestWithTiming(req, res, config, rateLimiter, mediaRequestHandler, statisticsManager, pool, requestLatency);
+        server.Post("/upload/batch", [&](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& contentReader) {
+            if (!req.has_header("X-Telegram-Bot-Api-Secret-Token") || req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken) {
+                res.set_content("Unauthorized", "text/plain");
+                res.status = 401;
+                return;
+            }
+            picGoHandler.handleBatchUpload(req, res, contentReader, config.getOwnerId(), "", dbManager);
         });
-    };
 
-    registerMediaRoute(R"(/images/(.*))");
-    registerMediaRoute(R"(/files/(.*))");
-    registerMediaRoute(R"(/videos/(.*))");
-    registerMediaRoute(R"(/audios/(.*))");
-    registerMediaRoute(R"(/stickers/(.*))");
-    registerMediaRoute(R"(/d/(.*))");
-
-    svr->Post("/upload", [&](const httplib::Request& req, httplib::Response& res) {
-        if (!req.has_header("X-Telegram-Bot-Api-Secret-Token") || req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken) {
-            res.set_content("Unauthorized", "text/plain");
-            res.status = 401;
-            return;
-        }
-        picGoHandler.handleUpload(req, res, config.getOwnerId(), "", dbManager);
-    });
-
-    // Webhook 路由
-    svr->Post("/webhook", [&bot, secretToken](const httplib::Request& req, httplib::Response& res) {
-        if (!req.has_header("X-Telegram-Bot-Api-Secret-Token") || req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken) {
-            res.set_content("Unauthorized", "text/plain");
-            res.status = 401;
-            return;
-        }
+        // Webhook 路由
+        server.Post("/webhook", [&bot, &pool, secretToken](const httplib::Request& req, httplib::Response& res) {
+            if (!req.has_header("X-Telegram-Bot-Api-Secret-Token") || req.get_header_value("X-Telegram-Bot-Api-Secret-Token") != secretToken) {
+                res.set_content("Unauthorized", "text/plain");
+                res.status = 401;
+                return;
+            }
 
-        try {
-            nlohmann::json update = nlohmann::json::parse(req.body);
-            bot.handleWebhook(update);
-            res.set_content("OK", "text/plain");
-        } catch (const std::exception& e) {
-            log(LogLevel::LOGERROR, "Error processing Webhook: " + std::string(e.what()));
-            res.set_content("Bad Request", "text/plain");
-            res.status = 400;
-        }
-    });
-
-    // 注册和登录页面路由
-    svr->Get("/login", [](const httplib::Request& req, httplib::Response& res) {
-        try {
-            std::string html = loadTemplate("templates/login.html");
-            res.set_content(html, "text/html");
-        } catch (const std::exception& e) {
-            res.set_content("Error loading page", "text/plain");
-            res.status = 500;
-        }
-    });
+            try {
+                // 解析后交给线程池的高优先级队列处理，立即应答 Telegram，不占用 HTTP 线程等待 Bot API 调用
+                nlohmann::json update = nlohmann::json::parse(req.body);
+                pool.enqueueWithPriority(TaskPriority::High, [&bot, update = std::move(update)]() {
+                    try {
+                        bot.handleWebhook(update);
+                    } catch (const std::exception& e) {
+                        log(LogLevel::LOGERROR, "Error processing Webhook: " + std::string(e.what()));
+                    }
+                });
+                res.set_content("OK", "text/plain");
+            } catch (const std::exception& e) {
+                log(LogLevel::LOGERROR, "Error processing Webhook: " + std::string(e.what()));
+                res.set_content("Bad Request", "text/plain");
+                res.status = 400;
+            }
+        });
 
-    svr->Get("/register", [allowRegistration](const httplib::Request& req, httplib::Response& res) {
-        if (!allowRegistration) {
-            res.set_content("<h1>Registration is not allowed.</h1>", "text/html");
-            return;
-        }
-        try {
-            std::string html = loadTemplate("templates/register.html");
-            res.set_content(html, "text/html");
-        } catch (const std::exception& e) {
-            res.set_content("Error loading page", "text/plain");
-            res.status = 500;
-        }
-    });
+        // 注册和登录页面路由
+        server.Get("/login", [](const httplib::Request& req, httplib::Response& res) {
+            try {
+                std::string html = loadTemplate("templates/login.html");
+                res.set_content(html, "text/html");
+            } catch (const std::exception& e) {
+                res.set_content("Error loading page", "text/plain");
+                res.status = 500;
+            }
+        });
 
-    // 图片页面
-    svr->Get("/pic", [&dbManager](const httplib::Request& req, httplib::Response& res) {
-        int page = req.has_param("page") ? std::stoi(req.get_param_value("page")) : 1;
-        int pageSize = 10;
+        server.Get("/register", [allowRegistration](const httplib::Request& req, httplib::Response& res) {
+            if (!allowRegistration) {
+                res.set_content("<h1>Registration is not allowed.</h1>", "text/html");
+                return;
+            }
+            try {
+                std::string html = loadTemplate("templates/register.html");
+                res.set_content(html, "text/html");
+            } catch (const std::exception& e) {
+                res.set_content("Error loading page", "text/plain");
+                res.status = 500;
+            }
+        });
 
-        std::vector<std::tuple<std::string, std::string, std::string, std::string>> mediaFiles = dbManager.getImagesAndVideos(page, pageSize);
-        std::string galleryHtml;
+        // 图片页面
+        server.Get("/pic", [&dbManager](const httplib::Request& req, httplib::Response& res) {
+            int page = req.has_param("page") ? std::stoi(req.get_param_value("page")) : 1;
+            int pageSize = 10;
+
+            std::vector<std::tuple<std::string, std::string, std::string, std::string>> mediaFiles = dbManager.getImagesAndVideos(page, pageSize);
+            std::string galleryHtml;
+
+            for (const auto& media : mediaFiles) {
+                const std::string& fileName = std::get<1>(media);
+                const std::string& fileLink = std::get<2>(media);
+                const std::string& extension = std::get<3>(media);
+
+                std::string mediaType = (extension == ".mp4" || extension == ".mkv" || extension == ".avi" || extension == ".mov" || extension == ".flv" || extension == ".wmv") ? "video" : "image";
+                galleryHtml += "<div class=\"media-item\">";
+                if (mediaType == "image") {
+                    galleryHtml += "<img src=\"" + fileLink + "\" alt=\"" + fileName + "\" class=\"media-preview\">";
+                } else {
+                    galleryHtml += "<video controls class=\"media-preview\"><source src=\"" + fileLink + "\" type=\"video/" + extension + "\"></video>";
+                }
+                galleryHtml += "<div class=\"media-name\">" + fileName + "</div></div>";
+            }
 
-        for (const auto& media : mediaFiles) {
-            const std::string& fileName = std::get<1>(media);
-            const std::string& fileLink = std::get<2>(media);
-            const std::string& extension = std::get<3>(media);
+            try {
+                std::string html = loadTemplate("templates/index.html");
+                size_t pos = html.find("{{gallery}}");
+                if (pos != std::string::npos) {
+                    html.replace(pos, 11, galleryHtml);
+                }
+                res.set_content(html, "text/html");
+            } catch (const std::exception& e) {
+                res.set_content("Error loading page", "text/plain");
+                res.status = 500;
+            }
+        });
 
-            std::string mediaType = (extension == ".mp4" || extension == ".mkv" || extension == ".avi" || extension == ".mov" || extension == ".flv" || extension == ".wmv") ? "video" : "image";
-            galleryHtml += "<div class=\"media-item\">";
-            if (mediaType == "image") {
-                galleryHtml += "<img src=\"" + fileLink + "\" alt=\"" + fileName + "\" class=\"media-preview\">";
-            } else {
-                galleryHtml += "<video controls class=\"media-preview\"><source src=\"" + fileLink + "\" type=\"video/" + extension + "\"></video>";
+        server.Get("/", [allowRegistration](const httplib::Request& req, httplib::Response& res) {
+            if (!allowRegistration) {
+                res.set_content("<h1>Registration is not allowed.</h1>", "text/html");
+                return;
             }
-            galleryHtml += "<div class=\"media-name\">" + fileName + "</div></div>";
+            try {
+                std::string html = loadTemplate("templates/register.html");
+                res.set_content(html, "text/html");
+            } catch (const std::exception& e) {
+                res.set_content("Error loading page", "text/plain");
+                res.status = 500;
+            }
+        });
+    };
+
+    std::vector<std::unique_ptr<httplib::Server>> servers;
+    std::vector<socket_t> listenSockets(listenerCount, INVALID_SOCKET);
+    for (size_t i = 0; i < listenerCount; ++i) {
+        if (useHttps) {
+            std::string certPath = config.getSslCertificate();
+            std::string keyPath = config.getSslKey();
+            servers.push_back(std::make_unique<httplib::SSLServer>(certPath.c_str(), keyPath.c_str()));
+        } else {
+            servers.push_back(std::make_unique<httplib::Server>());
         }
+        configureServer(*servers.back(), listenSockets[i]);
+    }
 
-        try {
-            std::string html = loadTemplate("templates/index.html");
-            size_t pos = html.find("{{gallery}}");
-            if (pos != std::string::npos) {
-                html.replace(pos, 11, galleryHtml);
+    // 可选的事件驱动媒体服务：单独监听一个端口（由反向代理把媒体路径转发过去），
+    // 连接读写在 epoll 事件循环中完成，只有解析文件（查库、请求 Telegram）进入它自己的线程池
+    std::unique_ptr<EventServer> eventServer;
+    if (config.getEventServerEnabled()) {
+        EventServerOptions eventOptions;
+        eventOptions.hostname = config.getEventServerHostname();
+        eventOptions.port = config.getEventServerPort();
+        eventOptions.loopThreads = config.getEventServerThreads();
+        eventOptions.minWorkerThreads = config.getEventServerMinWorkerThreads();
+        eventOptions.maxWorkerThreads = config.getEventServerMaxWorkerThreads();
+        eventOptions.maxConnections = static_cast<size_t>(std::max(config.getEventServerMaxConnections(), 1));
+        eventOptions.idleTimeoutSeconds = config.getEventServerIdleTimeoutSeconds();
+        eventOptions.listenBacklog = std::max(config.getEventServerListenBacklog(), 1);
+
+        auto eventHandler = [&](const EventRequest& req, EventServer::Responder respond) {
+            RequestContext& context = RequestContext::current();
+            context.begin(req.receivedAt);
+
+            std::string shortId;
+            for (const char* prefix : kMediaPrefixes) {
+                size_t prefixLength = std::strlen(prefix);
+                if (req.path.compare(0, prefixLength, prefix) == 0) {
+                    shortId = req.path.substr(prefixLength);
+                    break;
+                }
+            }
+
+            std::string clientIp = req.header("x-forwarded-for");
+            if (!clientIp.empty()) {
+                clientIp = clientIp.substr(0, clientIp.find(','));
+            } else if (!req.header("x-real-ip").empty()) {
+                clientIp = req.header("x-real-ip");
+            } else {
+                clientIp = req.remoteAddr;
             }
-            res.set_content(html, "text/html");
-        } catch (const std::exception& e) {
-            res.set_content("Error loading page", "text/plain");
-            res.status = 500;
+
+            // 媒体文件可能在 UpstreamEngine 的回调中才解析完成，此时已不在工作线程上，
+            // 上下文和在途计数都随 finish 一起传递
+            auto inFlight = std::make_shared<InFlightRequest>(statisticsManager);
+            auto startProcessingTime = std::chrono::steady_clock::now();
+            auto finish = [&statisticsManager, &routeMetrics, &accessLog, context, inFlight, startProcessingTime, clientIp,
+                           method = req.method, path = req.path, respond](EventResponse&& res, const MediaFile* media) mutable {
+                if (media) {
+                    context.cacheResult = media->cacheResult;
+                    context.dbMicros += media->dbMicros;
+                    context.upstreamMicros += media->upstreamMicros;
+                }
+                context.handledAt = std::chrono::steady_clock::now();
+                recordSpan(kHandlerSpan, context.receivedAt, context.handledAt);
+
+                int responseTime = static_cast<int>(elapsedMicros(startProcessingTime, context.handledAt) / 1000);
+                int requestLatency = static_cast<int>(elapsedMicros(context.receivedAt, startProcessingTime) / 1000);
+                size_t responseSize = res.fileFd >= 0 ? res.fileSize : res.body.size();
+                recordRequestStatistics(statisticsManager, clientIp, path, method, res.status, responseSize, 0, responseTime,
+                                        requestLatency, inFlight->getConcurrentRequests());
+
+                // 发送结束后更新路由指标并写访问日志（在事件循环线程中执行，上下文需要复制过去）
+                res.onComplete = [&routeMetrics, &accessLog, context, clientIp, method, path](const EventRequestLog& requestLog) {
+                    int64_t totalMicros = elapsedMicros(context.receivedAt, requestLog.finishedAt);
+                    recordSpan(kSendSpan, requestLog.handledAt, requestLog.finishedAt);
+
+                    auto it = routeMetrics.find(routeOf(path));
+                    RouteMetrics& metrics = it != routeMetrics.end() ? *it->second : *routeMetrics.at("other");
+                    metrics.observe(requestLog.status, totalMicros / 1e6, requestLog.bytesSent);
+
+                    if (accessLog.shouldRecord(requestLog.status, totalMicros)) {
+                        AccessLogRecord record;
+                        record.time = std::chrono::system_clock::now();
+                        record.clientIp = clientIp;
+                        record.method = method;
+                        record.path = path;
+                        record.status = requestLog.status;
+                        record.requestBytes = 0;
+                        record.responseBytes = requestLog.bytesSent;
+                        record.totalMicros = totalMicros;
+                        record.queueMicros = elapsedMicros(context.receivedAt, requestLog.dispatchedAt);
+                        record.handlerMicros = elapsedMicros(requestLog.dispatchedAt, requestLog.handledAt);
+                        record.dbMicros = context.dbMicros;
+                        record.upstreamMicros = context.upstreamMicros;
+                        record.sendMicros = elapsedMicros(requestLog.handledAt, requestLog.finishedAt);
+                        record.cacheResult = context.cacheResult;
+                        accessLog.record(record);
+                    }
+                };
+                respond(std::move(res));
+            };
+
+            if (shortId.empty()) {
+                EventResponse res;
+                res.status = 404;
+                res.body = "Not Found";
+                finish(std::move(res), nullptr);
+                return;
+            }
+            if (int accessStatus = checkMediaAccess(config, rateLimiter, clientIp, req.header("referer"))) {
+                EventResponse res;
+                res.status = accessStatus;
+                res.body = accessStatus == 429 ? "Too Many Requests" : "Forbidden";
+                finish(std::move(res), nullptr);
+                return;
+            }
+
+            resolveMediaFile(shortId, req.header("accept").find("image/webp") != std::string::npos, apiToken, mimeTypes,
+                             cacheManager, rateLimiter, telegramApiUrl, dbManager, pool,
+                             [finish = std::move(finish)](MediaFile&& media) mutable {
+                EventResponse res;
+                res.status = media.status;
+                if (media.status == 200) {
+                    // 不做 gzip 压缩，文件直接 sendfile
+                    res.contentType = media.contentType;
+                    res.headers.emplace_back("Cache-Control", "max-age=3600");
+                    res.fileFd = media.fileFd;
+                    res.fileSize = media.fileSize;
+                } else {
+                    res.body = media.errorMessage;
+                    if (media.status == 503) {
+                        res.headers.emplace_back("Retry-After", std::to_string(getTelegramCircuitBreaker().getRetryAfterSeconds()));
+                    }
+                }
+                finish(std::move(res), &media);
+            });
+        };
+
+        eventServer = std::make_unique<EventServer>(eventOptions, eventHandler);
+        if (eventServer->start()) {
+            EventServer* eventServerPtr = eventServer.get();
+            metricsRegistry.callback("event_server_connections", "Open connections on the event-driven media server", "gauge", {},
+                                     [eventServerPtr]() { return static_cast<double>(eventServerPtr->getConnectionCount()); });
+        } else {
+            eventServer.reset();
         }
-    });
+    }
 
-    svr->Get("/", [allowRegistration](const httplib::Request& req, httplib::Response& res) {
-        if (!allowRegistration) {
-            res.set_content("<h1>Registration is not allowed.</h1>", "text/html");
+    metricsRegistry.callback("upstream_engine_active_transfers", "Telegram requests in flight on the asynchronous upstream engine", "gauge", {},
+                             []() { return static_cast<double>(UpstreamEngine::getInstance().getActiveTransfers()); });
+    metricsRegistry.callback("upstream_engine_queued_transfers", "Telegram requests waiting behind an earlier request with the same ordering key", "gauge", {},
+                             []() { return static_cast<double>(UpstreamEngine::getInstance().getQueuedTransfers()); });
+    metricsRegistry.callback("upstream_circuit_state", "Telegram API circuit breaker state (0 closed, 1 open, 2 half-open)", "gauge", {{"upstream", "telegram"}},
+                             []() { return static_cast<double>(getTelegramCircuitBreaker().getState()); });
+    metricsRegistry.callback("telegram_outbound_queued", "Bot messages waiting for the Telegram send rate limits", "gauge", {},
+                             []() { return static_cast<double>(TelegramScheduler::getInstance().getQueuedMessages()); });
+
+    // 启动服务器：全部实例绑定成功后再开始 accept；第一个实例在调用线程上运行，不占用后台线程池
+    for (size_t i = 0; i < listenerCount; ++i) {
+        if (!servers[i]->bind_to_port(hostname, port)) {
+            log(LogLevel::LOGERROR,"Error: Server failed to start on port: " + std::to_string(port));
             return;
         }
-        try {
-            std::string html = loadTemplate("templates/register.html");
-            res.set_content(html, "text/html");
-        } catch (const std::exception& e) {
-            res.set_content("Error loading page", "text/plain");
-            res.status = 500;
+        if (listenSockets[i] != INVALID_SOCKET && ::listen(listenSockets[i], listenBacklog) != 0) {
+            log(LogLevel::WARNING, "Failed to apply listen backlog " + std::to_string(listenBacklog) + ", using the default");
         }
-    });
+    }
+    log(LogLevel::INFO,"Server running on port: " + std::to_string(port) + " with " + std::to_string(listenerCount) +
+                           " listeners and " + std::to_string(workerThreads) + " worker threads each");
+
+    std::vector<std::thread> listenerThreads;
+    for (size_t i = 1; i < listenerCount; ++i) {
+        httplib::Server* server = servers[i].get();
+        listenerThreads.emplace_back([server, port]() {
+            if (!server->listen_after_bind()) {
+                log(LogLevel::LOGERROR,"Error: Server stopped unexpectedly on port: " + std::to_string(port));
+            }
+        });
+    }
+    if (!servers[0]->listen_after_bind()) {
+        log(LogLevel::LOGERROR,"Error: Server stopped unexpectedly on port: " + std::to_string(port));
+    }
 
-    // 启动服务器
-    std::future<void> serverFuture = pool.enqueue([&svr, hostname, port]() {
-        log(LogLevel::INFO,"Server running on port: " + std::to_string(port));
-        if (!svr->listen(hostname.c_str(), port)) {
-            log(LogLevel::LOGERROR,"Error: Server failed to start on port: " + std::to_string(port));
-        }
-    });
+    // 第一个实例退出后停止其余实例
+    for (size_t i = 1; i < listenerCount; ++i) {
+        servers[i]->wait_until_ready();
+        servers[i]->stop();
+    }
+    for (std::thread& listenerThread : listenerThreads) {
+        listenerThread.join();
+    }
 
-    try {
-        serverFuture.get();
-    } catch (const std::system_error& e) {
-        log(LogLevel::LOGERROR, "System error occurred: " + std::string(e.what()));
-        throw;
+    if (TraceRecorder::getInstance().isEnabled() && !TraceRecorder::getInstance().dumpToFile(config.getChromeTracePath())) {
+        log(LogLevel::LOGERROR, "Failed to write trace file: " + config.getChromeTracePath());
     }
 }
@@ -0,0 +1,339 @@
+#include "telegram_scheduler.h"
+#include "utils.h"
+#include "metrics.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+
+namespace {
+
+// 读取类请求由用户请求触发，不能像发送那样长时间等待
+const int kMaxCallRetries = 2;
+const std::chrono::milliseconds kMaxCallDelay(3000);
+
+struct SchedulerMetrics {
+    Counter& retries;
+    Counter& dropped;
+    Counter& coalesced;
+};
+
+SchedulerMetrics& schedulerMetrics() {
+    static SchedulerMetrics metrics{
+        MetricsRegistry::getInstance().counter("telegram_outbound_retries_total", "Telegram requests retried after 429, 5xx or a transport failure"),
+        MetricsRegistry::getInstance().counter("telegram_outbound_dropped_total", "Outbound Telegram messages given up after errors, queue overflow or shutdown"),
+        MetricsRegistry::getInstance().counter("telegram_outbound_coalesced_total", "Queued Telegram edits replaced by a newer edit of the same message"),
+    };
+    return metrics;
+}
+
+}  // namespace
+
+TelegramScheduler& TelegramScheduler::getInstance() {
+    static TelegramScheduler instance;
+    return instance;
+}
+
+TelegramScheduler::TelegramScheduler()
+    : stopping(false), queuedMessages(0), tokens(0), lastRefill(Clock::now()), random(std::random_device{}()) {
+    // 保证引擎先于调度器构造、后于调度器析构
+    UpstreamEngine::getInstance();
+    tokens = options.globalPerSecond;
+    worker = std::thread(&TelegramScheduler::run, this);
+}
+
+TelegramScheduler::~TelegramScheduler() {
+    shutdown();
+}
+
+void TelegramScheduler::configure(const TelegramSchedulerOptions& newOptions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    options = newOptions;
+    options.globalPerSecond = std::max(options.globalPerSecond, 1);
+    options.groupPerMinute = std::max(options.groupPerMinute, 1);
+    options.maxQueuedPerChat = std::max<size_t>(options.maxQueuedPerChat, 1);
+    tokens = std::min(tokens, static_cast<double>(options.globalPerSecond));
+}
+
+void TelegramScheduler::send(const std::string& chatId, UpstreamRequest request, const std::string& coalesceKey) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+        log(LogLevel::WARNING, "Telegram scheduler stopped, dropping message to chat " + chatId);
+        schedulerMetrics().dropped.inc();
+        return;
+    }
+
+    ChatQueue& chat = chats[chatId];
+    if (!coalesceKey.empty()) {
+        for (Message& queued : chat.pending) {
+            if (queued.coalesceKey == coalesceKey) {
+                queued.request = std::move(request);
+                queued.attempts = 0;
+                schedulerMetrics().coalesced.inc();
+                return;
+            }
+        }
+    }
+
+    if (chat.pending.size() >= options.maxQueuedPerChat) {
+        log(LogLevel::WARNING, "Too many queued messages for chat " + chatId + ", dropping the oldest");
+        chat.pending.pop_front();
+        --queuedMessages;
+        schedulerMetrics().dropped.inc();
+    }
+    Message message;
+    message.request = std::move(request);
+    message.coalesceKey = coalesceKey;
+    chat.pending.push_back(std::move(message));
+    ++queuedMessages;
+    wakeup.notify_one();
+}
+
+void TelegramScheduler::call(UpstreamRequest request, UpstreamCallback callback) {
+    DelayedCall delayed;
+    delayed.request = std::move(request);
+    delayed.callback = std::move(callback);
+    submitCall(std::move(delayed));
+}
+
+std::future<HttpResponse> TelegramScheduler::call(UpstreamRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> result = promise->get_future();
+    call(std::move(request), [promise](HttpResponse&& response) { promise->set_value(std::move(response)); });
+    return result;
+}
+
+std::future<HttpResponse> TelegramScheduler::upload(UpstreamRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> result = promise->get_future();
+    DelayedCall delayed;
+    delayed.request = std::move(request);
+    delayed.callback = [promise](HttpResponse&& response) { promise->set_value(std::move(response)); };
+    delayed.upload = true;
+    submitCall(std::move(delayed));
+    return result;
+}
+
+void TelegramScheduler::submitCall(DelayedCall delayed) {
+    UpstreamRequest request = delayed.request;
+    UpstreamEngine::getInstance().submit(std::move(request), [this, delayed = std::move(delayed)](HttpResponse&& response) mutable {
+        std::unique_lock<std::mutex> lock(mutex);
+        // 熔断器断开时直接返回失败，读取请求应快速失败
+        std::chrono::milliseconds delay(-1);
+        std::chrono::milliseconds maxDelay = kMaxCallDelay;
+        bool circuitClosed = getTelegramCircuitBreaker().getState() == CircuitBreaker::State::Closed;
+        if (delayed.upload) {
+            // 上传只重试 429：请求没有被执行，重试不会重复发送
+            maxDelay = std::chrono::milliseconds(std::max(options.maxBackoffMs, 1));
+            if (!stopping && response.ok && response.status == 429) {
+                delay = retryDelay(response, ++delayed.attempts);
+            }
+        } else if (!stopping && circuitClosed && ++delayed.attempts <= kMaxCallRetries) {
+            delay = retryDelay(response, delayed.attempts);
+        }
+        if (delay.count() < 0 || delay > maxDelay) {
+            lock.unlock();
+            delayed.callback(std::move(response));
+            return;
+        }
+        schedulerMetrics().retries.inc();
+        delayedCalls.emplace(Clock::now() + delay, std::move(delayed));
+        wakeup.notify_one();
+    });
+}
+
+void TelegramScheduler::shutdown() {
+    std::vector<DelayedCall> abandonedCalls;
+    size_t droppedMessages;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+        for (auto& entry : delayedCalls) {
+            abandonedCalls.push_back(std::move(entry.second));
+        }
+        delayedCalls.clear();
+        droppedMessages = queuedMessages;
+        queuedMessages = 0;
+        chats.clear();
+    }
+    wakeup.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    for (DelayedCall& delayed : abandonedCalls) {
+        delayed.callback(HttpResponse());
+    }
+    if (droppedMessages > 0) {
+        log(LogLevel::WARNING, "Telegram scheduler stopped with " + std::to_string(droppedMessages) + " unsent messages");
+        schedulerMetrics().dropped.inc(droppedMessages);
+    }
+}
+
+size_t TelegramScheduler::getQueuedMessages() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedMessages;
+}
+
+int TelegramScheduler::parseRetryAfter(const std::string& body) {
+    nlohmann::json json = nlohmann::json::parse(body, nullptr, false);
+    if (json.is_object() && json.contains("parameters") && json["parameters"].is_object() &&
+        json["parameters"].contains("retry_after") && json["parameters"]["retry_after"].is_number_integer()) {
+        return std::max(json["parameters"]["retry_after"].get<int>(), 0);
+    }
+    return -1;
+}
+
+std::chrono::milliseconds TelegramScheduler::backoffDelay(int attempt) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return computeBackoff(attempt);
+}
+
+std::chrono::milliseconds TelegramScheduler::computeBackoff(int attempt) {
+    long long ceiling = std::max(options.baseBackoffMs, 1);
+    for (int i = 1; i < attempt && ceiling < options.maxBackoffMs; ++i) {
+        ceiling *= 2;
+    }
+    ceiling = std::min<long long>(ceiling, std::max(options.maxBackoffMs, 1));
+    // 全抖动：同时失败的请求不会在同一时刻一起重试
+    std::uniform_int_distribution<long long> distribution(0, ceiling);
+    return std::chrono::milliseconds(distribution(random));
+}
+
+std::chrono::milliseconds TelegramScheduler::retryDelay(const HttpResponse& response, int attempt) {
+    if (attempt > options.maxRetries) {
+        return std::chrono::milliseconds(-1);
+    }
+    if (response.ok && response.status == 429) {
+        int retryAfter = parseRetryAfter(response.body);
+        return retryAfter >= 0 ? std::chrono::milliseconds(retryAfter * 1000LL) : computeBackoff(attempt);
+    }
+    if (!response.ok || response.status >= 500) {
+        // 熔断器断开时至少等到下一次探测，提前重试只会被直接拒绝
+        std::chrono::milliseconds untilProbe(getTelegramCircuitBreaker().getRetryAfterSeconds() * 1000LL);
+        return std::max(computeBackoff(attempt), untilProbe);
+    }
+    return std::chrono::milliseconds(-1);
+}
+
+std::chrono::milliseconds TelegramScheduler::chatInterval(const std::string& chatId) const {
+    // 群组、超级群组和频道的 ID 为负数，频道也可以用 @username
+    bool isGroup = !chatId.empty() && (chatId[0] == '-' || chatId[0] == '@');
+    if (isGroup) {
+        return std::chrono::milliseconds(60000 / options.groupPerMinute);
+    }
+    return std::chrono::milliseconds(std::max(options.privateChatIntervalMs, 0));
+}
+
+void TelegramScheduler::onSendFinished(const std::string& chatId, Message message, HttpResponse&& response) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+        return;
+    }
+    ChatQueue& chat = chats[chatId];
+    chat.inFlight = false;
+    wakeup.notify_one();
+    if (response.ok && response.status == 200) {
+        return;
+    }
+
+    // 同一条消息已有更新的编辑在排队，旧的不必重试
+    bool superseded = !message.coalesceKey.empty() &&
+        std::any_of(chat.pending.begin(), chat.pending.end(), [&message](const Message& queued) { return queued.coalesceKey == message.coalesceKey; });
+    std::chrono::milliseconds delay = superseded ? std::chrono::milliseconds(-1) : retryDelay(response, ++message.attempts);
+    if (delay.count() < 0) {
+        if (!superseded) {
+            log(LogLevel::LOGERROR, "Failed to send message to chat " + chatId + " after " + std::to_string(message.attempts) +
+                                        " attempts, status: " + std::to_string(response.status) + ", response: " + response.body);
+            schedulerMetrics().dropped.inc();
+        }
+        return;
+    }
+
+    log(LogLevel::WARNING, "Telegram request for chat " + chatId + " failed with status " + std::to_string(response.status) +
+                               ", retrying in " + std::to_string(delay.count()) + " ms");
+    schedulerMetrics().retries.inc();
+    chat.nextSendAt = std::max(chat.nextSendAt, Clock::now() + delay);
+    chat.pending.push_front(std::move(message));
+    ++queuedMessages;
+}
+
+void TelegramScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::string lastServedChat;
+
+    while (!stopping) {
+        Clock::time_point now = Clock::now();
+        double rate = options.globalPerSecond;
+        tokens = std::min(rate, tokens + std::chrono::duration<double>(now - lastRefill).count() * rate);
+        lastRefill = now;
+
+        std::vector<DelayedCall> dueCalls;
+        while (!delayedCalls.empty() && delayedCalls.begin()->first <= now) {
+            dueCalls.push_back(std::move(delayedCalls.begin()->second));
+            delayedCalls.erase(delayedCalls.begin());
+        }
+
+        // 从上次发送的聊天之后开始轮转，令牌不足时各聊天轮流获得发送机会
+        std::vector<std::pair<std::string, Message>> dueMessages;
+        Clock::time_point nextWake = now + std::chrono::seconds(1);
+        auto start = chats.upper_bound(lastServedChat);
+        for (size_t visited = 0, total = chats.size(); visited < total; ++visited) {
+            if (start == chats.end()) {
+                start = chats.begin();
+            }
+            auto it = start++;
+            ChatQueue& chat = it->second;
+            if (chat.inFlight || chat.pending.empty()) {
+                continue;
+            }
+            if (chat.nextSendAt > now) {
+                nextWake = std::min(nextWake, chat.nextSendAt);
+                continue;
+            }
+            if (tokens < 1) {
+                nextWake = std::min(nextWake, now + std::chrono::milliseconds(static_cast<long long>((1 - tokens) * 1000 / rate) + 1));
+                break;
+            }
+            tokens -= 1;
+            chat.inFlight = true;
+            chat.nextSendAt = now + chatInterval(it->first);
+            dueMessages.emplace_back(it->first, std::move(chat.pending.front()));
+            chat.pending.pop_front();
+            --queuedMessages;
+            lastServedChat = it->first;
+        }
+
+        // 空闲且已过发送间隔的聊天不再需要记录
+        for (auto it = chats.begin(); it != chats.end();) {
+            if (!it->second.inFlight && it->second.pending.empty() && it->second.nextSendAt <= now) {
+                it = chats.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!delayedCalls.empty()) {
+            nextWake = std::min(nextWake, delayedCalls.begin()->first);
+        }
+
+        if (dueCalls.empty() && dueMessages.empty()) {
+            wakeup.wait_until(lock, nextWake);
+            continue;
+        }
+
+        // 提交时不持有锁：引擎停止时会在当前线程直接回调
+        lock.unlock();
+        for (DelayedCall& delayed : dueCalls) {
+            submitCall(std::move(delayed));
+        }
+        for (auto& due : dueMessages) {
+            UpstreamRequest request = due.second.request;
+            UpstreamEngine::getInstance().submit(std::move(request),
+                [this, chatId = std::move(due.first), message = std::move(due.second)](HttpResponse&& response) mutable {
+                    onSendFinished(chatId, std::move(message), std::move(response));
+                });
+        }
+        lock.lock();
+    }
+}
@@ -1,7 +1,50 @@
 #include "thread_pool.h"
+#include <algorithm>
 
-ThreadPool::ThreadPool(size_t threads) : stop(false), maxThreads(threads) {
-    resize(threads);
+namespace {
+
+// 当前线程所属的线程池，用于识别在工作线程内提交的任务
+thread_local const ThreadPool* currentPool = nullptr;
+
+// 每分派这么多个任务，优先取一次最低优先级的非空队列，避免低优先级任务一直得不到执行
+constexpr size_t kStarvationInterval = 16;
+
+}  // namespace
+
+OverflowPolicy parseOverflowPolicy(const std::string& policy, OverflowPolicy defaultPolicy) {
+    std::string lower = policy;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "block") {
+        return OverflowPolicy::Block;
+    } else if (lower == "drop_newest") {
+        return OverflowPolicy::DropNewest;
+    } else if (lower == "drop_oldest") {
+        return OverflowPolicy::DropOldest;
+    } else if (lower == "run_inline") {
+        return OverflowPolicy::RunInline;
+    }
+    return defaultPolicy;
+}
+
+const char* taskPriorityName(TaskPriority priority) {
+    switch (priority) {
+        case TaskPriority::High: return "high";
+        case TaskPriority::Normal: return "normal";
+        case TaskPriority::Low: return "low";
+    }
+    return "unknown";
+}
+
+ThreadPool::ThreadPool(size_t threads) : ThreadPool(threads, threads, std::chrono::milliseconds(0)) {}
+
+ThreadPool::ThreadPool(size_t minThreads, size_t maxThreads, std::chrono::milliseconds idleTimeout)
+    : queuedTasks(0), dispatchCount(0), blockedSubmitters(0),
+      stop(false), minThreads(minThreads), maxThreads(std::max<size_t>(std::max<size_t>(maxThreads, minThreads), 1)),
+      idleTimeout(idleTimeout), nextWorkerId(0), idleThreads(0), busyThreads(0), exitRequests(0) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (workers.size() < this->minThreads) {
+        spawnWorker();
+    }
 }
 
 ThreadPool::~ThreadPool() {
@@ -10,57 +53,281 @@ ThreadPool::~ThreadPool() {
         stop = true;  // 设置 stop 标志，表示停止所有线程
     }
     condition.notify_all();  // 唤醒所有线程
-    for (std::thread &worker : workers) {
+    notFull.notify_all();    // 唤醒等待队列空位的提交线程
+
+    // 线程退出时会把自己从 workers 移到 finishedWorkers，这里把两处的线程都取出来 join
+    std::vector<std::thread> threads;
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        for (auto& worker : workers) {
+            threads.push_back(std::move(worker.second));
+        }
+        workers.clear();
+        for (auto& worker : finishedWorkers) {
+            threads.push_back(std::move(worker));
+        }
+        finishedWorkers.clear();
+    }
+    for (std::thread& worker : threads) {
         if (worker.joinable()) {
             worker.join();  // 等待所有线程退出
         }
     }
 }
 
-void ThreadPool::resize(size_t newSize) {
-    // 限制新大小不超过最大线程数
-    if (newSize > maxThreads) {
-        newSize = maxThreads;
-    }
-
-    // 增加线程
-    while (workers.size() < newSize) {
-        workers.emplace_back([this] {
-            for (;;) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(this->queueMutex);
-                    this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
-                    
-                    if (this->stop && this->tasks.empty()) {
-                        return;  // 线程退出
+void ThreadPool::spawnWorker() {
+    // 顺便回收已退出的线程；它们在把自己放入 finishedWorkers 后只剩释放锁并返回，join 不会阻塞
+    for (std::thread& worker : finishedWorkers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    finishedWorkers.clear();
+
+    size_t id = nextWorkerId++;
+    workers.emplace(id, std::thread(&ThreadPool::workerLoop, this, id));
+}
+
+size_t ThreadPool::liveThreadCount() const {
+    return workers.size() > exitRequests ? workers.size() - exitRequests : 0;
+}
+
+void ThreadPool::growForBacklog() {
+    // 空闲线程不足以处理排队任务时扩容
+    if (!stop && queuedTasks > idleThreads && liveThreadCount() < maxThreads) {
+        spawnWorker();
+    }
+}
+
+bool ThreadPool::popTask(std::function<void()>& task) {
+    if (queuedTasks == 0) {
+        return false;
+    }
+
+    // 按优先级从高到低取任务，每隔 kStarvationInterval 次反过来取一次
+    bool lowestFirst = (++dispatchCount % kStarvationInterval) == 0;
+    for (size_t i = 0; i < kLaneCount; ++i) {
+        Lane& lane = lanes[lowestFirst ? kLaneCount - 1 - i : i];
+        if (!lane.tasks.empty()) {
+            task = std::move(lane.tasks.front());
+            lane.tasks.pop_front();
+            --queuedTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::submit(TaskPriority priority, std::function<void()> task) {
+    Lane& lane = lanes[static_cast<size_t>(priority)];
+    std::function<void()> droppedTask;  // 在锁外销毁
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+
+        // 如果线程池已经停止，不允许添加任务
+        if (stop) {
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+        }
+
+        if (lane.capacity > 0 && lane.tasks.size() >= lane.capacity) {
+            OverflowPolicy policy = lane.policy;
+            if (policy == OverflowPolicy::Block && currentPool == this) {
+                policy = OverflowPolicy::RunInline;  // 工作线程等待自己所在的线程池可能导致死锁
+            }
+
+            switch (policy) {
+                case OverflowPolicy::Block:
+                    ++blockedSubmitters;
+                    // 等待期间容量可能被 setQueueLimit 改为 0（不限），此时也应放行
+                    notFull.wait(lock, [this, &lane] { return stop || lane.capacity == 0 || lane.tasks.size() < lane.capacity; });
+                    --blockedSubmitters;
+                    if (stop) {
+                        throw std::runtime_error("enqueue on stopped ThreadPool");
                     }
+                    break;
+                case OverflowPolicy::DropNewest:
+                    ++lane.dropped;
+                    return;
+                case OverflowPolicy::DropOldest:
+                    droppedTask = std::move(lane.tasks.front());
+                    lane.tasks.pop_front();
+                    --queuedTasks;
+                    ++lane.dropped;
+                    break;
+                case OverflowPolicy::RunInline:
+                    lock.unlock();
+                    task();
+                    return;
+            }
+        }
+
+        // 将任务加入任务队列中，积压时扩容
+        lane.tasks.push_back(std::move(task));
+        ++queuedTasks;
+        growForBacklog();
+    }
+
+    // 通知一个等待的工作线程，有新任务可执行
+    condition.notify_one();
+}
+
+void ThreadPool::workerLoop(size_t id) {
+    currentPool = this;
+    std::unique_lock<std::mutex> lock(queueMutex);
+    for (;;) {
+        auto ready = [this] { return stop || queuedTasks > 0 || exitRequests > 0; };
+
+        ++idleThreads;
+        bool timedOut = false;
+        if (idleTimeout.count() > 0) {
+            timedOut = !condition.wait_for(lock, idleTimeout, ready);
+        } else {
+            condition.wait(lock, ready);
+        }
+        --idleThreads;
 
-                    // 获取任务并解锁队列
-                    task = std::move(this->tasks.front());
-                    this->tasks.pop();
-                }
-                // 执行任务（锁外执行，防止阻塞队列）
-                task();
+        // resize 缩容：只有被要求退出的线程数个线程会退出
+        if (exitRequests > 0) {
+            --exitRequests;
+            break;
+        }
+        std::function<void()> task;
+        if (!popTask(task)) {
+            if (stop) {
+                break;  // 线程退出
             }
-        });
+            // 空闲超时，线程数高于下限时退出
+            if (timedOut && liveThreadCount() > minThreads) {
+                break;
+            }
+            continue;
+        }
+
+        // 取出任务后解锁队列
+        ++busyThreads;
+        if (blockedSubmitters > 0) {
+            notFull.notify_all();
+        }
+        lock.unlock();
+
+        // 执行任务（锁外执行，防止阻塞队列），捕获的对象也在锁外释放
+        task();
+        task = nullptr;
+
+        lock.lock();
+        --busyThreads;
+    }
+
+    // 析构时 workers 可能已被清空，此时线程由析构函数负责 join
+    auto it = workers.find(id);
+    if (it != workers.end()) {
+        finishedWorkers.push_back(std::move(it->second));
+        workers.erase(it);
+    }
+}
+
+void ThreadPool::joinFinishedWorkers() {
+    std::vector<std::thread> finished;
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        finished.swap(finishedWorkers);
     }
+    for (std::thread& worker : finished) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
 
-    // 减少线程
-    while (workers.size() > newSize) {
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            tasks.push([this] {  // 向任务队列推送 "空任务"，让线程退出
-                stop = true;
-            });
+void ThreadPool::resize(size_t newSize) {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (stop) {
+            return;
+        }
+        // 不超过 maxThreads；显式缩到下限以下时同时降低下限
+        newSize = std::min(newSize, maxThreads);
+        minThreads = std::min(minThreads, newSize);
+        if (newSize == 0 && queuedTasks > 0) {
+            newSize = 1;  // 保证已排队的任务能执行完
         }
-        condition.notify_all();  // 唤醒线程
 
-        for (std::thread &worker : workers) {
-            if (worker.joinable()) {
-                worker.join();  // 等待线程结束
+        // 增加线程：先撤销尚未执行的退出请求
+        while (liveThreadCount() < newSize) {
+            if (exitRequests > 0) {
+                --exitRequests;
+            } else {
+                spawnWorker();
             }
         }
-        workers.pop_back();  // 安全地减少线程
+
+        // 减少线程：只要求多出的线程退出，不影响其余线程
+        if (liveThreadCount() > newSize) {
+            exitRequests += liveThreadCount() - newSize;
+        }
     }
+    condition.notify_all();
+    joinFinishedWorkers();
+}
+
+void ThreadPool::setLimits(size_t newMinThreads, size_t newMaxThreads) {
+    size_t target;
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        minThreads = newMinThreads;
+        maxThreads = std::max<size_t>(std::max(newMaxThreads, newMinThreads), 1);
+        target = std::min(std::max(liveThreadCount(), minThreads), maxThreads);
+    }
+    resize(target);
+}
+
+void ThreadPool::setQueueLimit(TaskPriority priority, size_t capacity, OverflowPolicy policy) {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        Lane& lane = lanes[static_cast<size_t>(priority)];
+        lane.capacity = capacity;
+        lane.policy = policy;
+    }
+    notFull.notify_all();  // 容量可能变大或不再限制
+}
+
+size_t ThreadPool::getQueueDepth() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return queuedTasks;
+}
+
+size_t ThreadPool::getQueueDepth(TaskPriority priority) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return lanes[static_cast<size_t>(priority)].tasks.size();
+}
+
+uint64_t ThreadPool::getDroppedTaskCount(TaskPriority priority) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return lanes[static_cast<size_t>(priority)].dropped;
+}
+
+size_t ThreadPool::getThreadCount() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return liveThreadCount();
+}
+
+size_t ThreadPool::getBusyThreadCount() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return busyThreads;
+}
+
+double ThreadPool::getUtilization() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    size_t threads = liveThreadCount();
+    return threads == 0 ? 0.0 : std::min(1.0, static_cast<double>(busyThreads) / threads);
+}
+
+size_t ThreadPool::getMinThreads() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return minThreads;
+}
+
+size_t ThreadPool::getMaxThreads() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return maxThreads;
 }
@@ -0,0 +1,101 @@
+// tracing.cpp
+
+#include "tracing.h"
+#include "metrics.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace {
+
+uint64_t currentThreadId() {
+    thread_local uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xFFFFFFFF;
+    return id;
+}
+
+}  // namespace
+
+SpanName::SpanName(const char* name)
+    : name(name),
+      histogram(&MetricsRegistry::getInstance().histogram("request_span_duration_seconds", "Time spent in each phase of request handling",
+                                                          {{"span", name}})) {}
+
+void recordSpan(const SpanName& span, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end) {
+    span.histogram->observe(std::chrono::duration<double>(end - start).count());
+
+    TraceRecorder& recorder = TraceRecorder::getInstance();
+    if (recorder.isEnabled()) {
+        recorder.add(span.name, start, end);
+    }
+}
+
+// ---------------- TraceRecorder ----------------
+
+TraceRecorder::TraceRecorder() : enabled(false), maxEvents(0), origin(std::chrono::steady_clock::now()) {}
+
+TraceRecorder& TraceRecorder::getInstance() {
+    static TraceRecorder instance;
+    return instance;
+}
+
+void TraceRecorder::enable(size_t maxEventCount) {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    maxEvents = maxEventCount;
+    events.reserve(std::min<size_t>(maxEvents, 4096));
+    enabled.store(maxEvents > 0, std::memory_order_relaxed);
+}
+
+void TraceRecorder::add(const char* name, const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end) {
+    TraceEvent event;
+    event.name = name;
+    event.startMicros = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+    event.durationMicros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    event.threadId = currentThreadId();
+
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    if (events.size() < maxEvents) {
+        events.push_back(event);
+    }
+}
+
+std::string TraceRecorder::toJson(bool clear) {
+    std::vector<TraceEvent> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        if (clear) {
+            snapshot.swap(events);
+        } else {
+            snapshot = events;
+        }
+    }
+
+    std::string json = "{\"traceEvents\":[";
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const TraceEvent& event = snapshot[i];
+        if (i > 0) {
+            json += ",";
+        }
+        // 阶段名都是代码中的常量，不需要转义
+        json += "{\"name\":\"";
+        json += event.name;
+        json += "\",\"cat\":\"request\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        json += std::to_string(event.threadId);
+        json += ",\"ts\":";
+        json += std::to_string(event.startMicros);
+        json += ",\"dur\":";
+        json += std::to_string(event.durationMicros);
+        json += "}";
+    }
+    json += "],\"displayTimeUnit\":\"ms\"}";
+    return json;
+}
+
+bool TraceRecorder::dumpToFile(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << toJson(false);
+    return file.good();
+}
@@ -0,0 +1,445 @@
+#include "upstream_engine.h"
+#include "utils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+size_t appendResponse(void* contents, size_t size, size_t nmemb, std::string* body) {
+    size_t length = size * nmemb;
+    try {
+        body->append(static_cast<char*>(contents), length);
+    } catch (const std::bad_alloc&) {
+        return 0;
+    }
+    return length;
+}
+
+size_t writeResponseFile(void* contents, size_t size, size_t nmemb, std::FILE* output) {
+    return std::fwrite(contents, size, nmemb, output) * size;
+}
+
+}  // namespace
+
+struct UpstreamEngine::Transfer {
+    UpstreamRequest request;
+    UpstreamCallback callback;
+    CURL* easy = nullptr;
+    struct curl_slist* headers = nullptr;
+    curl_mime* mime = nullptr;
+    std::FILE* output = nullptr;   // request.outputPath 打开后的文件
+    HttpResponse response;
+    std::chrono::steady_clock::time_point startedAt;
+};
+
+UpstreamEngine& UpstreamEngine::getInstance() {
+    static UpstreamEngine instance;
+    return instance;
+}
+
+UpstreamEngine::UpstreamEngine()
+    : multi(nullptr), stopping(false), activeTransfers(0), waitingTransfers(0), timeoutMs(-1), epollFd(-1), wakeFd(-1) {
+    curl_global_init(CURL_GLOBAL_ALL);  // 引用计数，和 http_client 中的初始化不冲突
+    multi = curl_multi_init();
+
+    HttpClientOptions options = getHttpClientOptions();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);   // HTTP/2 时在同一连接上并发多个请求
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, options.maxHostConnections);
+
+#ifdef __linux__
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, onSocket);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, onTimer);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+#endif
+
+    worker = std::thread(&UpstreamEngine::run, this);
+}
+
+UpstreamEngine::~UpstreamEngine() {
+    shutdown();
+    for (CURL* easy : idleHandles) {
+        curl_easy_cleanup(easy);
+    }
+    curl_multi_cleanup(multi);
+#ifdef __linux__
+    ::close(epollFd);
+    ::close(wakeFd);
+#endif
+    curl_global_cleanup();
+}
+
+void UpstreamEngine::submit(UpstreamRequest request, UpstreamCallback callback) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->request = std::move(request);
+    transfer->callback = std::move(callback);
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        if (!stopping.load()) {
+            submissions.push_back(std::move(transfer));
+        }
+    }
+    if (transfer) {
+        // 引擎已停止
+        transfer->callback(HttpResponse());
+        return;
+    }
+    wake();
+}
+
+std::future<HttpResponse> UpstreamEngine::submit(UpstreamRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> result = promise->get_future();
+    submit(std::move(request), [promise](HttpResponse&& response) { promise->set_value(std::move(response)); });
+    return result;
+}
+
+size_t UpstreamEngine::getQueuedTransfers() {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    return submissions.size() + waitingTransfers;
+}
+
+void UpstreamEngine::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        if (stopping.exchange(true)) {
+            return;
+        }
+    }
+    wake();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void UpstreamEngine::wake() {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+#else
+    curl_multi_wakeup(multi);
+#endif
+}
+
+void UpstreamEngine::startTransfer(std::unique_ptr<Transfer> transfer) {
+    // 熔断器断开时直接以失败结果回调
+    if (!getTelegramCircuitBreaker().allowRequest()) {
+        recordUpstreamRejected();
+        transfer->callback(HttpResponse());
+        startNext(transfer->request.orderingKey);
+        return;
+    }
+
+    if (!transfer->request.outputPath.empty()) {
+        transfer->output = std::fopen(transfer->request.outputPath.c_str(), "wb");
+        if (transfer->output == nullptr) {
+            log(LogLevel::LOGERROR, "Failed to create upstream output file: " + transfer->request.outputPath);
+            transfer->callback(HttpResponse());
+            startNext(transfer->request.orderingKey);
+            return;
+        }
+    }
+
+    CURL* easy = nullptr;
+    if (!idleHandles.empty()) {
+        easy = idleHandles.back();
+        idleHandles.pop_back();
+    } else {
+        easy = curl_easy_init();
+    }
+    if (!easy) {
+        log(LogLevel::LOGERROR, "Failed to initialize CURL.");
+        if (transfer->output != nullptr) {
+            std::fclose(transfer->output);
+            std::remove(transfer->request.outputPath.c_str());
+        }
+        transfer->callback(HttpResponse());
+        startNext(transfer->request.orderingKey);
+        return;
+    }
+
+    applyUpstreamDefaults(easy);
+    const UpstreamRequest& request = transfer->request;
+    curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+    if (transfer->output != nullptr) {
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, writeResponseFile);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer->output);
+    } else {
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, appendResponse);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response.body);
+    }
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT, request.timeoutSeconds);
+    if (!request.form.empty()) {
+        transfer->mime = curl_mime_init(easy);
+        fillMimeParts(transfer->mime, request.form);
+        curl_easy_setopt(easy, CURLOPT_MIMEPOST, transfer->mime);
+    } else if (!request.body.empty()) {
+        // 请求体在传输结束前一直由 Transfer 持有
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request.body.c_str());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request.body.size()));
+        if (!request.contentType.empty()) {
+            transfer->headers = curl_slist_append(nullptr, ("Content-Type: " + request.contentType).c_str());
+            curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+        }
+    }
+
+    transfer->easy = easy;
+    transfer->startedAt = std::chrono::steady_clock::now();
+    Transfer* raw = transfer.release();  // 传输结束时由 finishTransfer 释放
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, raw);
+    runningTransfers.insert(raw);
+    activeTransfers.fetch_add(1, std::memory_order_relaxed);
+    CURLMcode code = curl_multi_add_handle(multi, easy);
+    if (code != CURLM_OK) {
+        log(LogLevel::LOGERROR, "curl_multi_add_handle() failed: " + std::string(curl_multi_strerror(code)));
+        finishTransfer(raw, CURLE_FAILED_INIT);
+    }
+}
+
+void UpstreamEngine::finishTransfer(Transfer* raw, CURLcode result) {
+    std::unique_ptr<Transfer> transfer(raw);
+    runningTransfers.erase(raw);
+    CURL* easy = transfer->easy;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - transfer->startedAt).count();
+    recordUpstreamTransfer(easy, seconds, result);
+
+    if (transfer->output != nullptr && std::fclose(transfer->output) != 0 && result == CURLE_OK) {
+        result = CURLE_WRITE_ERROR;  // 缓冲区中剩余的内容写入失败
+    }
+    transfer->output = nullptr;
+    if (result == CURLE_OK) {
+        transfer->response.ok = true;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &transfer->response.status);
+    } else {
+        log(LogLevel::LOGERROR, "Upstream request failed: " + std::string(curl_easy_strerror(result)) + " URL: " + transfer->request.url);
+        if (!transfer->request.outputPath.empty()) {
+            std::remove(transfer->request.outputPath.c_str());
+        }
+    }
+
+    curl_multi_remove_handle(multi, easy);
+    curl_slist_free_all(transfer->headers);
+    transfer->headers = nullptr;
+    curl_easy_reset(easy);  // 保留连接和 DNS 缓存，供下一个请求复用
+    curl_mime_free(transfer->mime);
+    transfer->mime = nullptr;
+    if (idleHandles.size() < getHttpClientOptions().maxIdleHandles) {
+        idleHandles.push_back(easy);
+    } else {
+        curl_easy_cleanup(easy);
+    }
+    activeTransfers.fetch_sub(1, std::memory_order_relaxed);
+
+    try {
+        transfer->callback(std::move(transfer->response));
+    } catch (const std::exception& e) {
+        log(LogLevel::LOGERROR, "Upstream callback failed: " + std::string(e.what()));
+    }
+
+    startNext(transfer->request.orderingKey);
+}
+
+void UpstreamEngine::startNext(const std::string& key) {
+    if (key.empty()) {
+        return;
+    }
+    auto it = orderedQueues.find(key);
+    if (it == orderedQueues.end()) {
+        return;
+    }
+    if (it->second.empty()) {
+        orderedQueues.erase(it);
+        return;
+    }
+    std::unique_ptr<Transfer> next = std::move(it->second.front());
+    it->second.pop_front();
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        --waitingTransfers;
+    }
+    startTransfer(std::move(next));
+}
+
+void UpstreamEngine::abortAll() {
+    // 先清空等待队列，避免结束正在执行的请求时启动同一个 key 的下一个请求
+    std::map<std::string, std::deque<std::unique_ptr<Transfer>>> waiting;
+    waiting.swap(orderedQueues);
+    std::vector<std::unique_ptr<Transfer>> pending;
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        pending.swap(submissions);
+        waitingTransfers = 0;
+    }
+
+    std::vector<Transfer*> running(runningTransfers.begin(), runningTransfers.end());
+    for (Transfer* transfer : running) {
+        finishTransfer(transfer, CURLE_ABORTED_BY_CALLBACK);
+    }
+    for (auto& entry : waiting) {
+        for (auto& transfer : entry.second) {
+            transfer->callback(HttpResponse());
+        }
+    }
+    for (auto& transfer : pending) {
+        transfer->callback(HttpResponse());
+    }
+}
+
+void UpstreamEngine::processSubmissions() {
+    std::vector<std::unique_ptr<Transfer>> pending;
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        pending.swap(submissions);
+    }
+
+    for (auto& transfer : pending) {
+        const std::string& key = transfer->request.orderingKey;
+        if (!key.empty()) {
+            auto it = orderedQueues.find(key);
+            if (it != orderedQueues.end()) {
+                it->second.push_back(std::move(transfer));  // 前一个请求还没完成
+                std::lock_guard<std::mutex> lock(submitMutex);
+                ++waitingTransfers;
+                continue;
+            }
+            orderedQueues[key];  // 标记该 key 有正在执行的请求
+        }
+        startTransfer(std::move(transfer));
+    }
+}
+
+void UpstreamEngine::collectFinished() {
+    int remaining = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi, &remaining)) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        Transfer* transfer = nullptr;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+        finishTransfer(transfer, message->data.result);
+    }
+}
+
+#ifdef __linux__
+
+int UpstreamEngine::onSocket(CURL* easy, curl_socket_t socket, int what, void* userp, void* socketp) {
+    UpstreamEngine* engine = static_cast<UpstreamEngine*>(userp);
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(engine->epollFd, EPOLL_CTL_DEL, socket, nullptr);
+        return 0;
+    }
+
+    struct epoll_event event = {};
+    event.data.fd = socket;
+    if (what & CURL_POLL_IN) {
+        event.events |= EPOLLIN;
+    }
+    if (what & CURL_POLL_OUT) {
+        event.events |= EPOLLOUT;
+    }
+    if (epoll_ctl(engine->epollFd, EPOLL_CTL_MOD, socket, &event) != 0 && errno == ENOENT) {
+        epoll_ctl(engine->epollFd, EPOLL_CTL_ADD, socket, &event);
+    }
+    return 0;
+}
+
+int UpstreamEngine::onTimer(CURLM* multi, long timeoutMs, void* userp) {
+    static_cast<UpstreamEngine*>(userp)->timeoutMs = timeoutMs;
+    return 0;
+}
+
+void UpstreamEngine::run() {
+    std::vector<struct epoll_event> events(64);
+    int running = 0;
+    auto timerSetAt = std::chrono::steady_clock::now();
+    long armedTimeout = -1;
+
+    while (!stopping.load()) {
+        // curl 通过 onTimer 要求在 timeoutMs 后调用一次超时处理
+        if (timeoutMs != armedTimeout) {
+            armedTimeout = timeoutMs;
+            timerSetAt = std::chrono::steady_clock::now();
+        }
+        int waitMs = 1000;
+        if (armedTimeout >= 0) {
+            long elapsed = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - timerSetAt).count());
+            waitMs = static_cast<int>(std::max(0L, std::min(armedTimeout - elapsed, 1000L)));
+        }
+
+        int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), waitMs);
+        if (count < 0 && errno != EINTR) {
+            log(LogLevel::LOGERROR, "Upstream engine epoll_wait failed: " + std::string(std::strerror(errno)));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t value;
+                while (::read(wakeFd, &value, sizeof(value)) > 0) {
+                }
+                processSubmissions();
+                continue;
+            }
+            int flags = 0;
+            if (events[i].events & EPOLLIN) {
+                flags |= CURL_CSELECT_IN;
+            }
+            if (events[i].events & EPOLLOUT) {
+                flags |= CURL_CSELECT_OUT;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                flags |= CURL_CSELECT_ERR;
+            }
+            curl_multi_socket_action(multi, fd, flags, &running);
+        }
+
+        if (armedTimeout >= 0 && std::chrono::steady_clock::now() - timerSetAt >= std::chrono::milliseconds(armedTimeout)) {
+            timeoutMs = -1;
+            armedTimeout = -1;
+            curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+        collectFinished();
+    }
+
+    // 停止时以失败结果结束所有请求
+    abortAll();
+}
+
+#else  // !__linux__
+
+int UpstreamEngine::onSocket(CURL*, curl_socket_t, int, void*, void*) { return 0; }
+int UpstreamEngine::onTimer(CURLM*, long, void*) { return 0; }
+
+// 非 Linux 平台没有 epoll，使用 curl_multi_poll 等待，行为相同
+void UpstreamEngine::run() {
+    int running = 0;
+    while (!stopping.load()) {
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+        processSubmissions();
+        curl_multi_perform(multi, &running);
+        collectFinished();
+    }
+    abortAll();
+}
+
+#endif
@@ -10,8 +10,11 @@
 #include <mutex>
 #include <openssl/evp.h>
 #include <cstring>
-
-std::mutex logMutex;  // 用于保护日志写入的全局互斥锁
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <cstdlib>
 
 // Base62 字符表
 const std::string BASE62_ALPHABET = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
@@ -20,6 +23,8 @@ const int BASE = 62;
 // 将 logLevel 转换为字符串
 std::string logLevelToString(LogLevel level) {
     switch (level) {
+        case LogLevel::DEBUG:
+            return "DEBUG";
         case LogLevel::INFO:
             return "INFO";
         case LogLevel::WARNING:
@@ -47,25 +52,246 @@ std::string getCurrentTime() {
     return oss.str();
 }
 
-// 日志记录函数，带有线程安全保护
-void log(LogLevel level, const std::string& message) {
-    std::lock_guard<std::mutex> guard(logMutex);  // 使用互斥锁保护日志写入
+std::atomic<int> minimumLogLevel(static_cast<int>(LogLevel::INFO));
+
+LogLevel parseLogLevel(const std::string& level, LogLevel defaultLevel) {
+    std::string lower = level;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "debug") {
+        return LogLevel::DEBUG;
+    } else if (lower == "info") {
+        return LogLevel::INFO;
+    } else if (lower == "warning" || lower == "warn") {
+        return LogLevel::WARNING;
+    } else if (lower == "error") {
+        return LogLevel::LOGERROR;
+    }
+    return defaultLevel;
+}
+
+void setLogLevel(LogLevel level) {
+    minimumLogLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+namespace {
+
+struct LogEntry {
+    LogEntry* next;
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::string message;
+};
+
+// 异步日志：生产者通过 CAS 把日志压入无锁栈，写线程一次取走整个栈、反转成先进先出顺序后批量写出，
+// 日志文件只打开一次，每批只 flush 一次
+class AsyncLogger {
+public:
+    AsyncLogger() : pending(nullptr), writerIdle(false), stopping(false), stopped(false), filePath("bot.log"),
+                    consoleOutput(true), logFile(nullptr), flushRequested(0), flushCompleted(0), cachedSecond(-1) {
+        writerThread = std::thread(&AsyncLogger::writerLoop, this);
+    }
+
+    void push(LogLevel level, std::string&& message) {
+        if (stopped.load(std::memory_order_acquire)) {
+            writeDirect(level, message);  // 写线程已退出（进程结束阶段），直接同步写出
+            return;
+        }
+
+        LogEntry* entry = new LogEntry{nullptr, level, std::chrono::system_clock::now(), std::move(message)};
+        entry->next = pending.load(std::memory_order_relaxed);
+        while (!pending.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_relaxed)) {
+        }
 
-    std::string timestamp = getCurrentTime();
-    std::string levelStr = logLevelToString(level);
-    std::string formattedMessage = "[" + timestamp + "] [" + levelStr + "] " + message;
+        // 写线程空闲时才需要唤醒；错过的唤醒最多延迟一个轮询周期
+        if (writerIdle.load(std::memory_order_acquire)) {
+            wakeup.notify_one();
+        }
+    }
 
-    // 输出到日志文件
-    std::ofstream logFile("bot.log", std::ios_base::app);
-    if (logFile.is_open()) {
-        logFile << formattedMessage << std::endl;
-        logFile.close();
-    } else {
-        std::cerr << "Unable to open log file!" << std::endl;
+    void configure(const std::string& path, bool console) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        filePath = path;
+        consoleOutput = console;
+        if (logFile != nullptr) {
+            std::fclose(logFile);
+            logFile = nullptr;
+        }
+    }
+
+    void flush() {
+        if (stopped.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        uint64_t ticket = ++flushRequested;
+        wakeup.notify_one();
+        flushed.wait(lock, [&]() { return flushCompleted >= ticket || stopped.load(std::memory_order_acquire); });
     }
 
-    // 同时输出到控制台
-    std::cout << formattedMessage << std::endl;
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        if (writerThread.joinable()) {
+            writerThread.join();
+        }
+    }
+
+private:
+    std::atomic<LogEntry*> pending;
+    std::atomic<bool> writerIdle;
+    bool stopping;
+    std::atomic<bool> stopped;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+    std::condition_variable flushed;
+    std::thread writerThread;
+
+    std::mutex writeMutex;  // 保护文件句柄（写线程与进程退出阶段的同步写）
+    std::string filePath;
+    bool consoleOutput;
+    std::FILE* logFile;
+
+    uint64_t flushRequested;
+    uint64_t flushCompleted;
+
+    // 同一秒内的日志复用已格式化的时间戳
+    std::time_t cachedSecond;
+    char cachedTimestamp[32];
+
+    void writerLoop() {
+        std::string buffer;
+        while (true) {
+            LogEntry* batch = pending.exchange(nullptr, std::memory_order_acquire);
+            if (batch == nullptr) {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                if (pending.load(std::memory_order_acquire) != nullptr) {
+                    continue;  // 取空之后又有新日志提交，先写完再处理 flush 请求
+                }
+                if (flushCompleted < flushRequested) {
+                    flushCompleted = flushRequested;
+                    flushed.notify_all();
+                }
+                if (stopping) {
+                    break;
+                }
+                writerIdle.store(true, std::memory_order_release);
+                wakeup.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+                    return stopping || flushCompleted < flushRequested || pending.load(std::memory_order_acquire) != nullptr;
+                });
+                writerIdle.store(false, std::memory_order_release);
+                continue;
+            }
+
+            // 栈是后进先出，反转后按提交顺序写出
+            LogEntry* ordered = nullptr;
+            while (batch != nullptr) {
+                LogEntry* next = batch->next;
+                batch->next = ordered;
+                ordered = batch;
+                batch = next;
+            }
+
+            buffer.clear();
+            while (ordered != nullptr) {
+                appendFormatted(buffer, ordered->level, ordered->time, ordered->message);
+                LogEntry* next = ordered->next;
+                delete ordered;
+                ordered = next;
+            }
+
+            std::lock_guard<std::mutex> lock(writeMutex);
+            writeBuffer(buffer);
+        }
+
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopped.store(true, std::memory_order_release);
+        flushed.notify_all();
+    }
+
+    void appendFormatted(std::string& buffer, LogLevel level, const std::chrono::system_clock::time_point& time, const std::string& message) {
+        std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+        if (seconds != cachedSecond) {
+            std::tm buf;
+#ifdef _WIN32
+            localtime_s(&buf, &seconds);
+#else
+            localtime_r(&seconds, &buf);
+#endif
+            std::strftime(cachedTimestamp, sizeof(cachedTimestamp), "%Y-%m-%d %H:%M:%S", &buf);
+            cachedSecond = seconds;
+        }
+
+        buffer += "[";
+        buffer += cachedTimestamp;
+        buffer += "] [";
+        buffer += logLevelToString(level);
+        buffer += "] ";
+        buffer += message;
+        buffer += "\n";
+    }
+
+    // 调用方需持有 writeMutex
+    void writeBuffer(const std::string& buffer) {
+        if (logFile == nullptr) {
+            logFile = std::fopen(filePath.c_str(), "a");
+        }
+        if (logFile != nullptr) {
+            std::fwrite(buffer.data(), 1, buffer.size(), logFile);
+            std::fflush(logFile);
+        } else {
+            std::cerr << "Unable to open log file!" << std::endl;
+        }
+
+        if (consoleOutput) {
+            std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+            std::fflush(stdout);
+        }
+    }
+
+    void writeDirect(LogLevel level, const std::string& message) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::string buffer;
+        appendFormatted(buffer, level, std::chrono::system_clock::now(), message);
+        writeBuffer(buffer);
+    }
+};
+
+// 有意不析构：进程退出时由 atexit 回调停止写线程并写完剩余日志，之后的日志走同步写
+AsyncLogger& getLogger() {
+    static AsyncLogger* logger = []() {
+        AsyncLogger* instance = new AsyncLogger();
+        std::atexit([]() { getLogger().stop(); });
+        return instance;
+    }();
+    return *logger;
+}
+
+}  // namespace
+
+void log(LogLevel level, const std::string& message) {
+    if (!isLogLevelEnabled(level)) {
+        return;
+    }
+    getLogger().push(level, std::string(message));
+}
+
+void log(LogLevel level, std::string&& message) {
+    if (!isLogLevelEnabled(level)) {
+        return;
+    }
+    getLogger().push(level, std::move(message));
+}
+
+void configureLogger(const std::string& filePath, bool consoleOutput) {
+    getLogger().configure(filePath, consoleOutput);
+}
+
+void flushLogs() {
+    getLogger().flush();
 }
 
 // Gzip 压缩实现
@@ -166,4 +392,38 @@ std::string generateShortLink(const std::string& fileId) {
     std::string hash = calculateSHA256(fileId);
 
     return encodeBase62(hash).substr(0, 6);  // 取前 6 个字符
-}
\ No newline at end of file
+}
+
+// 增量计算 SHA256，用于边接收上传内容边计算内容哈希
+Sha256Hasher::Sha256Hasher() : context(EVP_MD_CTX_new()) {
+    if (context == nullptr || EVP_DigestInit_ex(static_cast<EVP_MD_CTX*>(context), EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(static_cast<EVP_MD_CTX*>(context));
+        throw std::runtime_error("EVP_DigestInit_ex failed");
+    }
+}
+
+Sha256Hasher::~Sha256Hasher() {
+    EVP_MD_CTX_free(static_cast<EVP_MD_CTX*>(context));
+}
+
+void Sha256Hasher::update(const char* data, size_t length) {
+    if (EVP_DigestUpdate(static_cast<EVP_MD_CTX*>(context), data, length) != 1) {
+        throw std::runtime_error("EVP_DigestUpdate failed");
+    }
+}
+
+std::string Sha256Hasher::hexDigest() {
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int lengthOfHash = 0;
+    if (EVP_DigestFinal_ex(static_cast<EVP_MD_CTX*>(context), hash, &lengthOfHash) != 1) {
+        throw std::runtime_error("EVP_DigestFinal_ex failed");
+    }
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(lengthOfHash * 2);
+    for (unsigned int i = 0; i < lengthOfHash; ++i) {
+        hex += digits[hash[i] >> 4];
+        hex += digits[hash[i] & 0x0f];
+    }
+    return hex;
+}
@@ -0,0 +1,306 @@
+// work_stealing_pool.cpp
+
+#include "work_stealing_pool.h"
+
+namespace {
+
+// Chase-Lev 双端队列：所有者在底部 push/pop，其他线程在顶部 steal
+// 环形数组写满后扩容为两倍，旧数组可能仍被窃取者读取，保留到队列销毁时再释放
+class WorkStealingDeque {
+public:
+    WorkStealingDeque() : top(0), bottom(0), array(new RingBuffer(64)) {
+        retired.emplace_back(array.load(std::memory_order_relaxed));
+    }
+
+    // 仅所有者线程调用
+    void push(Task* task) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        RingBuffer* buffer = array.load(std::memory_order_relaxed);
+        if (b - t > buffer->capacity - 1) {
+            buffer = grow(buffer, t, b);
+        }
+        buffer->put(b, task);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // 仅所有者线程调用
+    Task* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        RingBuffer* buffer = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = buffer->get(b);
+        if (t == b) {
+            // 只剩最后一个任务，与窃取者竞争
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // 任意线程调用，竞争失败时返回 nullptr
+    Task* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+
+        RingBuffer* buffer = array.load(std::memory_order_acquire);
+        Task* task = buffer->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+
+    size_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+private:
+    struct RingBuffer {
+        explicit RingBuffer(int64_t capacity)
+            : capacity(capacity), mask(capacity - 1), slots(new std::atomic<Task*>[capacity]) {}
+
+        Task* get(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, Task* task) { slots[index & mask].store(task, std::memory_order_relaxed); }
+
+        const int64_t capacity;
+        const int64_t mask;
+        std::unique_ptr<std::atomic<Task*>[]> slots;
+    };
+
+    RingBuffer* grow(RingBuffer* old, int64_t t, int64_t b) {
+        RingBuffer* bigger = new RingBuffer(old->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        retired.emplace_back(bigger);
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<RingBuffer*> array;
+    std::vector<std::unique_ptr<RingBuffer>> retired;
+};
+
+// 当前线程所属的线程池及其下标，用于让工作线程内提交的任务进入本地队列
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local size_t currentWorkerIndex = 0;
+
+// 找不到任务时先自旋若干轮再休眠，减少短时间空闲带来的唤醒开销
+// 单核机器上自旋只会抢占提交任务的线程，直接休眠
+int spinRounds() {
+    static const int rounds = std::thread::hardware_concurrency() > 1 ? 64 : 0;
+    return rounds;
+}
+
+uint64_t nextRandom(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// 每个工作线程缓存的空闲 Task 槽位上限，超出的槽位直接释放
+const size_t kMaxFreeTasks = 1024;
+
+}  // namespace
+
+// freeTasks 只由所属工作线程访问：本地提交时从中取槽位，执行完（包括窃取来的）任务后把槽位放回
+struct WorkStealingPool::Worker {
+    WorkStealingDeque deque;
+    std::vector<Task*> freeTasks;
+
+    ~Worker() {
+        for (Task* task : freeTasks) {
+            delete task;
+        }
+    }
+
+    Task* acquire(Task&& task) {
+        if (freeTasks.empty()) {
+            return new Task(std::move(task));
+        }
+        Task* slot = freeTasks.back();
+        freeTasks.pop_back();
+        *slot = std::move(task);
+        return slot;
+    }
+
+    void release(Task* slot) {
+        if (freeTasks.size() < kMaxFreeTasks) {
+            freeTasks.push_back(slot);
+        } else {
+            delete slot;
+        }
+    }
+};
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+    : injectionSize(0), sleepingWorkers(0), stop(false) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        stop.store(true);
+    }
+    parkCondition.notify_all();
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();  // 工作线程会先执行完所有已提交的任务再退出
+        }
+    }
+}
+
+void WorkStealingPool::execute(Task task) {
+    if (currentPool == this) {
+        Worker& worker = *workers[currentWorkerIndex];
+        worker.deque.push(worker.acquire(std::move(task)));
+    } else {
+        std::lock_guard<std::mutex> lock(injectionMutex);
+        injectionQueue.push_back(std::move(task));
+        injectionSize.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 与 workerLoop 中 sleepingWorkers 的递增配对（均为 seq_cst），保证不会漏掉唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+        wakeOne();
+    }
+}
+
+void WorkStealingPool::wakeOne() {
+    // 先持有一次锁，确保正在检查条件的线程已经进入等待
+    { std::lock_guard<std::mutex> lock(parkMutex); }
+    parkCondition.notify_one();
+}
+
+bool WorkStealingPool::popInjected(Task& task) {
+    if (injectionSize.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(injectionMutex);
+    if (injectionQueue.empty()) {
+        return false;
+    }
+    task = std::move(injectionQueue.front());
+    injectionQueue.pop_front();
+    injectionSize.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+// 从本地队列或其他线程取到的槽位在取出内容后放回当前线程的空闲链表
+bool WorkStealingPool::findTask(size_t index, uint64_t& randomState, Task& task) {
+    Worker& self = *workers[index];
+    if (Task* slot = self.deque.pop()) {
+        task = std::move(*slot);
+        self.release(slot);
+        return true;
+    }
+    if (popInjected(task)) {
+        return true;
+    }
+
+    // 从随机位置开始依次尝试窃取其他线程的任务
+    size_t count = workers.size();
+    size_t start = static_cast<size_t>(nextRandom(randomState) % count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t victim = (start + i) % count;
+        if (victim == index) {
+            continue;
+        }
+        if (Task* slot = workers[victim]->deque.steal()) {
+            task = std::move(*slot);
+            self.release(slot);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::hasQueuedTasks() const {
+    if (injectionSize.load(std::memory_order_seq_cst) > 0) {
+        return true;
+    }
+    for (const auto& worker : workers) {
+        if (worker->deque.size() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorkerIndex = index;
+    uint64_t randomState = (static_cast<uint64_t>(index) + 1) * 0x9E3779B97F4A7C15ULL;
+
+    int idleRounds = 0;
+    Task task;
+    for (;;) {
+        if (findTask(index, randomState, task)) {
+            idleRounds = 0;
+            task();
+            task = Task();
+            continue;
+        }
+
+        if (++idleRounds < spinRounds()) {
+            std::this_thread::yield();
+            continue;
+        }
+        idleRounds = 0;
+
+        // 休眠前登记，再确认一次没有任务，避免与 push 之间漏掉唤醒
+        sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(parkMutex);
+            parkCondition.wait(lock, [this]() { return stop.load() || hasQueuedTasks(); });
+        }
+        sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+
+        if (stop.load() && !hasQueuedTasks()) {
+            return;
+        }
+    }
+}
+
+size_t WorkStealingPool::getQueueDepth() const {
+    size_t depth = injectionSize.load(std::memory_order_relaxed);
+    for (const auto& worker : workers) {
+        depth += worker->deque.size();
+    }
+    return depth;
+}
+
+size_t WorkStealingPool::getThreadCount() const {
+    return threads.size();
+}